@@ -0,0 +1,19 @@
+#ifndef BENCH_UTIL_HH
+#define BENCH_UTIL_HH
+
+#include <chrono>
+#include <cstddef>
+
+// Mean wall time per call of f(i), i = 0 .. n-1, in ns. The results are
+// summed into sum so that the calls cannot be optimized away.
+template <typename F, typename T>
+double TimePerCall(std::size_t n, F&& f, T& sum)
+{
+  auto start = std::chrono::steady_clock::now();
+  sum = T();
+  for (std::size_t i = 0; i < n; ++i) sum += f(i);
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() / n;
+}
+
+#endif
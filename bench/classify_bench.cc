@@ -0,0 +1,74 @@
+// Microbenchmark: per-photon cost of volume and creator-process
+// classification, by name (string compares as StackingAction/SteppingAction
+// used to do) against VolumeRegistry roles and process sub-types.
+//
+//   classify_bench [n_calls]
+
+#include "BenchUtil.hh"
+#include "VolumeRegistry.hh"
+
+#include "G4Box.hh"
+#include "G4Cerenkov.hh"
+#include "G4EmProcessSubType.hh"
+#include "G4LogicalVolume.hh"
+#include "G4NistManager.hh"
+#include "G4PVPlacement.hh"
+#include "G4Scintillation.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+  const std::size_t n = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+
+  // Volumes with the names used by DetectorConstruction
+  auto air = G4NistManager::Instance()->FindOrBuildMaterial("G4_AIR");
+  auto box = new G4Box("BenchBox", 1. * mm, 1. * mm, 1. * mm);
+  auto world_lv = new G4LogicalVolume(new G4Box("WorldSolid", 1. * m, 1. * m, 1. * m), air, "World");
+  auto world_pv = new G4PVPlacement(nullptr, G4ThreeVector(), world_lv, "World", nullptr, false, 0);
+  std::vector<G4VPhysicalVolume*> volumes = { world_pv };
+  const char* names[][2] = { {"KvcMotherLV", "KvcMotherPV"}, {"KvcLV", "KvcPV"}, {"WrapLV", "WrapPV"},
+                             {"MppcLV", "MppcPV"}, {"BlacksheetLV", "BlacksheetPV"} };
+  for (auto& name : names) {
+    auto lv = new G4LogicalVolume(box, air, name[0]);
+    volumes.push_back(new G4PVPlacement(nullptr, G4ThreeVector(), lv, name[1], world_lv, false, 0));
+  }
+  VolumeRegistry::Build();
+
+  G4Cerenkov cerenkov("Cerenkov");
+  G4Scintillation scintillation("Scintillation");
+  std::vector<const G4VProcess*> processes = { &cerenkov, &scintillation };
+
+  // Random sequence of volumes / creator processes
+  std::mt19937 rng(12345);
+  std::vector<const G4VPhysicalVolume*> vol_seq(1 << 16);
+  std::vector<const G4VProcess*> proc_seq(1 << 16);
+  for (auto& v : vol_seq)  v = volumes[rng() % volumes.size()];
+  for (auto& p : proc_seq) p = processes[rng() % processes.size()];
+  const std::size_t mask = vol_seq.size() - 1;
+
+  long c1 = 0, c2 = 0, c3 = 0, c4 = 0, c5 = 0, c6 = 0;
+  const double t_vol_name = TimePerCall(n, [&](std::size_t i) {
+    return vol_seq[i & mask]->GetName() == "KvcPV"; }, c1);
+  const double t_vol_role = TimePerCall(n, [&](std::size_t i) {
+    return VolumeRegistry::Role(vol_seq[i & mask]) == VolumeRole::kRadiator; }, c2);
+  const double t_mppc_name = TimePerCall(n, [&](std::size_t i) {
+    return G4StrUtil::contains(vol_seq[i & mask]->GetName(), "Mppc"); }, c3);
+  const double t_mppc_role = TimePerCall(n, [&](std::size_t i) {
+    return VolumeRegistry::Role(vol_seq[i & mask]) == VolumeRole::kMppc; }, c4);
+  const double t_proc_name = TimePerCall(n, [&](std::size_t i) {
+    return proc_seq[i & mask]->GetProcessName() == "Cerenkov"; }, c5);
+  const double t_proc_type = TimePerCall(n, [&](std::size_t i) {
+    return proc_seq[i & mask]->GetProcessSubType() == fCerenkov; }, c6);
+
+  std::printf("calls                 : %zu\n", n);
+  std::printf("radiator  name / role : %7.2f / %7.2f ns (matches %ld / %ld)\n", t_vol_name, t_vol_role, c1, c2);
+  std::printf("mppc      name / role : %7.2f / %7.2f ns (matches %ld / %ld)\n", t_mppc_name, t_mppc_role, c3, c4);
+  std::printf("cerenkov  name / type : %7.2f / %7.2f ns (matches %ld / %ld)\n", t_proc_name, t_proc_type, c5, c6);
+  std::printf("per photon (stacking) : %7.2f / %7.2f ns\n", t_vol_name + t_proc_name, t_vol_role + t_proc_type);
+  return 0;
+}
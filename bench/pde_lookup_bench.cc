@@ -0,0 +1,60 @@
+// Microbenchmark: per-call cost of the MPPC PDE lookup, TSpline3::Eval (as
+// MPPCSD used to do per photon) against the dense PDETable.
+//
+//   pde_lookup_bench [n_calls]
+
+#include "BenchUtil.hh"
+#include "PDETable.hh"
+#include "KVC_OpticalProperties.hh"
+
+#include "TGraph.h"
+#include "TSpline.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+  const std::size_t n = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  const double qe_scale = 1.37;
+
+  TGraph graph(KVC_Optical::E_MPPC_PDE.size(), &KVC_Optical::E_MPPC_PDE[0], &KVC_Optical::R_MPPC_PDE[0]);
+  TSpline3 spline("qe_spline", &graph);
+  const double emin = spline.GetXmin();
+  const double emax = spline.GetXmax();
+
+  PDETable table;
+  table.SetScale(qe_scale);
+
+  // Photon energies slightly wider than the PDE range (end-point clamping).
+  std::mt19937_64 rng(12345);
+  std::uniform_real_distribution<double> dist(emin - 0.05 * (emax - emin), emax + 0.05 * (emax - emin));
+  std::vector<double> energies(n);
+  for (auto& e : energies) e = dist(rng);
+
+  auto spline_eval = [&](double e) {
+    if      (e < emin) e = emin;
+    else if (e > emax) e = emax;
+    double qe = spline.Eval(e) * qe_scale;
+    return (qe > 1.0) ? 1.0 : qe;
+  };
+  auto table_eval = [&](double e) { return table.Value(e); };
+
+  double sum_spline = 0., sum_table = 0.;
+  const double t_spline = TimePerCall(n, [&](std::size_t i) { return spline_eval(energies[i]); }, sum_spline);
+  const double t_table  = TimePerCall(n, [&](std::size_t i) { return table_eval(energies[i]); }, sum_table);
+
+  double max_diff = 0.;
+  for (std::size_t i = 0; i < std::min<std::size_t>(n, 1000000); ++i)
+    max_diff = std::max(max_diff, std::abs(spline_eval(energies[i]) - table_eval(energies[i])));
+
+  std::printf("calls          : %zu\n", n);
+  std::printf("TSpline3::Eval : %8.2f ns/call (checksum %.6f)\n", t_spline, sum_spline / n);
+  std::printf("PDETable::Value: %8.2f ns/call (checksum %.6f)\n", t_table, sum_table / n);
+  std::printf("speed-up       : %8.2f\n", t_spline / t_table);
+  std::printf("max |diff|     : %.3e\n", max_diff);
+  return 0;
+}
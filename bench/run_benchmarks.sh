@@ -0,0 +1,67 @@
+#!/bin/bash
+# Fixed-seed reference workloads for the optical transport hot path.
+#
+#   bench/run_benchmarks.sh <KVCOpticalSim> <output dir> [n_events]
+#
+# Every workload writes <output dir>/<name>.json (events/s, optical steps/s,
+# photons tracked/s, peak RSS); the combined result is
+# <output dir>/benchmarks.json. Set BENCH_THREADS to run multi-threaded.
+
+set -e
+
+BIN=$1
+OUT=$2
+N_EVENTS=${3:-200}
+THREADS=${BENCH_THREADS:-1}
+SEED=12345
+SRC_DIR=$(cd "$(dirname "$0")/.." && pwd)
+
+if [ -z "$BIN" ] || [ -z "$OUT" ]; then
+  echo "Usage: $0 <KVCOpticalSim> <output dir> [n_events]"
+  exit 1
+fi
+mkdir -p "$OUT"
+
+# name  conf  extra conf lines  events
+WORKLOADS=(
+  "k_setup|conf/k_setup.conf||$N_EVENTS"
+  "pi_setup|conf/pi_setup.conf||$N_EVENTS"
+  "vis_seg2|conf/vis_seg2.conf||$N_EVENTS"
+  "vis_seg4|conf/vis_seg4.conf||$N_EVENTS"
+  "photon|conf/k_setup.conf|generator photon|$((N_EVENTS * 100))"
+)
+
+RESULTS=()
+for workload in "${WORKLOADS[@]}"; do
+  IFS='|' read -r name conf extra events <<< "$workload"
+  echo "=== $name ($conf, $events events) ==="
+
+  # Later keys override earlier ones in ConfManager.
+  {
+    cat "$SRC_DIR/$conf"
+    echo
+    echo "seed	$SEED"
+    echo "threads	$THREADS"
+    echo "metrics_file	$OUT/$name.json"
+    if [ -n "$extra" ]; then echo "$extra" | tr ' ' '\t'; fi
+  } > "$OUT/$name.conf"
+  printf '/run/verbose 0\n/tracking/verbose 0\n/run/beamOn %s\n' "$events" > "$OUT/$name.mac"
+
+  (cd "$SRC_DIR" && "$BIN" "$OUT/$name.conf" "$OUT/$name.root" "$OUT/$name.mac" > "$OUT/$name.log" 2>&1)
+  RESULTS+=("$OUT/$name.json")
+done
+
+COMMIT=$(git -C "$SRC_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)
+{
+  echo "{"
+  echo "  \"commit\": \"$COMMIT\","
+  echo "  \"results\": {"
+  for i in "${!RESULTS[@]}"; do
+    name=$(basename "${RESULTS[$i]}" .json)
+    sep=","; [ "$i" -eq $((${#RESULTS[@]} - 1)) ] && sep=""
+    echo "    \"$name\": $(sed 's/^/    /' "${RESULTS[$i]}" | sed '1s/^    //')$sep"
+  done
+  echo "  }"
+  echo "}"
+} > "$OUT/benchmarks.json"
+echo "Results: $OUT/benchmarks.json"
@@ -3,14 +3,18 @@
 
 #include <vector>
 
+#include <G4Threading.hh>
 #include <G4ThreeVector.hh>
 #include <G4Run.hh>
 #include <G4Event.hh>
 
-#include "TFile.h"
-#include "TTree.h"
-#include "TVector3.h"
+#include "CherenkovTable.hh"
+#include "EventRecord.hh"
+#include "SimParameters.hh"
 
+// Per-thread event bookkeeping. The event content is collected into an
+// EventRecord and handed to the process-wide OutputWriter at the end of each
+// event, so tracking never touches ROOT I/O.
 class AnaManager
 {
 public:
@@ -23,35 +27,12 @@ private:
   AnaManager& operator=(const AnaManager&);
   
 private:
-  G4String m_output_rootfile_path;
-  TFile* m_file;
-  TTree* m_tree;
-  G4int m_evnum;
-  G4int m_event_id;
-  G4int m_nhit_mppc;
-  G4int m_cerenkov_all;
-  G4int m_cerenkov_quartz;
-  G4double m_beam_energy;
-  G4double m_beam_mom_x;
-  G4double m_beam_mom_y;
-  G4double m_beam_mom_z;
-  G4double m_beam_pos_x;
-  G4double m_beam_pos_y;
-  G4double m_beam_pos_z;  
-  G4int n_cherenkov_gen; //チェレンコフ光発生数
-  G4int m_npe;           //検出フォトエレクトロン数
-  G4int m_nTrapped_Air;  // 空気層（およびWrapper）で消失した数
-
-  std::vector<G4double> m_gen_wave_length; // 生成されたチェレンコフ光の波長
-  std::vector<G4double> m_pos_x;
-  std::vector<G4double> m_pos_y;
-  std::vector<G4double> m_pos_z;
-  std::vector<G4double> m_time;
-  std::vector<G4double> m_energy;
-  std::vector<G4double> m_wave_length;
-  std::vector<G4int> m_particle_id;
-  std::vector<G4int> m_seg;
-  std::vector<G4int> m_detect_flag;
+  EventRecord m_event;
+  // Largest per-event sizes so far: the vectors are reserved to these, so
+  // the recycled records stop growing after the first events.
+  std::size_t m_max_hits;
+  std::size_t m_max_gen;
+  std::size_t m_max_history;
     
 public:
   void BeginOfRunAction(const G4Run*);
@@ -65,13 +46,49 @@ public:
   void SetBeamEnergy(G4double beam_energy);
   void SetBeamMomentum(G4ThreeVector beam_momentum);
   void SetBeamPosition(G4ThreeVector beam_position);
-  void SetOutputRootfilePath(G4String output_rootfile_path);
-  G4String GetOutputRootfilePath();
+  void SetSegment(G4int segment);
+  // The output path is shared by all threads; the OutputWriter opens it.
+  static void SetOutputRootfilePath(G4String output_rootfile_path);
+  static G4String GetOutputRootfilePath();
   //void FillTree(); //追加
-  void SetCherenkovGen(Int_t val) { n_cherenkov_gen = val; } //追加
+  void SetCherenkovGen(G4int val) { m_event.n_cherenkov_gen = val; } //追加
   
-  void IncrementTrappedAir() { m_nTrapped_Air++; }
-  void AddGenWavelength(G4double wl) { m_gen_wave_length.push_back(wl); }
+  void IncrementTrappedAir() { m_event.nTrapped_Air++; }
+  void IncrementOracleKill(G4bool blacksheet, G4double prob)
+  {
+    if (blacksheet) m_event.nKilled_Blacksheet++;
+    else            m_event.nKilled_Trapped++;
+    m_event.killed_prob += prob;
+  }
+  // Generated quartz photon, recorded as gen_wavelength_mode says.
+  void AddGenPhoton(G4double energy)
+  {
+    switch (SimParameters::Get().gen_wavelength_mode) {
+      case SimParameters::kGenWavelengthVector:
+        m_event.gen_wave_length.push_back(CherenkovTable::Wavelength(energy));
+        break;
+      case SimParameters::kGenWavelengthHist:
+        m_event.gen_wave_length_hist[CherenkovTable::WavelengthBin(energy)]++;
+        break;
+      default:
+        break;
+    }
+  }
+  // End of a quartz photon's history (photon_history)
+  void AddPhotonHistory(G4double wave_length, G4double path_quartz, G4double abs_depth,
+                        G4double pde, G4double weight, G4int n_quartz, G4int n_wrapper,
+                        G4int fate, G4int seg)
+  {
+    m_event.ph_wave_length.push_back(wave_length);
+    m_event.ph_path_quartz.push_back(path_quartz);
+    m_event.ph_abs_depth.push_back(abs_depth);
+    m_event.ph_pde.push_back(pde);
+    m_event.ph_weight.push_back(weight);
+    m_event.ph_n_quartz.push_back(n_quartz);
+    m_event.ph_n_wrapper.push_back(n_wrapper);
+    m_event.ph_fate.push_back(fate);
+    m_event.ph_seg.push_back(seg);
+  }
 
 };
 
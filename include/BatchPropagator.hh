@@ -0,0 +1,125 @@
+#ifndef BATCH_PROPAGATOR_HH
+#define BATCH_PROPAGATOR_HH
+
+#include <vector>
+
+#include "globals.hh"
+#include "G4AffineTransform.hh"
+#include "G4ThreeVector.hh"
+#include "MPPCHit.hh"
+#include "PDETable.hh"
+
+class G4Track;
+class G4OpticalSurface;
+
+// Batch propagation of the Cherenkov photons born in the quartz radiator
+// (fastsim_mode batch). StackingAction hands the photons over instead of
+// stacking them; they are kept in structure-of-arrays form and propagated
+// together through the box geometry of ConstructKVC:
+//
+//  - straight-line transport to the next face of the radiator and bulk
+//    absorption (ABSLENGTH of QuartzKVC) in one branch-free loop over all
+//    live photons, which the compiler vectorizes;
+//  - boundary handling photon by photon: Fresnel refraction/TIR at
+//    surface_quartz (unified model, facet sampling for ground finishes), the
+//    air gap and the wrapper surface (REFLECTIVITY, specular/Lambertian/
+//    backscatter reflection), and Fresnel transmission into the MPPCs on the
+//    +-Y faces, where the PDE decides detection as in MPPCSD (Method B).
+//
+// Detected photons are inserted into MppcCollection as MPPCHits with the same
+// content as MPPCSD writes. Optical properties are read back from the
+// material and surface tables at the first flush of every run, so parameter
+// sweeps apply. Photons that leave the radiator/air-gap/wrapper box (ends of
+// the air gap, quartz Y faces between MPPCs) are dropped: only the blacksheet
+// (reflectivity 0) is beyond. Polarization is not followed; the Fresnel
+// coefficients are averaged over s and p.
+class BatchPropagator
+{
+public:
+  BatchPropagator();
+  ~BatchPropagator();
+
+  // Takes over a photon (StackingAction::ClassifyNewTrack); propagates the
+  // batch when it is full.
+  void Add(const G4Track* track);
+  // Propagates the pending photons (StackingAction::NewStage).
+  void Flush();
+
+  static G4bool Enabled(); // fastsim_mode batch
+  static BatchPropagator* GetThreadInstance();
+
+private:
+  struct Surface
+  {
+    G4bool   metal = false;        // dielectric_metal: no transmission
+    G4bool   painted = false;      // groundfrontpainted: Lambertian, no Fresnel
+    G4bool   polished = true;
+    G4double sigma_alpha = 0.;
+    G4double prob_ss = 0., prob_sl = 0., prob_bs = 0.; // unified-model constants
+    std::vector<G4double> reflectivity; // on the energy grid; empty = 1
+  };
+
+  struct Copy
+  {
+    G4int    copy;
+    G4int    side;                 // +1 / -1: Y face
+    G4double x0, x1, z0, z1;       // footprint on the face (radiator frame)
+    G4AffineTransform to_local;    // radiator frame -> MPPC frame
+  };
+
+  void Configure();
+  void ReadSurface(const G4OpticalSurface* surface, Surface& out) const;
+  G4double Table(const std::vector<G4double>& table, G4double energy) const;
+
+  void Transport(G4int n);
+  G4bool Boundary(G4int i);
+  G4bool CrossAirGap(G4ThreeVector& pos, G4ThreeVector& dir, G4double& time,
+                     G4int axis, G4double sign, G4double energy, G4double n_quartz) const;
+  G4bool Reflect(const Surface& surface, G4double energy, G4ThreeVector& dir,
+                 const G4ThreeVector& normal) const;
+  G4int Fresnel(const Surface& surface, G4double energy, G4ThreeVector& dir,
+                const G4ThreeVector& normal, G4double n1, G4double n2) const;
+  G4ThreeVector Scatter(const Surface& surface, const G4ThreeVector& dir,
+                        const G4ThreeVector& facet, const G4ThreeVector& normal) const;
+  G4ThreeVector FacetNormal(const Surface& surface, const G4ThreeVector& dir,
+                            const G4ThreeVector& normal) const;
+  void Detect(G4int i, const G4ThreeVector& pos, const Copy& copy);
+
+  void Resize(G4int n);
+  void Compact(G4int& n);
+
+private:
+  G4int m_run_id;
+  G4int m_coll_id;
+  G4THitsCollection<MPPCHit>* m_hits; // of the current event (Flush)
+
+  // Geometry (radiator frame: centre of KvcPV)
+  G4ThreeVector m_origin;          // KvcPV centre in the world
+  G4double m_half[3];
+  G4double m_gap;                  // air_layer_thickness
+  std::vector<Copy> m_copies;
+
+  // Optics on a uniform energy grid
+  G4double m_emin, m_inv_step;
+  std::vector<G4double> m_rindex, m_groupvel, m_abslength;
+  G4double m_n_air, m_n_mppc;
+  Surface m_quartz;                // quartz <-> air (air gap) or quartz -> wrapper
+  Surface m_wrapper;               // air -> wrapper
+  Surface m_end;                   // quartz Y faces between the MPPCs
+  PDETable m_pde;
+
+  // Photons, structure of arrays
+  G4int m_capacity;
+  G4int m_size;
+  std::vector<G4double> m_x, m_y, m_z;     // position (radiator frame)
+  std::vector<G4double> m_dx, m_dy, m_dz;  // direction
+  std::vector<G4double> m_t;               // global time
+  std::vector<G4double> m_energy, m_weight;
+  std::vector<G4double> m_n, m_vg;         // quartz RINDEX and group velocity at the energy
+  std::vector<G4double> m_abs;             // remaining path to absorption
+  std::vector<G4int>    m_face;            // face reached (axis * 2 + (sign > 0)), -1: absorbed
+  std::vector<G4int>    m_bounces;
+  std::vector<G4double> m_uniform;
+};
+
+#endif
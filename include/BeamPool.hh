@@ -0,0 +1,56 @@
+#ifndef BEAM_POOL_HH
+#define BEAM_POOL_HH
+
+#include <vector>
+
+#include "globals.hh"
+
+// In-memory copy of a ROOT beam file (tree "tree", branches px, py, pz
+// [MeV/c] and vx, vy, vz [mm]) as a structure of arrays.
+//
+// The file is read once, on first use, by whichever thread gets there first.
+// After that the pool is read-only and is shared by all worker threads.
+// The entry for an event depends on beam_sampling:
+//   random     : uniform with replacement (default, as before)
+//   sequential : event ID modulo pool size
+//   shuffle    : a fixed permutation of the pool (beam_shuffle_seed), so
+//                each entry is used once before any is repeated
+// With n_segments and segment_beam split, each segment has its own pool
+// (slot = segment index, file seg<i>.input_beam_file).
+class BeamPool
+{
+public:
+  static const G4int kMaxSlots = 8; // SimParameters::kMaxSegments
+
+  static BeamPool& GetInstance(G4int slot = 0);
+
+private:
+  BeamPool();
+  BeamPool(const BeamPool&);
+  BeamPool& operator=(const BeamPool&);
+
+public:
+  enum Sampling { kRandom, kSequential, kShuffle };
+
+  // Thread-safe; loads only on the first call. False if the file cannot be read.
+  G4bool Load(const G4String& path);
+
+  G4long Size() const { return (G4long)m_px.size(); }
+  G4long Entry(G4int eventID) const;
+
+  G4double Px(G4long i) const { return m_px[i]; }
+  G4double Py(G4long i) const { return m_py[i]; }
+  G4double Pz(G4long i) const { return m_pz[i]; }
+  G4double Vx(G4long i) const { return m_vx[i]; }
+  G4double Vy(G4long i) const { return m_vy[i]; }
+  G4double Vz(G4long i) const { return m_vz[i]; }
+
+private:
+  G4bool m_loaded;
+  Sampling m_sampling;
+  std::vector<G4double> m_px, m_py, m_pz;
+  std::vector<G4double> m_vx, m_vy, m_vz;
+  std::vector<G4long> m_order; // shuffle permutation
+};
+
+#endif
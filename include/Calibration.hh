@@ -0,0 +1,107 @@
+#ifndef CALIBRATION_HH
+#define CALIBRATION_HH
+
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+
+#include "ParameterSweep.hh"
+
+class G4RunManager;
+class DetectorConstruction;
+
+// Surrogate-model calibration of optical parameters against a measured npe
+// distribution (calib_file). Instead of one full simulation per trial of
+// the optimizer, it
+//
+//  1. simulates a space-filling design (Latin hypercube plus the box centre)
+//     of calib_design_points points, calib_events events each;
+//  2. fits one Gaussian-process interpolator per observable (weighted npe
+//     mean and RMS) over the normalized parameters, with the Monte Carlo
+//     errors as noise and the length scale chosen by leave-one-out;
+//  3. minimizes the chi2 of the surrogate against the targets, simulates the
+//     optimum and calib_refine_points points around it, and refits; the
+//     refinement box shrinks by half at each of calib_iterations rounds.
+//
+// Points are run in-process through ParameterSweep::RunPoint, so the same
+// keys can be calibrated as swept (not the geometry). A calibration covers
+// one configuration, i.e. one segment with its beam file and finish.
+//
+// Calibration file (lines starting with '#' are ignored):
+//   param  <key> <min> <max>
+//   target npe_mean <value> <error>
+//   target npe_rms  <value> <error>
+//
+// Writes "<stem>_cNNN.root" per point, "<stem>_calib.tsv" (every simulated
+// point) and "<stem>_calib_best.conf" (best fit, as conf lines).
+class Calibration
+{
+public:
+  Calibration(G4RunManager* runManager, DetectorConstruction* detector);
+  ~Calibration();
+
+  G4bool Load(const G4String& filename);
+  void Run();
+
+private:
+  enum Observable { kNpeMean, kNpeRMS, kNObservables };
+
+  struct Param
+  {
+    std::string key;
+    G4double min, max;
+  };
+
+  struct Target
+  {
+    G4bool   used = false;
+    G4double value = 0., error = 0.;
+  };
+
+  struct Point
+  {
+    std::vector<G4double> u;         // normalized parameters, [0, 1]
+    G4double y[kNObservables];       // simulated observables
+    G4double error[kNObservables];   // their Monte Carlo errors
+  };
+
+  // Gaussian-process interpolator of one observable
+  struct Surrogate
+  {
+    G4double length = 0.3;
+    G4double mean = 0.;
+    G4double scale = 1.;
+    std::vector<G4double> weight;
+    std::vector<std::vector<G4double>> u;
+
+    G4double Eval(const std::vector<G4double>& x) const;
+  };
+
+  Point Simulate(const std::vector<G4double>& u, G4int iteration);
+  std::vector<std::string> Values(const std::vector<G4double>& u) const;
+  void Fit(Observable obs, Surrogate& surrogate) const;
+  G4double Chi2(const G4double y[kNObservables]) const;
+  G4double SurrogateChi2(const std::vector<G4double>& u) const;
+  std::vector<G4double> Minimize(const std::vector<G4double>& start, G4double step) const;
+  std::vector<G4double> Uniform(const std::vector<G4double>& centre, G4double half_width);
+
+private:
+  ParameterSweep m_sweep;
+  std::vector<Param> m_params;
+  Target m_targets[kNObservables];
+  G4int m_events;
+  G4int m_design_points;
+  G4int m_refine_points;
+  G4int m_iterations;
+  std::mt19937_64 m_rng;           // design and refinement points (calib_seed)
+
+  std::vector<Point> m_points;
+  Surrogate m_surrogates[kNObservables];
+  G4String m_stem;
+  std::ofstream m_table;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef CHECKPOINT_HH
+#define CHECKPOINT_HH
+
+#include "globals.hh"
+
+// Periodic checkpoints of a batch run, and resumption from the last one.
+//
+// With checkpoint_events N, a checkpoint is taken whenever the writer thread
+// reaches an event whose ID is a multiple of N: every earlier event is in
+// the output at that point. The writer auto-saves the tree (or the
+// histograms) and writes "<output>.ckpt" with the state below. With resume 1
+// the run continues from that file: the output is reopened and only the
+// remaining events are processed. Events are seeded from their IDs
+// (EventSeeder), so the seeding inputs are all that is kept of the random
+// state.
+struct CheckpointState
+{
+  G4int first_event = 0; // first event of the interrupted run
+  G4int n_events = 0;    // end of the interrupted run (first_event + events)
+  G4int next_event = 0;  // first event that is not in the output
+  G4int entries = 0;     // events in the output (evnum of the next one)
+  G4long summary_events = 0;
+  G4double npe_sum = 0.;
+  G4double npe_sum2 = 0.;
+  G4long master_seed = 0;
+  G4int run_id = 0;
+};
+
+class Checkpoint
+{
+public:
+  // main, after the conf is loaded and before SimParameters::Resolve().
+  // With resume 1 this reads the checkpoint and sets first_event.
+  static void Configure(const G4String& output_path);
+
+  static G4int Interval() { return s_interval; }
+  static G4bool IsDue(G4int event_id)
+  {
+    return s_interval > 0 && event_id % s_interval == 0;
+  }
+
+  static G4bool Resuming() { return s_resuming; }
+  static const CheckpointState& ResumeState() { return s_resume; }
+  static G4int RemainingEvents() { return s_resume.n_events - s_resume.next_event; }
+
+  static void Write(const G4String& output_path, const CheckpointState& state); // writer thread
+  static void EndRun(const G4String& output_path); // master, after the writer closed
+
+  static G4String FilePath(const G4String& output_path) { return output_path + ".ckpt"; }
+
+private:
+  static G4bool Read(const G4String& path, CheckpointState& state);
+
+  static G4int s_interval;
+  static G4bool s_resuming;
+  static CheckpointState s_resume;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef CHERENKOV_TABLE_HH
+#define CHERENKOV_TABLE_HH
+
+#include <vector>
+
+#include "globals.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+
+// Cherenkov yield and spectrum of QuartzKVC, built once from
+// KVC_Optical::E_Quartz_RINDEX / R_Quartz_RINDEX (the table DetectorConstruction
+// gives the material, never changed by a sweep).
+//
+// The cumulative integral of 1/n^2 over the RINDEX grid gives the mean number
+// of photons per unit length as G4Cerenkov computes it. The spectrum
+// at beta = 1 is integrated into the bins of the generated-wavelength
+// histogram (gen_wavelength_mode hist), and WavelengthBin() maps a photon
+// energy to the same bin as TH1::Fill on h_gen_wave_length, so a photon costs
+// one counter increment instead of a vector entry.
+class CherenkovTable
+{
+public:
+  // Generated-wavelength binning (h_gen_wave_length, gen_wave_length_hist):
+  // bin 0 is the underflow, kWavelengthBins + 1 the overflow, as in ROOT.
+  static constexpr G4int    kWavelengthBins = 140;
+  static constexpr G4double kWavelengthMin  = 200.; // nm
+  static constexpr G4double kWavelengthMax  = 900.; // nm
+  // Energy window of n_cherenkov_gen
+  static constexpr G4double kGenEmin = 1.37 * CLHEP::eV;
+  static constexpr G4double kGenEmax = 3.87 * CLHEP::eV;
+
+  static const CherenkovTable& Get();
+
+  // Photon wavelength in nm.
+  static inline G4double Wavelength(G4double energy)
+  {
+    return (CLHEP::h_Planck * CLHEP::c_light / energy) / CLHEP::nm;
+  }
+
+  static inline G4int WavelengthBin(G4double energy)
+  {
+    const G4double wl = Wavelength(energy);
+    if (wl < kWavelengthMin) return 0;
+    if (wl >= kWavelengthMax) return kWavelengthBins + 1;
+    return 1 + (G4int)(kWavelengthBins * (wl - kWavelengthMin) / (kWavelengthMax - kWavelengthMin));
+  }
+
+  // Mean number of Cherenkov photons per unit length for a unit-charge
+  // particle of velocity beta, in [emin, emax] (default: the RINDEX range).
+  G4double MeanPhotonsPerLength(G4double beta) const;
+  G4double MeanPhotonsPerLength(G4double beta, G4double emin, G4double emax) const;
+
+  // Fraction of the beta = 1 photons in each wavelength bin (with under- and
+  // overflow, kWavelengthBins + 2 entries).
+  const std::vector<G4double>& Spectrum() const { return m_spectrum; }
+
+  G4double GetEmin() const { return m_energy.front(); }
+  G4double GetEmax() const { return m_energy.back(); }
+
+  void Print() const;
+
+private:
+  CherenkovTable();
+  G4double RIndex(G4double energy) const;
+  G4double InvN2Integral(G4double energy) const; // from GetEmin()
+
+private:
+  std::vector<G4double> m_energy;
+  std::vector<G4double> m_rindex;
+  std::vector<G4double> m_cum_inv_n2;   // integral of 1/n^2 up to each grid point
+  G4double m_nmin;
+  std::vector<G4double> m_spectrum;
+};
+
+#endif
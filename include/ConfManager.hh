@@ -3,6 +3,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 class ConfManager {
 public:
@@ -15,6 +16,7 @@ public:
     void Set(const std::string& key, const std::string& value);
     void LoadConfigFile(const std::string& filename);
     bool Check(const std::string& key) const;
+    std::vector<std::string> Keys() const;
 
 private:
     ConfManager();
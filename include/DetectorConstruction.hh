@@ -7,10 +7,15 @@
 #include "G4Element.hh"
 #include "G4Material.hh"
 
+#include <set>
+#include <string>
 #include <vector>
 #include "G4VPhysicalVolume.hh"
 
 class DetectorMessenger;
+class G4OpticalSurface;
+class G4Region;
+class G4MaterialPropertiesTable;
 
 class DetectorConstruction : public G4VUserDetectorConstruction
 {
@@ -18,25 +23,46 @@ public:
   DetectorConstruction();
   ~DetectorConstruction();
 
+  G4bool UpdateOpticalParameters(const std::set<std::string>& keys);
+
 private:
+  // Placements and surfaces of one segment: a single one, or n_segments
+  // side by side along x (copy number of KvcMotherPV = segment index).
+  struct Segment
+  {
+    G4VPhysicalVolume*              mother_pv = nullptr;
+    G4VPhysicalVolume*              kvc_pv = nullptr;
+    G4VPhysicalVolume*              wrap_pv = nullptr;
+    std::vector<G4VPhysicalVolume*> mppc_pvs;
+    G4OpticalSurface*               surface_quartz = nullptr;
+    G4OpticalSurface*               surface_wrapper = nullptr;
+  };
+
   std::map<G4String, G4Element*>  m_element_map;
   std::map<G4String, G4Material*> m_material_map;
   G4LogicalVolume*                m_world_lv;
-  G4LogicalVolume*                m_mother_lv;
   G4LogicalVolume*                m_blacksheet_lv;
-  G4VPhysicalVolume*              m_mother_pv;
-  G4VPhysicalVolume*              m_kvc_pv;
-  G4VPhysicalVolume*              m_wrap_pv;
-  std::vector<G4VPhysicalVolume*> m_mppc_pvs;
+  G4LogicalVolume*                m_mppc_lv;
+  G4Region*                       m_kvc_region; // fast-simulation envelope
+  std::vector<Segment>            m_segments;
+  G4OpticalSurface*               m_surface_mppc;
   G4bool                          m_check_overlaps;
 
 private:
   virtual G4VPhysicalVolume* Construct();
+  virtual void ConstructSDandField();
   void ConstructElements();
   void ConstructMaterials();
   void ConstructKVC();
   void AddOpticalProperties();
   void AddSurfaceProperties();
+  void ConfigureQuartzSurface(G4int segment);
+  void ConfigureWrapperSurface(G4int segment);
+  void ConfigureMppcSurface();
+  void ReplaceSurfaceTable(G4OpticalSurface* surface, G4MaterialPropertiesTable* table);
+  std::vector<G4double> QuartzAbsLength() const;
+  std::vector<G4double> AirRindex() const;
+  std::vector<G4double> TeflonRindex() const;
   void DumpMaterialProperties(G4Material* mat);
 
   void CheckOverlaps(G4bool flag) { m_check_overlaps = flag; }
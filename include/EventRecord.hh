@@ -0,0 +1,169 @@
+#ifndef EVENT_RECORD_HH
+#define EVENT_RECORD_HH
+
+#include <vector>
+
+#include "globals.hh"
+
+// Contents of one entry of the output tree. Workers fill a record at the end
+// of each event and hand it to the OutputWriter; records are recycled so the
+// per-hit vectors keep their capacity between events.
+struct EventRecord
+{
+  G4int evnum = 0;           // assigned by the writer (fill order)
+  G4int event_id = 0;
+  G4int cerenkov_all = 0;
+  G4int cerenkov_quartz = 0;
+  G4double beam_energy = 0.;
+  G4double beam_mom_x = 0.;
+  G4double beam_mom_y = 0.;
+  G4double beam_mom_z = 0.;
+  G4double beam_pos_x = 0.;
+  G4double beam_pos_y = 0.;
+  G4double beam_pos_z = 0.;
+  G4int n_cherenkov_gen = 0;
+  G4int npe = 0;
+  G4double npe_weighted = 0.; // sum of hit weights (unbiased under thinning)
+  G4int nTrapped_Air = 0;
+  G4int nKilled_Blacksheet = 0; // kill oracle: heading into the blacksheet
+  G4int nKilled_Trapped = 0;    // kill oracle: trapped in polished quartz
+  G4double killed_prob = 0.;    // kill oracle: sum of weight x detection bound
+  G4int nhit_mppc = 0;
+  G4int segment = 0;         // segment the primary was aimed at (n_segments)
+
+  // Per-hit vectors (one entry per MPPCHit): each one is listed in
+  // TakeFrom, ClearHits and ReserveHits.
+  std::vector<G4double> pos_x;
+  std::vector<G4double> pos_y;
+  std::vector<G4double> pos_z;
+  std::vector<G4double> time;
+  std::vector<G4double> energy;
+  std::vector<G4double> wave_length;
+  std::vector<G4int> particle_id;
+  std::vector<G4int> seg;
+  std::vector<G4int> mppc_segment; // segment of the MPPC (n_segments)
+  std::vector<G4int> detect_flag;
+  std::vector<G4double> weight;
+  std::vector<G4double> gen_wave_length;     // gen_wavelength_mode vector
+  std::vector<G4int> gen_wave_length_hist;   // gen_wavelength_mode hist (CherenkovTable bins)
+
+  // Photon history (photon_history), one entry per recorded quartz photon
+  std::vector<float> ph_wave_length;   // nm
+  std::vector<float> ph_path_quartz;   // path length in the quartz [mm]
+  std::vector<float> ph_abs_depth;     // path_quartz / quartz ABSLENGTH
+  std::vector<float> ph_pde;           // unscaled PDE at the MPPC (0: none, <0: unknown)
+  std::vector<float> ph_weight;        // track weight (thinning, roulette)
+  std::vector<short> ph_n_quartz;      // interactions survived at the quartz surface
+  std::vector<short> ph_n_wrapper;     // interactions survived at the wrapper surface
+  std::vector<short> ph_fate;          // PhotonHistory::Fate
+  std::vector<short> ph_seg;           // MPPC copy number reached, -1 if none
+
+  // Scalars are copied, vectors are swapped (no allocation).
+  void TakeFrom(EventRecord& other)
+  {
+    evnum           = other.evnum;
+    event_id        = other.event_id;
+    cerenkov_all    = other.cerenkov_all;
+    cerenkov_quartz = other.cerenkov_quartz;
+    beam_energy     = other.beam_energy;
+    beam_mom_x      = other.beam_mom_x;
+    beam_mom_y      = other.beam_mom_y;
+    beam_mom_z      = other.beam_mom_z;
+    beam_pos_x      = other.beam_pos_x;
+    beam_pos_y      = other.beam_pos_y;
+    beam_pos_z      = other.beam_pos_z;
+    n_cherenkov_gen = other.n_cherenkov_gen;
+    npe             = other.npe;
+    npe_weighted    = other.npe_weighted;
+    nTrapped_Air    = other.nTrapped_Air;
+    nKilled_Blacksheet = other.nKilled_Blacksheet;
+    nKilled_Trapped = other.nKilled_Trapped;
+    killed_prob     = other.killed_prob;
+    nhit_mppc       = other.nhit_mppc;
+    segment         = other.segment;
+    pos_x.swap(other.pos_x);
+    pos_y.swap(other.pos_y);
+    pos_z.swap(other.pos_z);
+    time.swap(other.time);
+    energy.swap(other.energy);
+    wave_length.swap(other.wave_length);
+    particle_id.swap(other.particle_id);
+    seg.swap(other.seg);
+    mppc_segment.swap(other.mppc_segment);
+    detect_flag.swap(other.detect_flag);
+    weight.swap(other.weight);
+    gen_wave_length.swap(other.gen_wave_length);
+    gen_wave_length_hist.swap(other.gen_wave_length_hist);
+    ph_wave_length.swap(other.ph_wave_length);
+    ph_path_quartz.swap(other.ph_path_quartz);
+    ph_abs_depth.swap(other.ph_abs_depth);
+    ph_pde.swap(other.ph_pde);
+    ph_weight.swap(other.ph_weight);
+    ph_n_quartz.swap(other.ph_n_quartz);
+    ph_n_wrapper.swap(other.ph_n_wrapper);
+    ph_fate.swap(other.ph_fate);
+    ph_seg.swap(other.ph_seg);
+  }
+
+  void ClearHits()
+  {
+    pos_x.clear();
+    pos_y.clear();
+    pos_z.clear();
+    time.clear();
+    energy.clear();
+    wave_length.clear();
+    particle_id.clear();
+    seg.clear();
+    mppc_segment.clear();
+    detect_flag.clear();
+    weight.clear();
+    gen_wave_length.clear();
+    gen_wave_length_hist.clear();
+    ClearHistory();
+  }
+
+  void ClearHistory()
+  {
+    ph_wave_length.clear();
+    ph_path_quartz.clear();
+    ph_abs_depth.clear();
+    ph_pde.clear();
+    ph_weight.clear();
+    ph_n_quartz.clear();
+    ph_n_wrapper.clear();
+    ph_fate.clear();
+    ph_seg.clear();
+  }
+
+  void ReserveHistory(std::size_t n)
+  {
+    ph_wave_length.reserve(n);
+    ph_path_quartz.reserve(n);
+    ph_abs_depth.reserve(n);
+    ph_pde.reserve(n);
+    ph_weight.reserve(n);
+    ph_n_quartz.reserve(n);
+    ph_n_wrapper.reserve(n);
+    ph_fate.reserve(n);
+    ph_seg.reserve(n);
+  }
+
+  // One allocation per vector at most, instead of growing hit by hit.
+  void ReserveHits(std::size_t n)
+  {
+    pos_x.reserve(n);
+    pos_y.reserve(n);
+    pos_z.reserve(n);
+    time.reserve(n);
+    energy.reserve(n);
+    wave_length.reserve(n);
+    particle_id.reserve(n);
+    seg.reserve(n);
+    mppc_segment.reserve(n);
+    detect_flag.reserve(n);
+    weight.reserve(n);
+  }
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef EVENT_SEEDER_HH
+#define EVENT_SEEDER_HH
+
+#include "globals.hh"
+
+// Per-event seeding. The random engine of the thread that runs an event is
+// reseeded at the start of the event with seeds derived from
+// (master seed, run ID, event ID). An event therefore does not depend on the
+// thread, on the number of threads, or on how the events are split over
+// jobs, and a single event can be replayed on its own:
+//
+//   seed          master seed (default: from std::random_device, printed)
+//   replay_event  run only this event ID (the macro is not executed)
+//   replay_run    run ID of the replayed event (default 0)
+//   common_random_numbers
+//                 1: correlated sampling. Every run is seeded as run 0, so
+//                 the runs of a sweep or calibration see the same primaries,
+//                 and every track reseeds the engine from (event, track ID)
+//                 (TrackingAction), so a photon whose fate changes with the
+//                 parameters does not shift the random numbers of the others.
+//
+// The master seed and run ID are written to the output file (TParameters
+// "master_seed" and "run_id"); the tree holds the event IDs.
+class EventSeeder
+{
+public:
+  static void Configure();               // main, after the conf is loaded
+  static G4long MasterSeed() { return s_master_seed; }
+
+  static void BeginRun(G4int run_id);    // master, begin of run
+  static G4int RunID() { return s_run_id; }
+  static void SeedEvent(G4int event_id); // event thread, before any random number
+  static void SeedTrack(G4int track_id); // event thread, start of each track (common_random_numbers)
+
+  static G4bool Replaying() { return s_replay; }
+  static G4bool CommonRandomNumbers() { return s_common; }
+
+  // Four non-zero 31-bit seeds (engine seed array, 0-terminated by the caller)
+  static void DeriveSeeds(G4long master_seed, G4int run_id, G4int event_id, long seeds[4]);
+
+private:
+  static G4long s_master_seed;
+  static G4int s_run_id;
+  static G4bool s_replay;
+  static G4bool s_common;
+};
+
+#endif
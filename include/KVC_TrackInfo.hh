@@ -2,16 +2,69 @@
 #define KVC_TRACK_INFO_HH
 
 #include "G4VUserTrackInformation.hh"
+#include "G4Allocator.hh"
+#include "StepProfiler.hh"
 
 class KVC_TrackInfo : public G4VUserTrackInformation {
 public:
-    KVC_TrackInfo(bool isFromQuartz) : fIsFromQuartz(isFromQuartz) {}
+    KVC_TrackInfo(bool isFromQuartz)
+      : fIsFromQuartz(isFromQuartz), fArrived(false), fDetected(false),
+        fNQuartz(0), fNWrapper(0), fArrivalSeg(-1), fQuartzPath(0.), fArrivalPDE(0.) {}
     virtual ~KVC_TrackInfo() {}
 
+    // One per quartz Cherenkov photon: taken from a per-thread pool
+    inline void* operator new(size_t);
+    inline void  operator delete(void* info);
+
     bool IsFromQuartz() const { return fIsFromQuartz; }
 
+    // Photon history (photon_history): interactions survived at each
+    // surface, path in the quartz, and the MPPC it reached with the unscaled
+    // PDE at its energy (negative when unknown, Method A).
+    void AddQuartzBounce() { ++fNQuartz; }
+    void AddWrapperBounce() { ++fNWrapper; }
+    void AddQuartzPath(double length) { fQuartzPath += length; }
+    void SetArrival(int seg, double pde, bool detected)
+    {
+        fArrived = true;
+        fArrivalSeg = seg;
+        fArrivalPDE = pde;
+        fDetected = detected;
+    }
+
+    bool Arrived() const { return fArrived; }
+    bool Detected() const { return fDetected; }
+    int GetNQuartz() const { return fNQuartz; }
+    int GetNWrapper() const { return fNWrapper; }
+    int GetArrivalSeg() const { return fArrivalSeg; }
+    double GetQuartzPath() const { return fQuartzPath; }
+    double GetArrivalPDE() const { return fArrivalPDE; }
+
 private:
     bool fIsFromQuartz;
+    bool fArrived;
+    bool fDetected;
+    int fNQuartz;
+    int fNWrapper;
+    int fArrivalSeg;
+    double fQuartzPath;
+    double fArrivalPDE;
 };
 
+// Thread-local: the track (and its information) is deleted on the thread
+// that stacked it.
+extern G4ThreadLocal G4Allocator<KVC_TrackInfo>* KVC_TrackInfoAllocator;
+
+inline void* KVC_TrackInfo::operator new(size_t)
+{
+    if (!KVC_TrackInfoAllocator) KVC_TrackInfoAllocator = new G4Allocator<KVC_TrackInfo>;
+    KVC_PROFILE_ALLOC(StepProfiler::kAllocTrackInfo);
+    return (void*)KVC_TrackInfoAllocator->MallocSingle();
+}
+
+inline void KVC_TrackInfo::operator delete(void* info)
+{
+    KVC_TrackInfoAllocator->FreeSingle((KVC_TrackInfo*)info);
+}
+
 #endif
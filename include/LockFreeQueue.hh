@@ -0,0 +1,91 @@
+#ifndef LOCK_FREE_QUEUE_HH
+#define LOCK_FREE_QUEUE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded multi-producer / multi-consumer queue (D. Vyukov's sequence-number
+// ring). Push and Pop never take a lock; they return false when the queue is
+// full or empty respectively. The capacity is rounded up to a power of two.
+template <typename T>
+class LockFreeQueue
+{
+public:
+  explicit LockFreeQueue(std::size_t capacity)
+    : m_mask(RoundUp(capacity) - 1),
+      m_cells(new Cell[m_mask + 1]),
+      m_enqueue_pos(0),
+      m_dequeue_pos(0)
+  {
+    for (std::size_t i = 0; i <= m_mask; ++i)
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  LockFreeQueue(const LockFreeQueue&) = delete;
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+  bool Push(const T& value)
+  {
+    Cell* cell;
+    std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &m_cells[pos & m_mask];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+      if (diff == 0) {
+        if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Pop(T& value)
+  {
+    Cell* cell;
+    std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &m_cells[pos & m_mask];
+      std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+      if (diff == 0) {
+        if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // empty
+      } else {
+        pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    value = cell->data;
+    cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T data;
+  };
+
+  static std::size_t RoundUp(std::size_t n)
+  {
+    std::size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+  }
+
+  const std::size_t m_mask;
+  std::unique_ptr<Cell[]> m_cells;
+  alignas(64) std::atomic<std::size_t> m_enqueue_pos;
+  alignas(64) std::atomic<std::size_t> m_dequeue_pos;
+};
+
+#endif
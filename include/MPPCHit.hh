@@ -5,6 +5,7 @@
 #include "G4ThreeVector.hh"
 #include "G4Allocator.hh"
 #include "G4THitsCollection.hh"
+#include "StepProfiler.hh"
 
 class MPPCHit : public G4VHit {
 public:
@@ -12,6 +13,10 @@ public:
   virtual ~MPPCHit();                // Destructor
   MPPCHit(const MPPCHit& right);     // Copy constructor
 
+  // Hits come from a per-thread pool (MPPCHitAllocator)
+  inline void* operator new(size_t);
+  inline void  operator delete(void* hit);
+
   // Set and get hit position (local coordinates)
   void SetPosition(const G4ThreeVector& pos) { fPosition = pos; }
   G4ThreeVector GetPosition() const { return fPosition; }
@@ -40,6 +45,10 @@ public:
   void SetCopyNumber(G4int cn) { fCopyNumber = cn; }
   G4int GetCopyNumber() const { return fCopyNumber; }
 
+  // Set and get segment (copy number of the KVC mother volume)
+  void SetSegment(G4int seg) { fSegment = seg; }
+  G4int GetSegment() const { return fSegment; }
+
   // Set and get event ID
   void SetEventID(G4int id) { fEventID = id; }
   G4int GetEventID() const { return fEventID; }
@@ -48,6 +57,10 @@ public:
   void SetDetectFlag(G4int detectFlag) { fDetectFlag = detectFlag; }
   G4int GetDetectFlag() const { return fDetectFlag; }
   
+  // Set and get statistical weight (photon thinning / Russian roulette)
+  void SetWeight(G4double w) { fWeight = w; }
+  G4double GetWeight() const { return fWeight; }
+  
   void Print() const;  // Print hit details
 
 private:
@@ -58,11 +71,26 @@ private:
   G4double fWaveLength;          // wave length
   G4int fParticleID;             // Particle ID
   G4int fCopyNumber;             // MPPC copy number
+  G4int fSegment;                // segment of the MPPC
   G4int fEventID;                // Event ID
   G4int fDetectFlag;             // detect flag
+  G4double fWeight;              // statistical weight
 };
 
-// Memory allocator for MPPCHit objects
-extern G4Allocator<MPPCHit> MPPCHitAllocator;
+// Memory allocator for MPPCHit objects. Thread-local: hits are created and
+// deleted (with their event) on the thread that processes the event.
+extern G4ThreadLocal G4Allocator<MPPCHit>* MPPCHitAllocator;
+
+inline void* MPPCHit::operator new(size_t)
+{
+  if (!MPPCHitAllocator) MPPCHitAllocator = new G4Allocator<MPPCHit>;
+  KVC_PROFILE_ALLOC(StepProfiler::kAllocHit);
+  return (void*)MPPCHitAllocator->MallocSingle();
+}
+
+inline void MPPCHit::operator delete(void* hit)
+{
+  MPPCHitAllocator->FreeSingle((MPPCHit*)hit);
+}
 
 #endif
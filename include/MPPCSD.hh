@@ -1,10 +1,11 @@
 #ifndef MPPCSD_HH
 #define MPPCSD_HH
 
+#include <vector>
+
 #include "G4VSensitiveDetector.hh"
 #include "MPPCHit.hh"
-
-#include "TSpline.h"
+#include "PDETable.hh"
 
 class G4Step;
 class G4TouchableHistory;
@@ -21,12 +22,7 @@ public:
 
 private:
   G4THitsCollection<MPPCHit>* m_hits_collection;
-  TSpline3* m_qe_spline;
-  G4double m_range_min;
-  G4double m_range_max;
-  G4double m_qe_scale;
-
-  void InitializeQESpline();
+  std::vector<PDETable> m_pde; // per segment, qe_scale folded in
 };
 
 #endif
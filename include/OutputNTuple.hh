@@ -0,0 +1,36 @@
+#ifndef OUTPUT_NTUPLE_HH
+#define OUTPUT_NTUPLE_HH
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+
+#include "EventRecord.hh"
+
+class TFile;
+class OutputSchema;
+
+// RNTuple counterpart of the output tree (output_mode ntuple). The ntuple is
+// named "tree" and has the same columns as the TTree, filtered and typed by
+// the OutputSchema, so RDataFrame("tree", file) reads either format.
+// Requires ROOT 6.30 or newer; older versions abort in Open().
+//
+// Used by the OutputWriter on its thread only.
+class OutputNTuple
+{
+public:
+  OutputNTuple();
+  ~OutputNTuple();
+
+  void Open(TFile* file, const OutputSchema& schema);
+  void Fill(EventRecord& buffer);
+  void Close(); // commits the ntuple; call before closing the file
+
+private:
+  struct Columns;
+  std::unique_ptr<Columns> m_columns;
+};
+
+#endif
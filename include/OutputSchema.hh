@@ -0,0 +1,83 @@
+#ifndef OUTPUT_SCHEMA_HH
+#define OUTPUT_SCHEMA_HH
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+
+#include "EventRecord.hh"
+
+class TFile;
+class TTree;
+
+// Layout of the output tree, read from the conf at the start of each run:
+//
+//   output_branches          comma-separated branches to write (default: all)
+//   output_drop_redundant    1: drop particle_id (always -22), detect_flag
+//                            (always 1) and energy (same as wave_length)
+//   output_precision         double (default) or float for the hit vectors;
+//                            compact also stores the integer hit vectors
+//                            (particle_id, seg, mppc_segment, detect_flag)
+//                            as short
+//   output_compression       zlib, lzma, lz4 or zstd (default: ROOT's)
+//   output_compression_level 0-9
+//   output_basket_size       basket size in bytes for every branch
+//
+// Used by the OutputWriter on its thread only.
+class OutputSchema
+{
+public:
+  OutputSchema();
+
+  void Configure();                            // master, start of run
+  void ApplyCompression(TFile* file) const;
+  void Book(TTree* tree, EventRecord& buffer); // branch addresses -> buffer
+  void Attach(TTree* tree, EventRecord& buffer); // same, for an existing tree (resume)
+  void Convert(const EventRecord& buffer);     // before each Fill
+  void Report(TTree* tree) const;              // bytes per event
+
+  G4bool Selected(const std::string& name) const;
+  G4bool Float() const { return m_float; }
+  // output_precision compact: the integer hit vector is stored as short
+  G4bool ShortInt(const std::string& name) const;
+  // ROOT compression settings (algorithm * 100 + level), -1 if not set
+  G4int CompressionSettings() const;
+
+private:
+  void Bind(TTree* tree, EventRecord& buffer, G4bool attach);
+  template <typename T>
+  void Vector(TTree* tree, const char* name, std::vector<T>& v, G4bool attach);
+  void Vector(TTree* tree, const char* name, std::vector<G4double>& v,
+              std::vector<float>& compact, G4bool attach);
+  void Vector(TTree* tree, const char* name, std::vector<G4int>& v,
+              std::vector<short>& compact, G4bool attach);
+
+private:
+  std::set<std::string> m_branches; // empty: all
+  G4bool m_drop_redundant;
+  G4bool m_float;
+  G4bool m_compact;
+  G4int m_algorithm;                // -1: ROOT default
+  G4int m_level;
+  G4int m_basket_size;              // 0: ROOT default
+
+  // float copies of the hit vectors (output_precision float)
+  std::vector<float> m_pos_x;
+  std::vector<float> m_pos_y;
+  std::vector<float> m_pos_z;
+  std::vector<float> m_time;
+  std::vector<float> m_energy;
+  std::vector<float> m_wave_length;
+  std::vector<float> m_weight;
+  std::vector<float> m_gen_wave_length;
+
+  // short copies of the integer hit vectors (output_precision compact)
+  std::vector<short> m_particle_id;
+  std::vector<short> m_seg;
+  std::vector<short> m_mppc_segment;
+  std::vector<short> m_detect_flag;
+};
+
+#endif
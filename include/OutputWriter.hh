@@ -0,0 +1,127 @@
+#ifndef OUTPUT_WRITER_HH
+#define OUTPUT_WRITER_HH
+
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "globals.hh"
+
+#include "EventRecord.hh"
+#include "LockFreeQueue.hh"
+#include "OutputNTuple.hh"
+#include "OutputSchema.hh"
+
+class TFile;
+class TTree;
+class TH1D;
+
+// Running npe statistics of the last (or current) run (weighted npe, equal
+// to npe unless photon thinning is enabled).
+struct RunSummary
+{
+  G4long n_events = 0;
+  G4double npe_sum = 0.;
+  G4double npe_sum2 = 0.;
+
+  G4double Mean() const { return n_events > 0 ? npe_sum / n_events : 0.; }
+  G4double RMS() const
+  {
+    if (n_events <= 0) return 0.;
+    G4double mean = Mean();
+    G4double var = npe_sum2 / n_events - mean * mean;
+    return var > 0. ? std::sqrt(var) : 0.;
+  }
+};
+
+// Process-wide owner of the output file. Worker threads push finished
+// EventRecords through a lock-free queue; a single writer thread fills the
+// "tree" in event-ID order, so the content matches a sequential run. The
+// branches, their precision and the compression follow the OutputSchema.
+//
+// With output_mode ntuple the same columns go to an RNTuple (OutputNTuple)
+// instead of the TTree. With output_mode hist, no tree is written. The writer fills fixed-binned
+// histograms instead (npe, hits per MPPC copy, arrival time, trapped
+// photons, generated photons and their wavelength) plus the run moments,
+// and writes only those at the end of the run. With n_segments the npe is
+// also histogrammed per segment (h_npe_seg<i>, by EventRecord::segment) and
+// so are the hits per copy (h_mppc_seg<i>, by EventRecord::mppc_segment).
+//
+// With checkpoint_events the tree or histograms are saved to the file at
+// every checkpoint, and a resumed run (resume 1) appends to them.
+class OutputWriter
+{
+public:
+  static OutputWriter& GetInstance();
+  ~OutputWriter();
+
+private:
+  OutputWriter();
+  OutputWriter(const OutputWriter&);
+  OutputWriter& operator=(const OutputWriter&);
+
+public:
+  void Open(const G4String& path, G4int n_events); // start of run (master)
+  void Close();                    // end of run (master), after all workers
+  // Moves the content of 'event' into a recycled record and enqueues it.
+  // 'event' keeps its scalars and receives empty vectors.
+  void Push(EventRecord& event);
+  // Valid after Close().
+  const RunSummary& GetRunSummary() const { return m_summary; }
+  // Weighted npe by event (index event_id - first event) of the last run;
+  // kept only with common_random_numbers, for paired comparisons of runs.
+  const std::vector<G4double>& GetEventNpe() const { return m_event_npe; }
+
+private:
+  void WriterLoop(G4String path);
+  void Write(EventRecord* record);
+  void BookTree();
+  void BookHistograms();
+  void FillHistograms(const EventRecord& event);
+  void WriteHistograms();
+  void RestoreHistograms();
+  std::vector<TH1D*> Histograms() const;
+  void WriteCheckpoint(const EventRecord& record);
+  void WriteRunInfo();
+  void DrainPending(G4bool flush_all);
+  EventRecord* AcquireRecord();
+  void ReleaseRecord(EventRecord* record);
+
+private:
+  LockFreeQueue<EventRecord*> m_queue;     // workers -> writer
+  LockFreeQueue<EventRecord*> m_free;      // writer -> workers (recycling)
+  std::thread m_thread;
+  std::atomic<bool> m_stop;
+  std::atomic<bool> m_running;
+
+  enum class Mode { kTree, kNTuple, kHist };
+  Mode m_mode;                             // set in Open()
+  G4String m_path;                         // set in Open()
+  G4int m_first_event;                     // first event ID of the run (before a resume)
+  G4int m_end_event;                       // last event ID of the run + 1
+  OutputSchema m_schema;                   // set in Open()
+
+  // Owned by the writer thread only
+  TFile* m_file;
+  TTree* m_tree;
+  OutputNTuple m_ntuple;
+  TH1D* m_h_npe;
+  TH1D* m_h_npe_weighted;
+  TH1D* m_h_mppc;
+  TH1D* m_h_time;
+  TH1D* m_h_trapped;
+  TH1D* m_h_cherenkov_gen;
+  TH1D* m_h_gen_wave_length;
+  std::vector<TH1D*> m_h_npe_segment;      // weighted npe by segment (n_segments)
+  std::vector<TH1D*> m_h_mppc_segment;     // hits per copy by segment (n_segments)
+  EventRecord m_buffer;                    // branch addresses point here
+  std::map<G4int, EventRecord*> m_pending; // out-of-order arrivals
+  G4int m_next_event_id;
+  G4int m_evnum;
+  RunSummary m_summary;
+  std::vector<G4double> m_event_npe;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef PDE_TABLE_HH
+#define PDE_TABLE_HH
+
+#include <algorithm>
+#include <vector>
+
+#include "globals.hh"
+
+// MPPC photon detection efficiency on a dense uniform energy grid.
+//
+// The grid is sampled once from the TSpline3 through KVC_Optical::E_MPPC_PDE /
+// R_MPPC_PDE (the curve MPPCSD used to evaluate per photon). qe_scale and the
+// clamp to 1 are folded into the table by SetScale(), so Value() is a clamp,
+// one multiply and a linear interpolation without data-dependent branches.
+// Energies outside the PDE range take the end-point value, as before.
+class PDETable
+{
+public:
+  PDETable();
+
+  void SetScale(G4double scale);
+  G4double GetScale() const { return m_scale; }
+
+  G4double GetEmin() const { return m_emin; }
+  G4double GetEmax() const { return m_emin + (kNBins - 1) / m_inv_step; }
+
+  inline G4double Value(G4double energy) const
+  {
+    G4double u = (energy - m_emin) * m_inv_step;
+    u = std::min(std::max(u, 0.), G4double(kNBins - 1));
+    const G4int i = (G4int)u;
+    const G4double f = u - i;
+    return m_table[i] + f * (m_table[i + 1] - m_table[i]);
+  }
+
+  // Same interpolation without qe_scale and the clamp (photon history).
+  inline G4double RawValue(G4double energy) const
+  {
+    G4double u = (energy - m_emin) * m_inv_step;
+    u = std::min(std::max(u, 0.), G4double(kNBins - 1));
+    const G4int i = (G4int)u;
+    const G4double f = u - i;
+    return m_raw[i] + f * (m_raw[i + 1] - m_raw[i]);
+  }
+
+private:
+  static const G4int kNBins = 4096;
+
+  G4double m_emin;
+  G4double m_inv_step;
+  G4double m_scale;
+  std::vector<G4double> m_raw;   // unscaled PDE at the grid points (+1 pad)
+  std::vector<G4double> m_table; // min(raw * scale, 1)
+};
+
+#endif
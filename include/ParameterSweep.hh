@@ -0,0 +1,53 @@
+#ifndef PARAMETER_SWEEP_HH
+#define PARAMETER_SWEEP_HH
+
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+
+#include "OutputWriter.hh"
+
+class G4RunManager;
+class DetectorConstruction;
+
+// In-process parameter sweep. Geometry, physics tables and the beam file are
+// built once; between points only the optical tables that depend on the
+// changed conf keys are rebuilt (DetectorConstruction::UpdateOpticalParameters).
+//
+// Sweep file formats (lines starting with '#' are ignored):
+//   list : a header line with the keys, then one line of values per point
+//            qe_scale  teflon_sigma_alpha
+//            1.30      1.60
+//   grid : "grid <key> <v1> <v2> ..." lines, expanded to the full product
+//            grid qe_scale 1.30 1.35 1.40
+//            grid teflon_sigma_alpha 1.60 1.65
+class ParameterSweep
+{
+public:
+  ParameterSweep(G4RunManager* runManager, DetectorConstruction* detector);
+  ~ParameterSweep();
+
+  G4bool LoadPoints(const G4String& filename);
+  // Runs every point with n_events each. Each point writes
+  // "<stem>_pNNN.root" and one row of "<stem>_sweep.tsv".
+  void Run(G4int n_events);
+
+  // Sets the keys to the values (rebuilding only the tables they touch),
+  // runs n_events into 'path' and returns the npe summary of the run. Also
+  // used by Calibration.
+  RunSummary RunPoint(const std::vector<std::string>& keys,
+                      const std::vector<std::string>& values,
+                      G4int n_events, const G4String& path);
+
+  const std::vector<std::string>& GetKeys() const { return m_keys; }
+  G4int GetNumOfPoints() const { return m_points.size(); }
+
+private:
+  G4RunManager* m_run_manager;
+  DetectorConstruction* m_detector;
+  std::vector<std::string> m_keys;
+  std::vector<std::vector<std::string>> m_points;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef PHOTON_HISTORY_HH
+#define PHOTON_HISTORY_HH
+
+// Codes of the per-photon history (photon_history, ph_* branches). Kept free
+// of Geant4 and ROOT so that tools/KVCReweight can share them.
+namespace PhotonHistory
+{
+  // photon_history levels
+  enum Level { kOff = 0, kArrivals = 1, kAll = 2 };
+
+  // ph_fate
+  enum Fate
+  {
+    kDetected = 0,    // reached an MPPC and passed the PDE trial
+    kMissed,          // reached an MPPC and failed it
+    kBulkAbsorbed,    // OpAbsorption in the quartz
+    kQuartzSurface,   // absorbed at the quartz/air surface (REFLECTIVITY)
+    kWrapperSurface,  // absorbed at the wrapper surface (REFLECTIVITY)
+    kKilled,          // Russian roulette or kill oracle
+    kLost,            // anything else: blacksheet, world, other volumes
+  };
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef PHOTON_LUT_HH
+#define PHOTON_LUT_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+// Detection-probability lookup table for Cherenkov photons born in the quartz
+// radiator. A cell is (emission x, y, z, direction dy, direction azimuth,
+// photon energy); for every cell the table holds the number of emitted
+// photons, the number detected per MPPC copy and the arrival-delay spectrum
+// of the detected ones. Copy and delay are sampled independently per cell.
+//
+// The table is produced by a full-tracking "train" run (fastsim_mode train)
+// and consumed by PhotonLUTModel (fastsim_mode lut). It is keyed by the conf
+// values of every geometry/surface parameter, and a table built for another
+// configuration is refused at load time. Emission points are binned in the
+// frame of KvcPV, so a table does not depend on where the radiator is placed.
+class PhotonLUT
+{
+public:
+  PhotonLUT();
+  ~PhotonLUT();
+
+  // Binning and MPPC copy positions from the constructed geometry.
+  void Configure();
+  G4bool IsConfigured() const { return !m_emitted.empty(); }
+
+  // pos in the KvcPV frame
+  G4int FindCell(const G4ThreeVector& pos, const G4ThreeVector& dir, G4double energy) const;
+
+  // Training (world positions)
+  void RecordEmitted(const G4ThreeVector& pos, const G4ThreeVector& dir, G4double energy);
+  void RecordDetected(const G4ThreeVector& pos, const G4ThreeVector& dir, G4double energy,
+                      G4int copy, G4double delay);
+  void Add(const PhotonLUT& other);
+
+  // I/O
+  G4bool Save(const G4String& path) const;
+  G4bool Load(const G4String& path);
+
+  // Sampling (after Load). Returns false when the photon is not detected;
+  // otherwise copy and delay are filled. Cells with fewer than the minimum
+  // number of training photons report IsReliable() == false.
+  G4bool IsReliable(G4int cell) const;
+  G4bool Sample(G4int cell, G4int& copy, G4double& delay) const;
+  G4ThreeVector GetCopyPosition(G4int copy) const;
+
+  // fastsim_mode: "train" (full tracking, fill the table) or "lut"
+  static G4bool TrainingMode();
+  static G4bool LookupMode();
+
+  static std::string ConfigurationKey();
+  static G4String DefaultTablePath();
+
+  // Thread handling for training runs: every worker fills its own table,
+  // workers merge into the shared table at end of run and the master saves.
+  static PhotonLUT* GetThreadTable();
+  static void MergeThreadTable();
+  static void SaveTrainingTable();
+  static const PhotonLUT* GetSharedTable(); // loads lazily, read-only
+  // Between sweep points: reload the shared table in place (models keep
+  // their pointer) when the configuration key has changed.
+  static void UpdateSharedTable();
+
+private:
+  void BuildSamplingTables();
+
+private:
+  // Binning
+  G4int m_nx, m_ny, m_nz, m_ndy, m_nphi, m_ne, m_ncopy, m_nt;
+  G4double m_hx, m_hy, m_hz;
+  G4double m_emin, m_emax;
+  G4double m_tmax;
+  std::vector<G4ThreeVector> m_copy_pos; // relative to m_origin
+  G4ThreeVector m_origin;                // KvcPV centre in the world
+  std::string m_key;
+
+  // Counts
+  std::vector<uint32_t> m_emitted;   // [cell]
+  std::vector<uint32_t> m_detected;  // [cell * ncopy + copy]
+  std::vector<uint32_t> m_delay;     // [cell * nt + bin]
+
+  // Sampling tables (Load only)
+  std::vector<float> m_p_detect;     // [cell]
+  std::vector<float> m_copy_cdf;     // [cell * ncopy + copy]
+  std::vector<float> m_delay_cdf;    // [cell * nt + bin]
+  uint32_t m_min_stat;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef PHOTON_LUT_MODEL_HH
+#define PHOTON_LUT_MODEL_HH
+
+#include "G4VFastSimulationModel.hh"
+
+class PhotonLUT;
+
+// Fast simulation of Cherenkov photons born in the quartz radiator: instead of
+// tracking, the detection at each MPPC copy and the arrival delay are sampled
+// from a PhotonLUT produced by a training run. Photons falling in cells with
+// too few training photons are left to normal tracking.
+class PhotonLUTModel : public G4VFastSimulationModel
+{
+public:
+  PhotonLUTModel(const G4String& name, G4Region* envelope);
+  ~PhotonLUTModel() override;
+
+  G4bool IsApplicable(const G4ParticleDefinition& particle) override;
+  G4bool ModelTrigger(const G4FastTrack& fastTrack) override;
+  void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) override;
+
+private:
+  const PhotonLUT* m_table;
+  G4int m_coll_id;
+  G4int m_cell; // cell of the triggering photon (ModelTrigger -> DoIt)
+};
+
+#endif
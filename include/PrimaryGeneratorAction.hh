@@ -1,14 +1,14 @@
 #ifndef PRIMARYGENERATORACTION_HH
 #define PRIMARYGENERATORACTION_HH
 
+#include <vector>
+
 #include "G4VUserPrimaryGeneratorAction.hh"
 #include "G4ParticleGun.hh"
 #include "G4ParticleTable.hh"
 #include "G4ThreeVector.hh"
 
-// Forward declarations for ROOT classes
-class TFile;
-class TTree;
+class BeamPool;
 
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction {
 public:
@@ -23,14 +23,15 @@ private:
   void GeneratePhoton(G4Event* anEvent);
   void GenerateRootBeam(G4Event* anEvent);
 
-  // ROOT beam members
-  TFile* fRootFile;
-  TTree* fTree;
-  G4int  fMaxEntries;
+  // Segment frame -> layout frame (n_segments); sets fSegment when merged
+  G4ThreeVector ToLayout(const G4ThreeVector& position);
+  G4double BeamYOffset() const;
 
-  // Branch variables
-  G4double fPx, fPy, fPz;
-  G4double fVx, fVy, fVz;
+  // ROOT beam (shared, read-only), one per segment when split
+  std::vector<const BeamPool*> fBeamPools;
+  const BeamPool* fBeamPool;
+  G4int fSegment;   // segment of the current event
+  G4int fSample;    // index passed to BeamPool::Entry
 };
 
 #endif
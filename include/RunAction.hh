@@ -3,6 +3,7 @@
 
 #include "G4UserRunAction.hh"
 #include "G4Run.hh"
+#include "G4Timer.hh"
 
 class RunAction : public G4UserRunAction {
 public:
@@ -10,6 +11,9 @@ public:
   virtual ~RunAction();
   virtual void BeginOfRunAction(const G4Run* aRun);
   virtual void EndOfRunAction(const G4Run* aRun);
+
+private:
+  G4Timer m_timer;
 };
 
 #endif
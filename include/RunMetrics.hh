@@ -0,0 +1,29 @@
+#ifndef RUN_METRICS_HH
+#define RUN_METRICS_HH
+
+#include "globals.hh"
+
+// Throughput counters for benchmarking. Every thread counts into its own
+// thread-local storage; workers add their counts to the process totals at
+// end of run, and the master writes them as JSON when metrics_file is set.
+class RunMetrics
+{
+public:
+  static inline void CountOpticalStep()   { ++t_counts.optical_steps; }
+  static inline void CountPhotonTracked() { ++t_counts.photons_tracked; }
+
+  static void SetLabel(const G4String& label);
+  static void Reset();        // master, begin of run
+  static void MergeThread();  // every event-processing thread, end of run
+  static void Write(const G4String& path, G4int n_events, G4double seconds);
+
+private:
+  struct Counts
+  {
+    G4long optical_steps = 0;
+    G4long photons_tracked = 0;
+  };
+  static G4ThreadLocal Counts t_counts;
+};
+
+#endif
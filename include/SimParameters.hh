@@ -0,0 +1,65 @@
+#ifndef SIM_PARAMETERS_HH
+#define SIM_PARAMETERS_HH
+
+#include <string>
+#include <vector>
+
+#include "globals.hh"
+
+// Typed snapshot of the conf values read on hot paths (per event or per
+// step), in Geant4 units.
+//
+// Resolve() is called on the master once the conf file is loaded, and again
+// whenever ParameterSweep changes keys between runs. It type-checks every
+// known key present in ConfManager, reports unknown keys, and fills the
+// snapshot. Worker threads only read it through Get(), and never while
+// Resolve() runs.
+struct SimParameters
+{
+  // Beam
+  G4bool   photon_gun = false;     // generator photon: single optical photons
+  G4String particle;
+  G4double momentum = 0.;
+  G4double beam_y_offset = 0.;
+  G4double quartz_thickness = 0.;
+  G4int    first_event = 0;        // ID of the first event of a run (job split, resume)
+
+  // Optics / detection
+  G4int    quartz_finish = 0;      // 0: polished, 1: ground
+  G4double qe_scale = 1.;
+
+  // Variance reduction
+  G4double photon_thinning = 1.;   // 1 = off
+  G4double roulette_length = 0.;   // 0 = off
+  G4double roulette_survival = 1.;
+  G4bool   kill_oracle = false;
+  G4double kill_epsilon = 0.;
+
+  // Output
+  enum GenWavelengthMode { kGenWavelengthVector, kGenWavelengthHist, kGenWavelengthOff };
+  G4int    gen_wavelength_mode = kGenWavelengthVector;
+  G4int    photon_history = 0;     // PhotonHistory::Level
+
+  // Segments (n_segments > 0: all segments side by side in one world). The
+  // per-segment vectors have NSegments() entries, from "seg<i>.<key>" or
+  // <key>; in single-segment mode they hold the global values.
+  static const G4int kMaxSegments = 8;
+  G4int    n_segments = 0;
+  G4double segment_pitch = 0.;     // distance between segment centres along x
+  G4bool   segment_beam_merged = false; // one input_beam_file in the layout frame
+  std::vector<G4double> segment_qe_scale;
+  std::vector<G4int>    segment_quartz_finish;
+  std::vector<G4double> segment_beam_y_offset;
+
+  G4int NSegments() const { return n_segments > 0 ? n_segments : 1; }
+  G4double SegmentOffset(G4int segment) const;   // x of the segment centre
+  G4int SegmentAt(G4double x) const;             // segment under x (clamped)
+  // "seg<i>.<key>" when set in multi-segment mode, <key> otherwise
+  std::string SegmentKey(G4int segment, const std::string& key) const;
+
+  static const SimParameters& Get();
+  static void Resolve();
+  static G4bool IsKnownKey(const std::string& key);
+};
+
+#endif
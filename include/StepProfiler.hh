@@ -0,0 +1,90 @@
+#ifndef STEP_PROFILER_HH
+#define STEP_PROFILER_HH
+
+// Per-volume / per-process step accounting, compiled in only with
+// -DKVC_INSTRUMENT (CMake option KVC_INSTRUMENT). Without it the
+// KVC_PROFILE_* macros expand to nothing.
+//
+// Each thread counts the following:
+//   - steps per (volume role, post-step process);
+//   - optical boundary statuses per volume role;
+//   - new tracks per (volume role, creator process);
+//   - sampled wall time per volume role and per process. Every
+//     kSampleEvery-th step is timed, from the previous stepping-action call,
+//     and the result is scaled up;
+//   - pool allocations of MPPCHit and KVC_TrackInfo, and the size of the
+//     per-thread pools.
+// Workers merge at end of run. The master prints a table and writes JSON
+// to profile_file (default kvc_profile.json).
+
+#ifdef KVC_INSTRUMENT
+
+#include <vector>
+
+#include "globals.hh"
+#include "G4OpBoundaryProcess.hh"
+
+class G4Step;
+class G4Track;
+class G4VProcess;
+
+class StepProfiler
+{
+public:
+  enum AllocKind { kAllocHit = 0, kAllocTrackInfo, kNAllocKinds };
+
+  static StepProfiler& ThreadInstance();
+  static void CountAllocation(AllocKind kind) { ++ThreadInstance().m_allocs[kind]; }
+
+  void Step(const G4Step* step);
+  void Boundary(const G4Step* step, G4OpBoundaryProcessStatus status);
+  void NewTrack(const G4Track* track);
+
+  static void Reset();        // master, begin of run
+  static void MergeThread();  // every event-processing thread, end of run
+  static void Report();       // master, end of run
+
+private:
+  StepProfiler();
+
+  static const G4int kSampleEvery = 64;
+  static const G4int kNStatus = 64;
+
+  G4int ProcessIndex(const G4VProcess* process);
+
+  std::vector<const G4VProcess*> m_processes;
+  std::vector<G4String> m_process_names;
+  // [role][process]
+  std::vector<std::vector<G4long>> m_steps;
+  std::vector<std::vector<G4long>> m_tracks;
+  std::vector<std::vector<G4double>> m_time; // seconds (scaled)
+  // [role][status]
+  std::vector<std::vector<G4long>> m_status;
+  G4long m_allocs[kNAllocKinds];
+
+  G4long m_counter;
+  G4double m_t0;
+  G4bool m_timing;
+};
+
+#define KVC_PROFILE_STEP(step)              StepProfiler::ThreadInstance().Step(step)
+#define KVC_PROFILE_BOUNDARY(step, status)  StepProfiler::ThreadInstance().Boundary(step, status)
+#define KVC_PROFILE_NEW_TRACK(track)        StepProfiler::ThreadInstance().NewTrack(track)
+#define KVC_PROFILE_ALLOC(kind)             StepProfiler::CountAllocation(kind)
+#define KVC_PROFILE_RESET()                 StepProfiler::Reset()
+#define KVC_PROFILE_MERGE()                 StepProfiler::MergeThread()
+#define KVC_PROFILE_REPORT()                StepProfiler::Report()
+
+#else
+
+#define KVC_PROFILE_STEP(step)              ((void)0)
+#define KVC_PROFILE_BOUNDARY(step, status)  ((void)0)
+#define KVC_PROFILE_NEW_TRACK(track)        ((void)0)
+#define KVC_PROFILE_ALLOC(kind)             ((void)0)
+#define KVC_PROFILE_RESET()                 ((void)0)
+#define KVC_PROFILE_MERGE()                 ((void)0)
+#define KVC_PROFILE_REPORT()                ((void)0)
+
+#endif
+
+#endif
@@ -3,6 +3,9 @@
 
 #include "G4UserSteppingAction.hh"
 #include "globals.hh"
+#include "G4ThreeVector.hh"
+#include "G4OpBoundaryProcess.hh"
+#include "PDETable.hh"
 
 class G4Step;
 class G4Track;
@@ -16,11 +19,32 @@ public:
   virtual ~SteppingAction();
 
   virtual void UserSteppingAction(const G4Step* step);
-  
+
+  // Reasons for the kill oracle (kill_oracle 1)
+  enum KillReason { kNotKilled = 0, kKillBlacksheet, kKillTrapped };
+
 private:
+  void CacheGeometry();
+  void UpdateHistory(const G4Step* step, G4OpBoundaryProcessStatus status, G4bool oracle_killed);
+  void EndHistory(const G4Track* track, G4int fate);
+  void CountTrapped(const G4Step* step);
+  KillReason KillUndetectable(const G4Step* step, G4OpBoundaryProcessStatus status,
+                              G4double& prob_bound);
+  
   G4OpBoundaryProcess* fOpProcess;
-  G4VPhysicalVolume* fAirVol;
-  G4VPhysicalVolume* fWrapVol;
+  G4int fMppcCollID;
+  // Kill oracle
+  G4bool fGeometryCached;
+  G4bool fGeometryOK;
+  G4ThreeVector fKvcHalf;     // quartz half lengths
+  G4ThreeVector fInnerHalf;   // wrapper + MPPCs bounding box (everything but blacksheet)
+  G4bool fBlacksheetRule;     // blacksheet reflectivity is zero
+  G4bool fAirGap;             // quartz/air boundary (air_layer_thickness > 0)
+
+#ifdef USE_SURFACE_PDE
+  PDETable fPDE;              // Method A detection at the MPPC surface
+  G4bool fMppcEfficiency;     // MppcLV has an EFFICIENCY skin surface
+#endif
 };
 
 #endif
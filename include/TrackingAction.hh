@@ -0,0 +1,21 @@
+#ifndef TrackingAction_h
+#define TrackingAction_h
+
+#include "G4UserTrackingAction.hh"
+#include "globals.hh"
+
+class G4Track;
+
+// Registered only with common_random_numbers 1: gives every track its own
+// random stream (EventSeeder::SeedTrack), so parameter variants stay
+// correlated photon by photon.
+class TrackingAction : public G4UserTrackingAction
+{
+public:
+  TrackingAction();
+  virtual ~TrackingAction();
+
+  virtual void PreUserTrackingAction(const G4Track* track);
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef VOLUME_REGISTRY_HH
+#define VOLUME_REGISTRY_HH
+
+#include <vector>
+
+#include "globals.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+
+// Role of a volume in the KVC setup.
+enum class VolumeRole : G4int
+{
+  kOther = 0,
+  kWorld,
+  kRadiator,   // KvcLV (quartz)
+  kAirGap,     // KvcMotherLV (air around the radiator)
+  kWrapper,    // WrapLV
+  kMppc,       // MppcLV (all copies)
+  kBlacksheet, // BlacksheetLV
+  kNRoles
+};
+
+// Maps logical volumes to roles by their instance ID, so that stepping and
+// stacking code classifies volumes with a table lookup instead of comparing
+// names. Build() is called once at the end of DetectorConstruction::Construct
+// (master thread); the geometry is shared, so workers only read.
+class VolumeRegistry
+{
+public:
+  static void Build();
+
+  static inline VolumeRole Role(const G4LogicalVolume* lv)
+  {
+    if (!lv) return VolumeRole::kOther;
+    const std::size_t id = lv->GetInstanceID();
+    return (id < s_roles.size()) ? s_roles[id] : VolumeRole::kOther;
+  }
+  static inline VolumeRole Role(const G4VPhysicalVolume* pv)
+  {
+    return pv ? Role(pv->GetLogicalVolume()) : VolumeRole::kOther;
+  }
+
+  // First placement with the given role (nullptr if none).
+  static G4VPhysicalVolume* Volume(VolumeRole role);
+
+private:
+  static std::vector<VolumeRole> s_roles;  // indexed by logical-volume instance ID
+  static G4VPhysicalVolume* s_volumes[(G4int)VolumeRole::kNRoles];
+};
+
+#endif
@@ -1,67 +1,170 @@
 #include "DetectorConstruction.hh"
 #include "ActionInitialization.hh"
 #include "AnaManager.hh"
+#include "Calibration.hh"
+#include "Checkpoint.hh"
+#include "CherenkovTable.hh"
+#include "EventSeeder.hh"
 #include "RunAction.hh"
 #include "ConfManager.hh"
+#include "ParameterSweep.hh"
+#include "SimParameters.hh"
+#include "RunMetrics.hh"
     
 #include "FTFP_BERT.hh"
 #include "QGSP_BERT.hh"
 #include "G4EmStandardPhysics_option4.hh"
 #include "G4OpticalPhysics.hh"
-#include "G4RunManager.hh"
+#include "G4RunManagerFactory.hh"
 #include "G4Types.hh"
 #include "G4UIExecutive.hh"
 #include "G4UImanager.hh"
 #include "G4VisExecutive.hh"
 #include "G4Cerenkov.hh"
 #include "G4DecayPhysics.hh"
+#include "G4FastSimulationPhysics.hh"
+#include "PhotonLUT.hh"
 
-#include <random>
+#include "TROOT.h"
+
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace
 {
-  auto& gAnaMan  = AnaManager::GetInstance();
   auto& gConfMan = ConfManager::GetInstance();
   void PrintUsage()
   {
     G4cerr << " Usage: " << G4endl
 	   << " KVCOpticalSim <conf file> <output rootfile name> [macro]"
+           << " [--first-event F] [--n-events N] [--job-index I --n-jobs J]"
+           << G4endl
+           << " (a conf with 'sweep_file' runs an in-process parameter sweep)"
+           << G4endl
+           << " (a conf with 'calib_file' runs a surrogate-model calibration)"
+           << G4endl
+           << " (a conf with 'resume 1' finishes the run checkpointed in"
+           << " <output rootfile name>.ckpt; the macro is not executed)"
+           << G4endl
+           << " (a conf with 'replay_event' runs that single event)"
+           << G4endl
+           << " (--n-events runs N events from F without the macro; with"
+           << " --n-jobs, N is split into J shards and job I runs shard I)"
            << G4endl;
   }
+
+  // Job options are stored as conf keys (first_event, n_events, job_index,
+  // n_jobs), so a conf file may carry them as well.
+  G4bool ParseJobOption(const G4String& option, const G4String& value)
+  {
+    static const std::pair<const char*, const char*> kOptions[] = {
+      { "--first-event", "first_event" },
+      { "--n-events",    "n_events"    },
+      { "--job-index",   "job_index"   },
+      { "--n-jobs",      "n_jobs"      },
+    };
+    for (const auto& opt : kOptions) {
+      if (option != opt.first) continue;
+      gConfMan.Set(opt.second, value);
+      return true;
+    }
+    return false;
+  }
+
+  // Contiguous shard of [first_event, first_event + n_events) for job_index.
+  // Split jobs must share the master seed (KVCMerge checks it), so a
+  // randomized one is refused before anything runs.
+  G4bool ShardEvents()
+  {
+    if ((gConfMan.Check("n_jobs") || gConfMan.Check("first_event")) && !gConfMan.Check("seed")) {
+      G4cerr << "Error: --n-jobs and --first-event need a fixed 'seed' in the conf" << G4endl;
+      return false;
+    }
+    if (!gConfMan.Check("n_jobs")) return true;
+    const G4long n_jobs = gConfMan.GetInt("n_jobs");
+    const G4long index  = gConfMan.Check("job_index") ? gConfMan.GetInt("job_index") : -1;
+    if (!gConfMan.Check("n_events") || n_jobs < 1 || index < 0 || index >= n_jobs) {
+      G4cerr << "Error: --n-jobs needs --n-events and 0 <= --job-index < --n-jobs" << G4endl;
+      return false;
+    }
+    const G4long total = gConfMan.GetInt("n_events");
+    const G4long first = gConfMan.Check("first_event") ? gConfMan.GetInt("first_event") : 0;
+    const G4long begin = first + index * total / n_jobs;
+    const G4long end   = first + (index + 1) * total / n_jobs;
+    gConfMan.Set("first_event", std::to_string(begin));
+    gConfMan.Set("n_events", std::to_string(end - begin));
+    G4cout << "Job " << index << "/" << n_jobs << ": events " << begin
+           << " to " << end - 1 << G4endl;
+    return true;
+  }
 }  // namespace
 
 int main(int argc, char** argv)
 {
-  if (argc < 3 || argc > 4) {
+  std::vector<G4String> args;
+  std::vector<std::pair<G4String, G4String>> options;
+  for (G4int i = 1; i < argc; ++i) {
+    G4String arg = argv[i];
+    if (!G4StrUtil::starts_with(arg, "--")) {
+      args.push_back(arg);
+    } else if (i + 1 < argc) {
+      options.emplace_back(arg, argv[++i]);
+    } else {
+      G4cerr << "Error: option " << arg << " needs a value" << G4endl;
+      PrintUsage();
+      return 1;
+    }
+  }
+  if (args.size() < 2 || args.size() > 3) {
     PrintUsage();
     return 1;
   }
-  gConfMan.LoadConfigFile(argv[1]); 
-  gAnaMan.SetOutputRootfilePath(argv[2]);
+  gConfMan.LoadConfigFile(args[0]);
+  for (const auto& option : options) {
+    if (!ParseJobOption(option.first, option.second)) {
+      G4cerr << "Error: unknown option " << option.first << G4endl;
+      PrintUsage();
+      return 1;
+    }
+  }
+  if (!ShardEvents()) return 1;
+  Checkpoint::Configure(args[1]);
+  EventSeeder::Configure();
+  SimParameters::Resolve();
+  RunMetrics::SetLabel(args[0]);
+  AnaManager::SetOutputRootfilePath(args[1]);
   
   G4String macro;
-  if (argc == 4) macro = argv[3];
+  if (args.size() == 3) macro = args[2];
 
+  // Batch modes that do not execute the macro
+  const G4bool n_events_batch = gConfMan.Check("n_events");
   G4UIExecutive* ui = nullptr;
-  if (macro.empty())
+  if (macro.empty() && !Checkpoint::Resuming() && !EventSeeder::Replaying() && !n_events_batch)
   {
     ui = new G4UIExecutive(argc, argv);
   }
 
-  auto runManager = new G4RunManager();
+  // Threading: "threads" <= 1 keeps the sequential run manager.
+  G4int n_threads = 1;
+  if (gConfMan.Check("threads")) n_threads = gConfMan.GetInt("threads");
+  if (n_threads < 1) n_threads = 1;
 
-  std::random_device rd;
-  long seed;
-  if (gConfMan.Check("seed")) {
-      seed = gConfMan.GetInt("seed");
-      G4cout << "Random seed: " << seed << " (Fixed from config)" << G4endl;
+  // ROOT is used concurrently by the output writer thread and the workers.
+  ROOT::EnableThreadSafety();
+
+  G4RunManager* runManager = nullptr;
+  if (n_threads > 1) {
+    runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::Default);
+    runManager->SetNumberOfThreads(n_threads);
+    G4cout << "Worker threads: " << n_threads << G4endl;
   } else {
-      seed = rd();
-      G4cout << "Random seed: " << seed << " (Randomized)" << G4endl;
+    runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::SerialOnly);
   }
-  G4Random::setTheSeed(seed);
 
-  runManager->SetUserInitialization(new DetectorConstruction());
+  auto detector = new DetectorConstruction();
+  runManager->SetUserInitialization(detector);
 
   // Physics List setting
   // G4VModularPhysicsList* physicsList = new FTFP_BERT;
@@ -70,6 +173,11 @@ int main(int argc, char** argv)
   auto opticalPhysics = new G4OpticalPhysics();
   physicsList->RegisterPhysics(opticalPhysics);
   if (gConfMan.GetInt("decay") == 1) physicsList->RegisterPhysics(new G4DecayPhysics());
+  if (PhotonLUT::LookupMode()) {
+    auto fastSimPhysics = new G4FastSimulationPhysics();
+    fastSimPhysics->ActivateFastSimulation("opticalphoton");
+    physicsList->RegisterPhysics(fastSimPhysics);
+  }
   runManager->SetUserInitialization(physicsList);
 
   // G4Cerenkov setting
@@ -83,6 +191,8 @@ int main(int argc, char** argv)
     
   runManager->SetUserInitialization(new ActionInitialization());
   runManager->Initialize();
+  // Built here, before any worker reads it
+  CherenkovTable::Get().Print();
 
   
   G4VisManager* visManager = new G4VisExecutive("Quiet");
@@ -91,7 +201,36 @@ int main(int argc, char** argv)
   G4UImanager* UImanager = G4UImanager::GetUIpointer();
 
 
-  if (!macro.empty())
+  if (gConfMan.Check("sweep_file"))
+  {
+    // In-process parameter sweep (batch only)
+    ParameterSweep sweep(runManager, detector);
+    G4int n_events = 1000;
+    if (gConfMan.Check("sweep_events")) n_events = gConfMan.GetInt("sweep_events");
+    if (sweep.LoadPoints(gConfMan.Get("sweep_file"))) sweep.Run(n_events);
+    delete ui;
+  }
+  else if (gConfMan.Check("calib_file"))
+  {
+    // Surrogate-model calibration (batch only)
+    Calibration calibration(runManager, detector);
+    if (calibration.Load(gConfMan.Get("calib_file"))) calibration.Run();
+    delete ui;
+  }
+  else if (Checkpoint::Resuming())
+  {
+    // Remaining events of the interrupted run (batch only)
+    runManager->BeamOn(Checkpoint::RemainingEvents());
+  }
+  else if (EventSeeder::Replaying())
+  {
+    runManager->BeamOn(1);
+  }
+  else if (n_events_batch)
+  {
+    runManager->BeamOn(gConfMan.GetInt("n_events"));
+  }
+  else if (!macro.empty())
   {
     G4String command = "/control/execute ";
     UImanager->ApplyCommand(command + macro);
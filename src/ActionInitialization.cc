@@ -6,6 +6,8 @@
 #include "EventAction.hh"
 #include "SteppingAction.hh"
 #include "StackingAction.hh"
+#include "TrackingAction.hh"
+#include "EventSeeder.hh"
 
 //_____________________________________________________________________________
 ActionInitialization::ActionInitialization()
@@ -32,4 +34,5 @@ ActionInitialization::Build() const
   SetUserAction(new EventAction);
   SetUserAction(new SteppingAction);
   SetUserAction(new StackingAction);
+  if (EventSeeder::CommonRandomNumbers()) SetUserAction(new TrackingAction);
 }
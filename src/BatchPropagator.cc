@@ -0,0 +1,570 @@
+#include "BatchPropagator.hh"
+#include "ConfManager.hh"
+#include "SimParameters.hh"
+#include "VolumeRegistry.hh"
+
+#include "G4Box.hh"
+#include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4Exception.hh"
+#include "G4HCofThisEvent.hh"
+#include "G4LogicalBorderSurface.hh"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4OpticalSurface.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4RandomTools.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
+#include "G4SDManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+
+  G4ThreadLocal BatchPropagator* tInstance = nullptr;
+
+  const G4int kNGrid = 1024;          // energy grid of the optical tables
+  const G4int kMaxBounces = 100000;   // safety stop for photons that are never absorbed
+  const G4double kTolerance = 1.e-6 * CLHEP::mm;
+
+  enum { kAbsorbed = 0, kReflected, kTransmitted };
+
+  G4int CurrentRunID()
+  {
+    const G4Run* run = G4RunManager::GetRunManager()->GetCurrentRun();
+    return run ? run->GetRunID() : -1;
+  }
+
+  // Property sampled on the grid (+1 pad for the interpolation); G4's Value()
+  // clamps outside the table as the tracking does.
+  std::vector<G4double> Sample(const G4MaterialPropertyVector* property,
+                               G4double emin, G4double step, G4double fallback)
+  {
+    std::vector<G4double> table(kNGrid + 1, fallback);
+    if (!property) return table;
+    for (G4int i = 0; i <= kNGrid; ++i)
+      table[i] = property->Value(emin + std::min(i, kNGrid - 1) * step);
+    return table;
+  }
+
+  const G4OpticalSurface* BorderSurface(const G4VPhysicalVolume* from, const G4VPhysicalVolume* to)
+  {
+    auto border = G4LogicalBorderSurface::GetSurface(from, to);
+    return border ? dynamic_cast<const G4OpticalSurface*>(border->GetSurfaceProperty()) : nullptr;
+  }
+
+  G4double RefractiveIndex(const G4Material* material, G4double energy)
+  {
+    auto mpt = material ? material->GetMaterialPropertiesTable() : nullptr;
+    auto rindex = mpt ? mpt->GetProperty("RINDEX") : nullptr;
+    return rindex ? rindex->Value(energy) : 1.;
+  }
+}
+
+//_____________________________________________________________________________
+BatchPropagator::BatchPropagator()
+  : m_run_id(-1), m_coll_id(-1), m_hits(nullptr),
+    m_half{ 0., 0., 0. }, m_gap(0.),
+    m_emin(0.), m_inv_step(0.), m_n_air(1.), m_n_mppc(1.),
+    m_capacity(0), m_size(0)
+{
+  Resize(gConfMan.Check("fastsim_batch") ? std::max(gConfMan.GetInt("fastsim_batch"), 1) : 4096);
+}
+
+//_____________________________________________________________________________
+BatchPropagator::~BatchPropagator()
+{
+}
+
+//_____________________________________________________________________________
+G4bool BatchPropagator::Enabled()
+{
+  static const G4bool batch = gConfMan.Check("fastsim_mode") && gConfMan.Get("fastsim_mode") == "batch";
+  return batch;
+}
+
+//_____________________________________________________________________________
+BatchPropagator* BatchPropagator::GetThreadInstance()
+{
+  if (!tInstance) tInstance = new BatchPropagator;
+  return tInstance;
+}
+
+//_____________________________________________________________________________
+// Geometry and optical tables as built by DetectorConstruction. Re-read at
+// every run: sweep points replace the surface and material tables.
+void BatchPropagator::Configure()
+{
+  m_run_id = CurrentRunID();
+
+  auto kvc_pv    = VolumeRegistry::Volume(VolumeRole::kRadiator);
+  auto mother_pv = VolumeRegistry::Volume(VolumeRole::kAirGap);
+  auto wrap_pv   = VolumeRegistry::Volume(VolumeRole::kWrapper);
+  auto kvc_box   = kvc_pv ? dynamic_cast<G4Box*>(kvc_pv->GetLogicalVolume()->GetSolid()) : nullptr;
+  if (!kvc_box || !mother_pv || !wrap_pv) {
+    G4Exception("BatchPropagator::Configure", "NoRadiator", FatalException,
+                "KvcPV (G4Box), KvcMotherPV and WrapPV are required for fastsim_mode batch.");
+    return;
+  }
+  m_half[0] = kvc_box->GetXHalfLength();
+  m_half[1] = kvc_box->GetYHalfLength();
+  m_half[2] = kvc_box->GetZHalfLength();
+  // Neither volume is rotated (ConstructKVC).
+  const G4ThreeVector kvc_pos = kvc_pv->GetTranslation();
+  m_origin = mother_pv->GetTranslation() + kvc_pos;
+  m_gap = gConfMan.GetDouble("air_layer_thickness") * mm;
+
+  // Quartz bulk
+  auto quartz_mpt = kvc_pv->GetLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
+  auto rindex = quartz_mpt ? quartz_mpt->GetProperty("RINDEX") : nullptr;
+  if (!rindex) {
+    G4Exception("BatchPropagator::Configure", "NoRindex", FatalException,
+                "The radiator material has no RINDEX.");
+    return;
+  }
+  m_emin = rindex->GetMinEnergy();
+  const G4double step = (rindex->GetMaxEnergy() - m_emin) / (kNGrid - 1);
+  m_inv_step = 1. / step;
+  m_rindex    = Sample(rindex, m_emin, step, 1.);
+  m_abslength = Sample(quartz_mpt->GetProperty("ABSLENGTH"), m_emin, step, DBL_MAX);
+  // Group velocity c / (n + E dn/dE), as G4 derives GROUPVEL from RINDEX
+  m_groupvel.assign(kNGrid + 1, 0.);
+  for (G4int i = 0; i <= kNGrid; ++i) {
+    const G4double e = m_emin + std::min(i, kNGrid - 1) * step;
+    const G4double n = rindex->Value(e);
+    const G4double dn = (rindex->Value(e + 0.5 * step) - rindex->Value(e - 0.5 * step)) / step;
+    const G4double vg = c_light / (n + e * dn);
+    m_groupvel[i] = (vg > 0. && vg <= c_light) ? vg : c_light / n;
+  }
+  const G4double e_mid = m_emin + 0.5 * (kNGrid - 1) * step;
+  m_n_air = RefractiveIndex(mother_pv->GetLogicalVolume()->GetMaterial(), e_mid);
+
+  // Surfaces
+  m_quartz = m_wrapper = m_end = Surface();
+  if (m_gap > 0.) {
+    ReadSurface(BorderSurface(kvc_pv, mother_pv), m_quartz);
+    ReadSurface(BorderSurface(mother_pv, wrap_pv), m_wrapper);
+    m_end = m_quartz; // QuartzToAir covers the Y faces too
+  } else {
+    ReadSurface(BorderSurface(kvc_pv, wrap_pv), m_quartz);
+  }
+  const Surface& wrapper = (m_gap > 0.) ? m_wrapper : m_quartz;
+  if (!wrapper.metal && !wrapper.painted) {
+    G4Exception("BatchPropagator::Configure", "WrapType", FatalException,
+                "fastsim_mode batch needs a reflecting wrapper surface (wrap_type 0, 1 or 2).");
+    return;
+  }
+
+  // MPPC windows on the +-Y faces. The copies are placed in KvcMotherPV.
+  m_copies.clear();
+  for (auto pv : *G4PhysicalVolumeStore::GetInstance()) {
+    if (VolumeRegistry::Role(pv) != VolumeRole::kMppc) continue;
+    auto box = dynamic_cast<G4Box*>(pv->GetLogicalVolume()->GetSolid());
+    if (!box) continue;
+    m_n_mppc = RefractiveIndex(pv->GetLogicalVolume()->GetMaterial(), e_mid);
+
+    const G4RotationMatrix rot = pv->GetObjectRotationValue();
+    const G4ThreeVector centre = pv->GetTranslation() - kvc_pos;
+    const G4double h[3] = { box->GetXHalfLength(), box->GetYHalfLength(), box->GetZHalfLength() };
+    G4double ext[3];
+    for (G4int a = 0; a < 3; ++a)
+      ext[a] = std::fabs(rot(a, 0)) * h[0] + std::fabs(rot(a, 1)) * h[1] + std::fabs(rot(a, 2)) * h[2];
+    if (std::fabs(std::fabs(centre.y()) - ext[1] - m_half[1]) > kTolerance) continue;
+
+    Copy copy;
+    copy.copy = pv->GetCopyNo();
+    copy.side = centre.y() > 0. ? 1 : -1;
+    copy.x0 = centre.x() - ext[0];
+    copy.x1 = centre.x() + ext[0];
+    copy.z0 = centre.z() - ext[2];
+    copy.z1 = centre.z() + ext[2];
+    copy.to_local = G4AffineTransform(rot.inverse(), centre).Inverse();
+    m_copies.push_back(copy);
+  }
+  if (m_copies.empty()) {
+    G4Exception("BatchPropagator::Configure", "NoMppc", JustWarning,
+                "No MPPC on the Y faces of the radiator: nothing can be detected.");
+  }
+}
+
+//_____________________________________________________________________________
+void BatchPropagator::ReadSurface(const G4OpticalSurface* surface, Surface& out) const
+{
+  out = Surface();
+  if (!surface) return; // no optical surface: polished Fresnel boundary
+  const G4OpticalSurfaceFinish finish = surface->GetFinish();
+  out.metal    = (surface->GetType() == dielectric_metal);
+  out.painted  = (finish == groundfrontpainted || finish == polishedfrontpainted);
+  out.polished = (finish == polished || finish == polishedfrontpainted);
+  out.sigma_alpha = surface->GetSigmaAlpha();
+
+  auto mpt = surface->GetMaterialPropertiesTable();
+  if (!mpt) return;
+  auto constant = [mpt](const char* key) {
+    return mpt->ConstPropertyExists(key) ? mpt->GetConstProperty(key) : 0.;
+  };
+  out.prob_ss = constant("SPECULARSPIKECONSTANT");
+  out.prob_sl = constant("SPECULARLOBECONSTANT");
+  out.prob_bs = constant("BACKSCATTERCONSTANT");
+  if (auto reflectivity = mpt->GetProperty("REFLECTIVITY"))
+    out.reflectivity = Sample(reflectivity, m_emin, 1. / m_inv_step, 1.);
+}
+
+//_____________________________________________________________________________
+G4double BatchPropagator::Table(const std::vector<G4double>& table, G4double energy) const
+{
+  G4double u = (energy - m_emin) * m_inv_step;
+  u = std::min(std::max(u, 0.), G4double(kNGrid - 1));
+  const G4int i = (G4int)u;
+  const G4double f = u - i;
+  return table[i] + f * (table[i + 1] - table[i]);
+}
+
+//_____________________________________________________________________________
+void BatchPropagator::Add(const G4Track* track)
+{
+  if (m_run_id != CurrentRunID()) Configure();
+  if (m_size == m_capacity) Flush();
+
+  const G4int i = m_size++;
+  const G4ThreeVector pos = track->GetPosition() - m_origin;
+  const G4ThreeVector& dir = track->GetMomentumDirection();
+  m_x[i]  = pos.x();
+  m_y[i]  = pos.y();
+  m_z[i]  = pos.z();
+  m_dx[i] = dir.x();
+  m_dy[i] = dir.y();
+  m_dz[i] = dir.z();
+  m_t[i]  = track->GetGlobalTime();
+  m_energy[i] = track->GetKineticEnergy();
+  m_weight[i] = track->GetWeight();
+}
+
+//_____________________________________________________________________________
+void BatchPropagator::Flush()
+{
+  if (m_size == 0) return;
+
+  const G4Event* event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+  G4HCofThisEvent* HCTE = event ? event->GetHCofThisEvent() : nullptr;
+  if (m_coll_id < 0) m_coll_id = G4SDManager::GetSDMpointer()->GetCollectionID("MppcCollection");
+  m_hits = (HCTE && m_coll_id >= 0)
+    ? static_cast<G4THitsCollection<MPPCHit>*>(HCTE->GetHC(m_coll_id)) : nullptr;
+  if (!m_hits) {
+    m_size = 0;
+    return;
+  }
+  m_pde.SetScale(SimParameters::Get().qe_scale);
+
+  // Per-photon optics and the path to bulk absorption
+  G4Random::getTheEngine()->flatArray(m_size, m_uniform.data());
+  for (G4int i = 0; i < m_size; ++i) {
+    m_n[i]   = Table(m_rindex, m_energy[i]);
+    m_vg[i]  = Table(m_groupvel, m_energy[i]);
+    m_abs[i] = -std::log(m_uniform[i]) * Table(m_abslength, m_energy[i]);
+    m_bounces[i] = 0;
+  }
+
+  G4int n = m_size;
+  while (n > 0) {
+    Transport(n);
+    for (G4int i = 0; i < n; ++i)
+      if (!Boundary(i)) m_face[i] = -1;
+    Compact(n);
+  }
+  m_size = 0;
+  m_hits = nullptr;
+}
+
+//_____________________________________________________________________________
+// Moves every live photon to the next face of the radiator, or to its
+// absorption point. No data-dependent branches: the selects compile to
+// blends and the loop vectorizes.
+void BatchPropagator::Transport(G4int n)
+{
+  const G4double hx = m_half[0], hy = m_half[1], hz = m_half[2];
+  G4double* __restrict x   = m_x.data();
+  G4double* __restrict y   = m_y.data();
+  G4double* __restrict z   = m_z.data();
+  const G4double* __restrict dx = m_dx.data();
+  const G4double* __restrict dy = m_dy.data();
+  const G4double* __restrict dz = m_dz.data();
+  G4double* __restrict t   = m_t.data();
+  const G4double* __restrict vg = m_vg.data();
+  G4double* __restrict to_abs = m_abs.data();
+  G4int* __restrict face   = m_face.data();
+
+  for (G4int i = 0; i < n; ++i) {
+    // Path to the face ahead on each axis (none when moving parallel to it)
+    const G4double sx = (dx[i] != 0.) ? (std::copysign(hx, dx[i]) - x[i]) / dx[i] : DBL_MAX;
+    const G4double sy = (dy[i] != 0.) ? (std::copysign(hy, dy[i]) - y[i]) / dy[i] : DBL_MAX;
+    const G4double sz = (dz[i] != 0.) ? (std::copysign(hz, dz[i]) - z[i]) / dz[i] : DBL_MAX;
+    G4double s = sx;
+    G4int f = (dx[i] > 0.) ? 1 : 0;
+    f = (sy < s) ? ((dy[i] > 0.) ? 3 : 2) : f;
+    s = (sy < s) ? sy : s;
+    f = (sz < s) ? ((dz[i] > 0.) ? 5 : 4) : f;
+    s = (sz < s) ? sz : s;
+
+    const G4bool absorbed = to_abs[i] < s;
+    s = absorbed ? to_abs[i] : s;
+    x[i] += s * dx[i];
+    y[i] += s * dy[i];
+    z[i] += s * dz[i];
+    t[i] += s / vg[i];
+    to_abs[i] -= s;
+    face[i] = absorbed ? -1 : f;
+  }
+}
+
+//_____________________________________________________________________________
+// Interaction of photon i with the face it reached. Returns false when the
+// photon is gone (absorbed, detected or escaped).
+G4bool BatchPropagator::Boundary(G4int i)
+{
+  const G4int face = m_face[i];
+  if (face < 0) return false;                 // bulk absorption
+  if (++m_bounces[i] > kMaxBounces) return false;
+
+  const G4int axis = face / 2;
+  const G4double sign = (face % 2) ? 1. : -1.;
+  G4ThreeVector pos(m_x[i], m_y[i], m_z[i]);
+  G4ThreeVector dir(m_dx[i], m_dy[i], m_dz[i]);
+  pos[axis] = sign * m_half[axis];
+  G4ThreeVector normal;
+  normal[axis] = -sign;                       // back into the radiator, against the photon
+  const G4double energy = m_energy[i];
+
+  if (axis == 1) {
+    const Copy* window = nullptr;
+    for (const auto& copy : m_copies) {
+      if (copy.side == (G4int)sign && pos.x() >= copy.x0 && pos.x() <= copy.x1
+          && pos.z() >= copy.z0 && pos.z() <= copy.z1) {
+        window = &copy;
+        break;
+      }
+    }
+    if (window) {
+      // surface_mppc_refl: polished quartz/epoxy interface
+      if (Fresnel(Surface(), energy, dir, normal, m_n[i], m_n_mppc) == kTransmitted) {
+        Detect(i, pos, *window);
+        return false;
+      }
+    } else if (Fresnel(m_end, energy, dir, normal, m_n[i], m_n_air) != kReflected) {
+      return false;                           // out towards the blacksheet
+    }
+  } else if (m_gap > 0.) {
+    const G4int status = Fresnel(m_quartz, energy, dir, normal, m_n[i], m_n_air);
+    if (status == kAbsorbed) return false;
+    if (status == kTransmitted
+        && !CrossAirGap(pos, dir, m_t[i], axis, sign, energy, m_n[i])) return false;
+  } else if (!Reflect(m_quartz, energy, dir, normal)) {
+    return false;                             // absorbed by the wrapper
+  }
+
+  m_x[i]  = pos.x();
+  m_y[i]  = pos.y();
+  m_z[i]  = pos.z();
+  m_dx[i] = dir.x();
+  m_dy[i] = dir.y();
+  m_dz[i] = dir.z();
+  return true;
+}
+
+//_____________________________________________________________________________
+// A photon refracted out of an X or Z face: back and forth between the
+// wrapper and the radiator until it re-enters the quartz (true) or is lost.
+// The air gap is followed as a slab parallel to the face; photons that run
+// past the Y ends of the wrapper are lost, and the corners of the gap are not
+// followed (the re-entry point is kept on the face).
+G4bool BatchPropagator::CrossAirGap(G4ThreeVector& pos, G4ThreeVector& dir, G4double& time,
+                                    G4int axis, G4double sign, G4double energy,
+                                    G4double n_quartz) const
+{
+  G4ThreeVector out;
+  out[axis] = sign;                           // outward normal of the face
+  G4double path = 0.;
+  for (G4int k = 0; k < kMaxBounces; ++k) {
+    // Out to the wrapper...
+    G4double s = m_gap / dir.dot(out);
+    pos += s * dir;
+    path += s;
+    if (std::fabs(pos.y()) > m_half[1]) return false;
+    if (!Reflect(m_wrapper, energy, dir, -out)) return false;
+
+    // ...and back to the radiator
+    s = -m_gap / dir.dot(out);
+    pos += s * dir;
+    path += s;
+    if (std::fabs(pos.y()) > m_half[1]) return false;
+    for (G4int a = 0; a < 3; ++a)
+      pos[a] = std::min(std::max(pos[a], -m_half[a]), m_half[a]);
+    pos[axis] = sign * m_half[axis];
+
+    const G4int status = Fresnel(m_quartz, energy, dir, out, m_n_air, n_quartz);
+    if (status == kAbsorbed) return false;
+    if (status == kTransmitted) {
+      time += path * m_n_air / c_light;
+      return true;
+    }
+  }
+  return false;
+}
+
+//_____________________________________________________________________________
+// Wrapper (dielectric_metal or front-painted): absorbed with 1 - REFLECTIVITY,
+// otherwise reflected. Returns false when absorbed.
+G4bool BatchPropagator::Reflect(const Surface& surface, G4double energy, G4ThreeVector& dir,
+                                const G4ThreeVector& normal) const
+{
+  if (!surface.reflectivity.empty() && G4UniformRand() > Table(surface.reflectivity, energy))
+    return false;
+  if (surface.painted && !surface.polished) {
+    dir = G4LambertianRand(normal);
+    return true;
+  }
+  dir = Scatter(surface, dir, FacetNormal(surface, dir, normal), normal);
+  return true;
+}
+
+//_____________________________________________________________________________
+// Dielectric-dielectric boundary from index n1 to n2 (G4OpBoundaryProcess,
+// unified model): REFLECTIVITY absorbs with 1 - R, then Fresnel reflection or
+// refraction on a sampled facet.
+G4int BatchPropagator::Fresnel(const Surface& surface, G4double energy, G4ThreeVector& dir,
+                               const G4ThreeVector& normal, G4double n1, G4double n2) const
+{
+  if (!surface.reflectivity.empty() && G4UniformRand() > Table(surface.reflectivity, energy))
+    return kAbsorbed;
+
+  const G4ThreeVector facet = FacetNormal(surface, dir, normal);
+  const G4double cos1 = -dir.dot(facet);
+  const G4double eta = n1 / n2;
+  const G4double sin2sq = eta * eta * (1. - cos1 * cos1);
+  if (sin2sq < 1.) {                          // otherwise total internal reflection
+    const G4double cos2 = std::sqrt(1. - sin2sq);
+    const G4double rs = (n1 * cos1 - n2 * cos2) / (n1 * cos1 + n2 * cos2);
+    const G4double rp = (n2 * cos1 - n1 * cos2) / (n2 * cos1 + n1 * cos2);
+    if (G4UniformRand() >= 0.5 * (rs * rs + rp * rp)) {
+      const G4ThreeVector refracted = (eta * dir + (eta * cos1 - cos2) * facet).unit();
+      if (refracted.dot(normal) < 0.) {
+        dir = refracted;
+        return kTransmitted;
+      }
+      // Bent back into the incident medium by a steep facet: reflected
+    }
+  }
+  dir = Scatter(surface, dir, facet, normal);
+  return kReflected;
+}
+
+//_____________________________________________________________________________
+// Reflected direction: specular spike, specular lobe (about the facet),
+// backscatter or Lambertian, with the unified-model constants.
+G4ThreeVector BatchPropagator::Scatter(const Surface& surface, const G4ThreeVector& dir,
+                                       const G4ThreeVector& facet, const G4ThreeVector& normal) const
+{
+  const G4ThreeVector spike = dir - 2. * dir.dot(normal) * normal;
+  if (surface.polished) return spike;
+
+  const G4double u = G4UniformRand();
+  if (u < surface.prob_ss) return spike;
+  if (u < surface.prob_ss + surface.prob_sl) {
+    const G4ThreeVector lobe = dir - 2. * dir.dot(facet) * facet;
+    return lobe.dot(normal) > 0. ? lobe : spike;
+  }
+  if (u < surface.prob_ss + surface.prob_sl + surface.prob_bs) return -dir;
+  return G4LambertianRand(normal);
+}
+
+//_____________________________________________________________________________
+// Micro-facet normal of the unified model (G4OpBoundaryProcess::GetFacetNormal).
+G4ThreeVector BatchPropagator::FacetNormal(const Surface& surface, const G4ThreeVector& dir,
+                                           const G4ThreeVector& normal) const
+{
+  if (surface.polished || surface.sigma_alpha <= 0.) return normal;
+
+  const G4double f_max = std::min(1., 4. * surface.sigma_alpha);
+  G4ThreeVector facet;
+  do {
+    G4double alpha, sin_alpha;
+    do {
+      alpha = G4RandGauss::shoot(0., surface.sigma_alpha);
+      sin_alpha = std::sin(alpha);
+    } while (G4UniformRand() * f_max > sin_alpha || alpha >= CLHEP::halfpi);
+    const G4double phi = CLHEP::twopi * G4UniformRand();
+    facet.set(sin_alpha * std::cos(phi), sin_alpha * std::sin(phi), std::cos(alpha));
+    facet.rotateUz(normal);
+  } while (dir.dot(facet) >= 0.);
+  return facet;
+}
+
+//_____________________________________________________________________________
+// Photon transmitted into an MPPC: PDE roll and hit, as in MPPCSD::ProcessHits.
+void BatchPropagator::Detect(G4int i, const G4ThreeVector& pos, const Copy& copy)
+{
+  const G4double energy = m_energy[i];
+  if (G4UniformRand() > m_pde.Value(energy)) return;
+
+  auto aHit = new MPPCHit();
+  aHit->SetPosition(copy.to_local.TransformPoint(pos));
+  aHit->SetWorldPosition(m_origin + pos);
+  aHit->SetEnergy(energy);
+  aHit->SetWaveLength((CLHEP::h_Planck * CLHEP::c_light / energy) / CLHEP::nm);
+  aHit->SetTime(m_t[i]);
+  aHit->SetParticleID(G4OpticalPhoton::Definition()->GetPDGEncoding());
+  aHit->SetCopyNumber(copy.copy);
+  aHit->SetEventID(G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID());
+  aHit->SetDetectFlag(1);
+  aHit->SetWeight(m_weight[i]);
+  m_hits->insert(aHit);
+}
+
+//_____________________________________________________________________________
+void BatchPropagator::Resize(G4int n)
+{
+  m_capacity = n;
+  for (auto v : { &m_x, &m_y, &m_z, &m_dx, &m_dy, &m_dz, &m_t, &m_energy, &m_weight,
+                  &m_n, &m_vg, &m_abs, &m_uniform })
+    v->resize(n);
+  m_face.resize(n);
+  m_bounces.resize(n);
+}
+
+//_____________________________________________________________________________
+// Drops the photons that are gone, keeping the live ones contiguous for the
+// next Transport pass.
+void BatchPropagator::Compact(G4int& n)
+{
+  G4int k = 0;
+  for (G4int i = 0; i < n; ++i) {
+    if (m_face[i] < 0) continue;
+    if (k != i) {
+      m_x[k]  = m_x[i];
+      m_y[k]  = m_y[i];
+      m_z[k]  = m_z[i];
+      m_dx[k] = m_dx[i];
+      m_dy[k] = m_dy[i];
+      m_dz[k] = m_dz[i];
+      m_t[k]  = m_t[i];
+      m_energy[k]  = m_energy[i];
+      m_weight[k]  = m_weight[i];
+      m_n[k]   = m_n[i];
+      m_vg[k]  = m_vg[i];
+      m_abs[k] = m_abs[i];
+      m_bounces[k] = m_bounces[i];
+    }
+    ++k;
+  }
+  n = k;
+}
@@ -0,0 +1,109 @@
+#include "BeamPool.hh"
+#include "ConfManager.hh"
+
+#include "G4AutoLock.hh"
+#include "G4Exception.hh"
+#include "Randomize.hh"
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+  G4Mutex gBeamPoolMutex = G4MUTEX_INITIALIZER;
+}
+
+//_____________________________________________________________________________
+BeamPool&
+BeamPool::GetInstance(G4int slot)
+{
+  static BeamPool instances[kMaxSlots];
+  return instances[std::min(std::max(slot, 0), kMaxSlots - 1)];
+}
+
+//_____________________________________________________________________________
+BeamPool::BeamPool()
+  : m_loaded(false), m_sampling(kRandom)
+{
+}
+
+//_____________________________________________________________________________
+G4bool
+BeamPool::Load(const G4String& path)
+{
+  G4AutoLock lock(&gBeamPoolMutex);
+  if (m_loaded) return true;
+
+  TFile file(path.c_str(), "READ");
+  if (file.IsZombie() || !file.IsOpen()) {
+    G4Exception("BeamPool::Load", "FileNotFound", FatalException, "Failed to open ROOT beam file.");
+    return false;
+  }
+  auto tree = dynamic_cast<TTree*>(file.Get("tree"));
+  if (!tree) {
+    G4Exception("BeamPool::Load", "TreeNotFound", FatalException, "TTree 'tree' not found in ROOT beam file.");
+    return false;
+  }
+
+  Double_t px, py, pz, vx, vy, vz;
+  tree->SetBranchStatus("*", 0);
+  const char* names[] = { "px", "py", "pz", "vx", "vy", "vz" };
+  Double_t* addresses[] = { &px, &py, &pz, &vx, &vy, &vz };
+  for (G4int i = 0; i < 6; ++i) {
+    tree->SetBranchStatus(names[i], 1);
+    tree->SetBranchAddress(names[i], addresses[i]);
+  }
+
+  // Sequential read: every basket is decompressed once.
+  const Long64_t n = tree->GetEntries();
+  for (auto v : { &m_px, &m_py, &m_pz, &m_vx, &m_vy, &m_vz }) v->resize(n);
+  for (Long64_t i = 0; i < n; ++i) {
+    tree->GetEntry(i);
+    m_px[i] = px; m_py[i] = py; m_pz[i] = pz;
+    m_vx[i] = vx; m_vy[i] = vy; m_vz[i] = vz;
+  }
+  tree->ResetBranchAddresses();
+  file.Close();
+
+  if (n == 0) {
+    G4Exception("BeamPool::Load", "EmptyBeamFile", FatalException, "ROOT beam file has no entries.");
+    return false;
+  }
+
+  G4String sampling = gConfMan.Check("beam_sampling") ? G4String(gConfMan.Get("beam_sampling")) : G4String("random");
+  if      (sampling == "sequential") m_sampling = kSequential;
+  else if (sampling == "shuffle")    m_sampling = kShuffle;
+  else if (sampling == "random")     m_sampling = kRandom;
+  else {
+    G4Exception("BeamPool::Load", "InvalidSampling", FatalException,
+                "beam_sampling must be random, sequential or shuffle");
+  }
+
+  if (m_sampling == kShuffle) {
+    m_order.resize(n);
+    std::iota(m_order.begin(), m_order.end(), 0);
+    std::mt19937_64 engine(gConfMan.Check("beam_shuffle_seed") ? gConfMan.GetInt("beam_shuffle_seed") : 0);
+    std::shuffle(m_order.begin(), m_order.end(), engine);
+  }
+
+  m_loaded = true;
+  G4cout << "BeamPool: " << n << " entries from " << path << " (" << sampling << " sampling)" << G4endl;
+  return true;
+}
+
+//_____________________________________________________________________________
+G4long
+BeamPool::Entry(G4int eventID) const
+{
+  const G4long n = Size();
+  switch (m_sampling) {
+  case kSequential: return eventID % n;
+  case kShuffle:    return m_order[eventID % n];
+  default:          return G4RandFlat::shootInt(n);
+  }
+}
@@ -0,0 +1,412 @@
+#include "Calibration.hh"
+#include "AnaManager.hh"
+#include "ConfManager.hh"
+#include "SimParameters.hh"
+
+#include "G4Exception.hh"
+#include "G4Timer.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+
+  const char* const kObservableNames[] = { "npe_mean", "npe_rms" };
+
+  // Length scales (normalized parameter units) tried by leave-one-out
+  const G4double kLengthScales[] = { 0.1, 0.15, 0.2, 0.3, 0.5, 0.8, 1.2, 2.0 };
+
+  // Diagonal jitter (standardized units) added when no length scale gives a
+  // positive definite kernel matrix, e.g. for repeated points
+  const G4double kJitters[] = { 0., 1.e-6, 1.e-4, 1.e-2 };
+
+  // Random candidates before the local search of the surrogate minimum
+  constexpr G4int kCandidates = 4096;
+
+  G4double Kernel(const std::vector<G4double>& a, const std::vector<G4double>& b, G4double length)
+  {
+    G4double d2 = 0.;
+    for (std::size_t k = 0; k < a.size(); ++k) d2 += (a[k] - b[k]) * (a[k] - b[k]);
+    return std::exp(-0.5 * d2 / (length * length));
+  }
+
+  // In-place Cholesky factor (lower triangle) of a symmetric positive
+  // definite matrix. False if it is not positive definite.
+  G4bool Cholesky(std::vector<std::vector<G4double>>& a)
+  {
+    const std::size_t n = a.size();
+    for (std::size_t j = 0; j < n; ++j) {
+      G4double d = a[j][j];
+      for (std::size_t k = 0; k < j; ++k) d -= a[j][k] * a[j][k];
+      if (d <= 0.) return false;
+      a[j][j] = std::sqrt(d);
+      for (std::size_t i = j + 1; i < n; ++i) {
+        G4double s = a[i][j];
+        for (std::size_t k = 0; k < j; ++k) s -= a[i][k] * a[j][k];
+        a[i][j] = s / a[j][j];
+      }
+    }
+    return true;
+  }
+
+  // Solves L L^T x = b with the factor from Cholesky().
+  std::vector<G4double> CholeskySolve(const std::vector<std::vector<G4double>>& l,
+                                      std::vector<G4double> b)
+  {
+    const std::size_t n = l.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      for (std::size_t k = 0; k < i; ++k) b[i] -= l[i][k] * b[k];
+      b[i] /= l[i][i];
+    }
+    for (std::size_t i = n; i-- > 0;) {
+      for (std::size_t k = i + 1; k < n; ++k) b[i] -= l[k][i] * b[k];
+      b[i] /= l[i][i];
+    }
+    return b;
+  }
+}
+
+//_____________________________________________________________________________
+Calibration::Calibration(G4RunManager* runManager, DetectorConstruction* detector)
+  : m_sweep(runManager, detector),
+    m_events(2000),
+    m_design_points(0),
+    m_refine_points(0),
+    m_iterations(3)
+{
+}
+
+//_____________________________________________________________________________
+Calibration::~Calibration()
+{
+}
+
+//_____________________________________________________________________________
+G4bool Calibration::Load(const G4String& filename)
+{
+  std::ifstream file(filename);
+  if (!file) {
+    G4cerr << "Error: Cannot open calibration file " << filename << G4endl;
+    return false;
+  }
+
+  m_params.clear();
+  for (auto& target : m_targets) target = Target();
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream iss(line);
+    std::string kind, name;
+    if (!(iss >> kind) || kind[0] == '#') continue;
+    iss >> name;
+    G4double a = 0., b = 0.;
+    if (!(iss >> a >> b)) {
+      G4cerr << "Warning: calibration line '" << line << "' needs two values; skipped" << G4endl;
+      continue;
+    }
+    if (kind == "param") {
+      if (!SimParameters::IsKnownKey(name))
+        G4cerr << "Warning: calibration key '" << name << "' is not a known conf key" << G4endl;
+      if (a >= b) {
+        G4cerr << "Error: calibration range of '" << name << "' is empty" << G4endl;
+        return false;
+      }
+      m_params.push_back({ name, a, b });
+    } else if (kind == "target") {
+      G4int obs = -1;
+      for (G4int i = 0; i < kNObservables; ++i)
+        if (name == kObservableNames[i]) obs = i;
+      if (obs < 0 || b <= 0.) {
+        G4cerr << "Error: calibration target '" << name << "' unknown or without error" << G4endl;
+        return false;
+      }
+      m_targets[obs].used = true;
+      m_targets[obs].value = a;
+      m_targets[obs].error = b;
+    } else {
+      G4cerr << "Warning: calibration line '" << line << "' not understood; skipped" << G4endl;
+    }
+  }
+
+  if (m_params.empty() || std::none_of(std::begin(m_targets), std::end(m_targets),
+                                       [](const Target& t) { return t.used; })) {
+    G4cerr << "Error: calibration file " << filename << " needs params and targets" << G4endl;
+    return false;
+  }
+
+  const G4int n_params = m_params.size();
+  if (gConfMan.Check("calib_events")) m_events = gConfMan.GetInt("calib_events");
+  m_design_points = gConfMan.Check("calib_design_points") ? gConfMan.GetInt("calib_design_points") : 5 * n_params;
+  m_refine_points = gConfMan.Check("calib_refine_points") ? gConfMan.GetInt("calib_refine_points") : n_params;
+  if (gConfMan.Check("calib_iterations")) m_iterations = gConfMan.GetInt("calib_iterations");
+  m_rng.seed(gConfMan.Check("calib_seed") ? gConfMan.GetInt("calib_seed") : 1);
+
+  G4cout << "Calibration: " << n_params << " parameters, "
+         << m_design_points + 1 + m_iterations * (1 + m_refine_points) + 1
+         << " simulations of " << m_events << " events from " << filename << G4endl;
+  return true;
+}
+
+//_____________________________________________________________________________
+void Calibration::Run()
+{
+  m_stem = AnaManager::GetOutputRootfilePath();
+  if (G4StrUtil::ends_with(m_stem, ".root")) m_stem.erase(m_stem.size() - 5);
+  const std::size_t n_params = m_params.size();
+
+  m_table.open(m_stem + "_calib.tsv");
+  m_table << "point\titeration";
+  for (const auto& param : m_params) m_table << "\t" << param.key;
+  m_table << "\tn_events\tnpe_mean\tnpe_rms\tchi2\tseconds" << std::endl;
+
+  // Design: box centre plus a Latin hypercube
+  m_points.clear();
+  Simulate(std::vector<G4double>(n_params, 0.5), 0);
+  std::uniform_real_distribution<G4double> flat(0., 1.);
+  std::vector<std::vector<G4int>> strata(n_params);
+  for (auto& order : strata) {
+    order.resize(m_design_points);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), m_rng);
+  }
+  for (G4int i = 0; i < m_design_points; ++i) {
+    std::vector<G4double> u(n_params);
+    for (std::size_t k = 0; k < n_params; ++k)
+      u[k] = (strata[k][i] + flat(m_rng)) / m_design_points;
+    Simulate(u, 0);
+  }
+
+  // Refinement around the surrogate optimum, in a shrinking box
+  G4double half_width = 0.25;
+  for (G4int iteration = 1; iteration <= m_iterations; ++iteration) {
+    for (G4int obs = 0; obs < kNObservables; ++obs) Fit(Observable(obs), m_surrogates[obs]);
+    const auto best = std::min_element(m_points.begin(), m_points.end(),
+                                       [this](const Point& a, const Point& b) { return Chi2(a.y) < Chi2(b.y); });
+    const auto optimum = Minimize(best->u, half_width);
+    G4cout << "Calibration: iteration " << iteration << ", surrogate chi2 "
+           << SurrogateChi2(optimum) << G4endl;
+    Simulate(optimum, iteration);
+    for (G4int i = 0; i < m_refine_points; ++i) Simulate(Uniform(optimum, half_width), iteration);
+    half_width *= 0.5;
+  }
+
+  // Final fit; its optimum is simulated once more as a check.
+  for (G4int obs = 0; obs < kNObservables; ++obs) Fit(Observable(obs), m_surrogates[obs]);
+  const auto best = std::min_element(m_points.begin(), m_points.end(),
+                                     [this](const Point& a, const Point& b) { return Chi2(a.y) < Chi2(b.y); });
+  const auto optimum = Minimize(best->u, half_width);
+  const Point check = Simulate(optimum, m_iterations + 1);
+  m_table.close();
+
+  const auto values = Values(optimum);
+  std::ofstream conf(m_stem + "_calib_best.conf");
+  conf << "# Calibration best fit: simulated chi2 " << Chi2(check.y)
+       << " (surrogate " << SurrogateChi2(optimum) << "), "
+       << m_points.size() << " simulations of " << m_events << " events" << std::endl;
+  G4cout << "=== Calibration result ===" << G4endl;
+  for (std::size_t k = 0; k < n_params; ++k) {
+    conf << m_params[k].key << "\t" << values[k] << std::endl;
+    G4cout << "  " << m_params[k].key << " = " << values[k] << G4endl;
+  }
+  for (G4int obs = 0; obs < kNObservables; ++obs) {
+    if (!m_targets[obs].used) continue;
+    G4cout << "  " << kObservableNames[obs] << ": " << check.y[obs] << " +- " << check.error[obs]
+           << " (target " << m_targets[obs].value << " +- " << m_targets[obs].error << ")" << G4endl;
+  }
+  G4cout << "  chi2 = " << Chi2(check.y) << ", " << m_points.size() << " simulations -> "
+         << m_stem << "_calib_best.conf" << G4endl;
+  AnaManager::SetOutputRootfilePath(m_stem + ".root");
+}
+
+//_____________________________________________________________________________
+std::vector<std::string> Calibration::Values(const std::vector<G4double>& u) const
+{
+  std::vector<std::string> values;
+  for (std::size_t k = 0; k < m_params.size(); ++k) {
+    std::ostringstream oss;
+    oss << std::setprecision(8) << m_params[k].min + u[k] * (m_params[k].max - m_params[k].min);
+    values.push_back(oss.str());
+  }
+  return values;
+}
+
+//_____________________________________________________________________________
+Calibration::Point Calibration::Simulate(const std::vector<G4double>& u, G4int iteration)
+{
+  const std::size_t index = m_points.size();
+  const auto values = Values(u);
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), "_c%03zu.root", index);
+
+  G4cout << "=== Calibration point " << index << " (iteration " << iteration << "):";
+  for (std::size_t k = 0; k < m_params.size(); ++k)
+    G4cout << " " << m_params[k].key << "=" << values[k];
+  G4cout << " ===" << G4endl;
+
+  std::vector<std::string> keys;
+  for (const auto& param : m_params) keys.push_back(param.key);
+  G4Timer timer;
+  timer.Start();
+  const RunSummary run = m_sweep.RunPoint(keys, values, m_events, m_stem + suffix);
+  timer.Stop();
+
+  Point point;
+  point.u = u;
+  const G4double n = std::max<G4long>(run.n_events, 1);
+  point.y[kNpeMean] = run.Mean();
+  point.y[kNpeRMS]  = run.RMS();
+  point.error[kNpeMean] = run.RMS() / std::sqrt(n);
+  point.error[kNpeRMS]  = run.RMS() / std::sqrt(2. * n);
+  m_points.push_back(point);
+
+  m_table << index << "\t" << iteration;
+  for (const auto& value : values) m_table << "\t" << value;
+  m_table << "\t" << run.n_events << "\t" << point.y[kNpeMean] << "\t" << point.y[kNpeRMS]
+          << "\t" << Chi2(point.y) << "\t" << timer.GetRealElapsed() << std::endl;
+  return point;
+}
+
+//_____________________________________________________________________________
+void Calibration::Fit(Observable obs, Surrogate& surrogate) const
+{
+  const std::size_t n = m_points.size();
+  surrogate.u.clear();
+  for (const auto& point : m_points) surrogate.u.push_back(point.u);
+  surrogate.weight.assign(n, 0.);
+
+  // Standardized values; the Monte Carlo variance is the noise term.
+  G4double sum = 0., sum2 = 0.;
+  for (const auto& point : m_points) {
+    sum += point.y[obs];
+    sum2 += point.y[obs] * point.y[obs];
+  }
+  surrogate.mean = sum / n;
+  const G4double var = sum2 / n - surrogate.mean * surrogate.mean;
+  surrogate.scale = var > 0. ? std::sqrt(var) : 1.;
+  std::vector<G4double> y(n), noise(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    y[i] = (m_points[i].y[obs] - surrogate.mean) / surrogate.scale;
+    const G4double e = m_points[i].error[obs] / surrogate.scale;
+    noise[i] = e * e + 1.e-8;
+  }
+
+  // Length scale with the smallest leave-one-out error: for a GP the
+  // residual of point i is (K^-1 y)_i / (K^-1)_ii.
+  for (auto jitter : kJitters) {
+    G4double best_loo = std::numeric_limits<G4double>::max();
+    for (auto length : kLengthScales) {
+      std::vector<std::vector<G4double>> l(n, std::vector<G4double>(n));
+      for (std::size_t i = 0; i < n; ++i)
+        for (std::size_t j = 0; j <= i; ++j)
+          l[i][j] = l[j][i] = Kernel(surrogate.u[i], surrogate.u[j], length)
+                            + (i == j ? noise[i] + jitter : 0.);
+      if (!Cholesky(l)) continue;
+      const auto alpha = CholeskySolve(l, y);
+      G4double loo = 0.;
+      for (std::size_t i = 0; i < n; ++i) {
+        std::vector<G4double> e(n, 0.);
+        e[i] = 1.;
+        const G4double inv_ii = CholeskySolve(l, e)[i];
+        const G4double r = alpha[i] / inv_ii;
+        loo += r * r;
+      }
+      if (loo < best_loo) {
+        best_loo = loo;
+        surrogate.length = length;
+        surrogate.weight = alpha;
+      }
+    }
+    if (best_loo < std::numeric_limits<G4double>::max()) {
+      if (jitter > 0.) {
+        std::ostringstream message;
+        message << kObservableNames[obs] << ": kernel matrix regularized with jitter " << jitter;
+        G4Exception("Calibration::Fit", "SurrogateJitter", JustWarning, message.str().c_str());
+      }
+      return;
+    }
+  }
+  G4Exception("Calibration::Fit", "SurrogateFailed", FatalException,
+              (std::string(kObservableNames[obs]) + ": no length scale gives a positive definite kernel matrix").c_str());
+}
+
+//_____________________________________________________________________________
+G4double Calibration::Surrogate::Eval(const std::vector<G4double>& x) const
+{
+  G4double s = 0.;
+  for (std::size_t i = 0; i < weight.size(); ++i) s += weight[i] * Kernel(x, u[i], length);
+  return mean + scale * s;
+}
+
+//_____________________________________________________________________________
+G4double Calibration::Chi2(const G4double y[kNObservables]) const
+{
+  G4double chi2 = 0.;
+  for (G4int obs = 0; obs < kNObservables; ++obs) {
+    if (!m_targets[obs].used) continue;
+    const G4double pull = (y[obs] - m_targets[obs].value) / m_targets[obs].error;
+    chi2 += pull * pull;
+  }
+  return chi2;
+}
+
+//_____________________________________________________________________________
+G4double Calibration::SurrogateChi2(const std::vector<G4double>& u) const
+{
+  G4double y[kNObservables];
+  for (G4int obs = 0; obs < kNObservables; ++obs) y[obs] = m_surrogates[obs].Eval(u);
+  return Chi2(y);
+}
+
+//_____________________________________________________________________________
+std::vector<G4double> Calibration::Minimize(const std::vector<G4double>& start, G4double step) const
+{
+  // Best of random candidates in the whole box and the start point (the
+  // surrogate is cheap), then a compass search.
+  std::mt19937_64 rng(m_points.size());
+  std::uniform_real_distribution<G4double> flat(0., 1.);
+  std::vector<G4double> best = start;
+  G4double best_chi2 = SurrogateChi2(best);
+  std::vector<G4double> u(start.size());
+  for (G4int i = 0; i < kCandidates; ++i) {
+    for (auto& x : u) x = flat(rng);
+    const G4double chi2 = SurrogateChi2(u);
+    if (chi2 < best_chi2) {
+      best_chi2 = chi2;
+      best = u;
+    }
+  }
+
+  while (step > 1.e-4) {
+    G4bool improved = false;
+    for (std::size_t k = 0; k < best.size(); ++k) {
+      for (G4double sign : { 1., -1. }) {
+        u = best;
+        u[k] = std::min(std::max(u[k] + sign * step, 0.), 1.);
+        const G4double chi2 = SurrogateChi2(u);
+        if (chi2 < best_chi2) {
+          best_chi2 = chi2;
+          best = u;
+          improved = true;
+        }
+      }
+    }
+    if (!improved) step *= 0.5;
+  }
+  return best;
+}
+
+//_____________________________________________________________________________
+std::vector<G4double> Calibration::Uniform(const std::vector<G4double>& centre, G4double half_width)
+{
+  std::uniform_real_distribution<G4double> flat(-half_width, half_width);
+  std::vector<G4double> u(centre);
+  for (auto& x : u) x = std::min(std::max(x + flat(m_rng), 0.), 1.);
+  return u;
+}
@@ -0,0 +1,104 @@
+#include "Checkpoint.hh"
+#include "ConfManager.hh"
+
+#include "G4Exception.hh"
+#include "G4ios.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+G4int Checkpoint::s_interval = 0;
+G4bool Checkpoint::s_resuming = false;
+CheckpointState Checkpoint::s_resume;
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+}
+
+//_____________________________________________________________________________
+void
+Checkpoint::Configure(const G4String& output_path)
+{
+  s_interval = gConfMan.Check("checkpoint_events") ? gConfMan.GetInt("checkpoint_events") : 0;
+  if (s_interval < 0) s_interval = 0;
+
+  s_resuming = false;
+  if (!gConfMan.Check("resume") || gConfMan.GetInt("resume") != 1) return;
+
+  const G4String path = FilePath(output_path);
+  if (!Read(path, s_resume)) {
+    G4Exception("Checkpoint::Configure", "NoCheckpoint", FatalException,
+                ("resume 1 but no valid checkpoint " + path).c_str());
+    return;
+  }
+  s_resuming = true;
+  gConfMan.Set("first_event", std::to_string(s_resume.next_event));
+  G4cout << "Checkpoint: resuming " << output_path << " at event " << s_resume.next_event
+         << " (" << s_resume.entries << " events written, "
+         << RemainingEvents() << " to go)" << G4endl;
+}
+
+//_____________________________________________________________________________
+void
+Checkpoint::Write(const G4String& output_path, const CheckpointState& state)
+{
+  // Written next to the final name and renamed, so a kill never leaves a
+  // truncated checkpoint behind.
+  const G4String path = FilePath(output_path);
+  const G4String tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp);
+    if (!out) {
+      G4cerr << "Warning: cannot write checkpoint " << tmp << G4endl;
+      return;
+    }
+    out << "first_event " << state.first_event << "\n"
+        << "n_events " << state.n_events << "\n"
+        << "next_event " << state.next_event << "\n"
+        << "entries " << state.entries << "\n"
+        << "summary_events " << state.summary_events << "\n"
+        << "npe_sum " << std::hexfloat << state.npe_sum << "\n"
+        << "npe_sum2 " << state.npe_sum2 << "\n"
+        << "master_seed " << state.master_seed << "\n"
+        << "run_id " << state.run_id << "\n";
+  }
+  std::rename(tmp.c_str(), path.c_str());
+}
+
+//_____________________________________________________________________________
+void
+Checkpoint::EndRun(const G4String& output_path)
+{
+  // The run is complete; a later resume would start from a stale state.
+  if (s_interval > 0 || s_resuming) std::remove(FilePath(output_path).c_str());
+  s_resuming = false;
+}
+
+//_____________________________________________________________________________
+G4bool
+Checkpoint::Read(const G4String& path, CheckpointState& state)
+{
+  std::ifstream in(path);
+  if (!in) return false;
+
+  std::string key;
+  while (in >> key) {
+    if      (key == "first_event")    in >> state.first_event;
+    else if (key == "n_events")       in >> state.n_events;
+    else if (key == "next_event")     in >> state.next_event;
+    else if (key == "entries")        in >> state.entries;
+    else if (key == "summary_events") in >> state.summary_events;
+    else if (key == "npe_sum" || key == "npe_sum2") {
+      std::string value;
+      in >> value;
+      (key == "npe_sum" ? state.npe_sum : state.npe_sum2) = std::strtod(value.c_str(), nullptr);
+    }
+    else if (key == "master_seed")    in >> state.master_seed;
+    else if (key == "run_id")         in >> state.run_id;
+    else return false;
+  }
+  return !in.bad() && state.next_event < state.n_events;
+}
@@ -0,0 +1,124 @@
+#include "CherenkovTable.hh"
+#include "KVC_OpticalProperties.hh"
+
+#include "G4ios.hh"
+
+#include <algorithm>
+
+namespace
+{
+  // Sub-intervals per RINDEX grid step when binning the spectrum
+  constexpr G4int kSpectrumSteps = 16;
+}
+
+//_____________________________________________________________________________
+const CherenkovTable&
+CherenkovTable::Get()
+{
+  static const CherenkovTable instance;
+  return instance;
+}
+
+//_____________________________________________________________________________
+CherenkovTable::CherenkovTable()
+  : m_energy(KVC_Optical::E_Quartz_RINDEX),
+    m_rindex(KVC_Optical::R_Quartz_RINDEX),
+    m_cum_inv_n2(m_energy.size(), 0.),
+    m_nmin(*std::min_element(m_rindex.begin(), m_rindex.end())),
+    m_spectrum(kWavelengthBins + 2, 0.)
+{
+  // Trapezoidal integral of 1/n^2, as G4Cerenkov builds its CAI table
+  for (std::size_t i = 1; i < m_energy.size(); ++i) {
+    const G4double a = 1. / (m_rindex[i - 1] * m_rindex[i - 1]);
+    const G4double b = 1. / (m_rindex[i] * m_rindex[i]);
+    m_cum_inv_n2[i] = m_cum_inv_n2[i - 1] + 0.5 * (a + b) * (m_energy[i] - m_energy[i - 1]);
+  }
+
+  // dN/dE at beta = 1 is proportional to 1 - 1/n^2
+  G4double total = 0.;
+  for (std::size_t i = 1; i < m_energy.size(); ++i) {
+    const G4double step = (m_energy[i] - m_energy[i - 1]) / kSpectrumSteps;
+    for (G4int k = 0; k < kSpectrumSteps; ++k) {
+      const G4double e = m_energy[i - 1] + (k + 0.5) * step;
+      const G4double n = RIndex(e);
+      const G4double dn = (1. - 1. / (n * n)) * step;
+      m_spectrum[WavelengthBin(e)] += dn;
+      total += dn;
+    }
+  }
+  if (total > 0.)
+    for (auto& f : m_spectrum) f /= total;
+}
+
+//_____________________________________________________________________________
+G4double
+CherenkovTable::RIndex(G4double energy) const
+{
+  if (energy <= m_energy.front()) return m_rindex.front();
+  if (energy >= m_energy.back()) return m_rindex.back();
+  const std::size_t i = std::upper_bound(m_energy.begin(), m_energy.end(), energy) - m_energy.begin();
+  const G4double f = (energy - m_energy[i - 1]) / (m_energy[i] - m_energy[i - 1]);
+  return m_rindex[i - 1] + f * (m_rindex[i] - m_rindex[i - 1]);
+}
+
+//_____________________________________________________________________________
+G4double
+CherenkovTable::InvN2Integral(G4double energy) const
+{
+  if (energy <= m_energy.front()) return 0.;
+  if (energy >= m_energy.back()) return m_cum_inv_n2.back();
+  const std::size_t i = std::upper_bound(m_energy.begin(), m_energy.end(), energy) - m_energy.begin();
+  const G4double n = RIndex(energy);
+  const G4double a = 1. / (m_rindex[i - 1] * m_rindex[i - 1]);
+  return m_cum_inv_n2[i - 1] + 0.5 * (a + 1. / (n * n)) * (energy - m_energy[i - 1]);
+}
+
+//_____________________________________________________________________________
+G4double
+CherenkovTable::MeanPhotonsPerLength(G4double beta) const
+{
+  return MeanPhotonsPerLength(beta, GetEmin(), GetEmax());
+}
+
+//_____________________________________________________________________________
+G4double
+CherenkovTable::MeanPhotonsPerLength(G4double beta, G4double emin, G4double emax) const
+{
+  emin = std::max(emin, GetEmin());
+  emax = std::min(emax, GetEmax());
+  if (beta <= 0. || emax <= emin) return 0.;
+
+  // alpha / (hbar c) per unit energy and length, as G4Cerenkov's Rfact
+  const G4double rfact = CLHEP::fine_structure_const / CLHEP::hbarc;
+  const G4double inv_beta2 = 1. / (beta * beta);
+
+  // Above threshold everywhere: the cached integral
+  if (beta * m_nmin > 1.)
+    return rfact * ((emax - emin) - inv_beta2 * (InvN2Integral(emax) - InvN2Integral(emin)));
+
+  // Near threshold only part of the range radiates: integrate the positive part
+  G4double sum = 0.;
+  for (std::size_t i = 1; i < m_energy.size(); ++i) {
+    const G4double lo = std::max(m_energy[i - 1], emin);
+    const G4double hi = std::min(m_energy[i], emax);
+    if (hi <= lo) continue;
+    const G4double step = (hi - lo) / kSpectrumSteps;
+    for (G4int k = 0; k < kSpectrumSteps; ++k) {
+      const G4double n = RIndex(lo + (k + 0.5) * step);
+      sum += std::max(0., 1. - inv_beta2 / (n * n)) * step;
+    }
+  }
+  return rfact * sum;
+}
+
+//_____________________________________________________________________________
+void
+CherenkovTable::Print() const
+{
+  G4cout << "CherenkovTable: QuartzKVC, RINDEX " << m_energy.size() << " points in ["
+         << GetEmin() / eV << ", " << GetEmax() / eV << "] eV" << G4endl
+         << "  photons/cm at beta = 1: " << MeanPhotonsPerLength(1.) * cm
+         << " (" << MeanPhotonsPerLength(1., kGenEmin, kGenEmax) * cm
+         << " in the n_cherenkov_gen window " << kGenEmin / eV << "-" << kGenEmax / eV << " eV)"
+         << G4endl;
+}
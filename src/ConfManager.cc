@@ -3,6 +3,7 @@
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
 
 //_____________________________________________________________________________
 ConfManager& ConfManager::GetInstance() {
@@ -23,6 +24,15 @@ bool ConfManager::Check(const std::string& key) const {
     return config_map.find(key) != config_map.end();
 }
 
+//_____________________________________________________________________________
+std::vector<std::string> ConfManager::Keys() const {
+    std::vector<std::string> keys;
+    keys.reserve(config_map.size());
+    for (const auto& entry : config_map) keys.push_back(entry.first);
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
 //_____________________________________________________________________________
 std::string ConfManager::Get(const std::string& key) const {
     auto it = config_map.find(key);
@@ -76,6 +86,7 @@ void ConfManager::LoadConfigFile(const std::string& filename) {
         std::istringstream iss(line);
         std::string key, value;
         if (iss >> key >> value) {
+            if (key[0] == '#') continue; // comment line
             config_map[key] = value;
         }
     }
@@ -1,5 +1,8 @@
 #include "DetectorConstruction.hh"
 #include "MPPCSD.hh"
+#include "PhotonLUT.hh"
+#include "PhotonLUTModel.hh"
+#include "VolumeRegistry.hh"
 
 #include "G4Box.hh"
 #include "G4Element.hh"
@@ -18,9 +21,12 @@
 #include "G4SDManager.hh"
 #include "G4VisAttributes.hh"
 #include "G4Colour.hh"
+#include "G4Region.hh"
+#include "G4ProductionCutsTable.hh"
 #include "CLHEP/Units/SystemOfUnits.h"
 
 #include "ConfManager.hh"
+#include "SimParameters.hh"
 
 #define DEBUG 0
 
@@ -32,8 +38,9 @@ namespace
 //_____________________________________________________________________________
 DetectorConstruction::DetectorConstruction()
   : G4VUserDetectorConstruction(), m_check_overlaps(true),
-    m_world_lv(nullptr), m_mother_lv(nullptr), m_blacksheet_lv(nullptr),
-    m_mother_pv(nullptr), m_kvc_pv(nullptr), m_wrap_pv(nullptr)
+    m_world_lv(nullptr), m_blacksheet_lv(nullptr),
+    m_mppc_lv(nullptr), m_kvc_region(nullptr),
+    m_surface_mppc(nullptr)
 {
 }
 
@@ -61,10 +68,26 @@ DetectorConstruction::Construct()
 
   ConstructKVC();
   AddSurfaceProperties();
+  VolumeRegistry::Build();
   
   return world_pv;
 }
 
+//_____________________________________________________________________________
+// Sensitive detectors are thread-local: called once per worker (and once on
+// the master in sequential mode).
+void
+DetectorConstruction::ConstructSDandField()
+{
+  if (!m_mppc_lv) return;
+  auto mppcSD = new MPPCSD("mppcSD");
+  G4SDManager::GetSDMpointer()->AddNewDetector(mppcSD);
+  SetSensitiveDetector(m_mppc_lv, mppcSD);
+
+  // Lookup-table fast simulation of the radiator (fastsim_mode lut)
+  if (m_kvc_region) new PhotonLUTModel("PhotonLUTModel", m_kvc_region);
+}
+
 //_____________________________________________________________________________
 void
 DetectorConstruction::ConstructElements()
@@ -282,21 +305,14 @@ DetectorConstruction::AddOpticalProperties()
   auto quartz_prop = new G4MaterialPropertiesTable();
   quartz_prop->AddProperty("RINDEX", KVC_Optical::E_Quartz_RINDEX, KVC_Optical::R_Quartz_RINDEX);
   
-  std::vector<G4double> r_quartz_abs = KVC_Optical::R_Quartz_ABS;
-  if (gConfMan.Check("quartz_abs_scale")) {
-      G4double scale = gConfMan.GetDouble("quartz_abs_scale");
-      for(auto& val : r_quartz_abs) val *= scale;
-  }
-  quartz_prop->AddProperty("ABSLENGTH", KVC_Optical::E_Quartz_ABS, r_quartz_abs);
+  quartz_prop->AddProperty("ABSLENGTH", KVC_Optical::E_Quartz_ABS, QuartzAbsLength());
   m_material_map["QuartzKVC"]->SetMaterialPropertiesTable(quartz_prop);
   
   // +--------------+
   // | Air Property |
   // +--------------+
-  G4double air_rindex = 1.0;
-  if (gConfMan.Check("air_rindex")) air_rindex = gConfMan.GetDouble("air_rindex");
   auto air_prop = new G4MaterialPropertiesTable();
-  air_prop->AddProperty("RINDEX", KVC_Optical::E_Air, std::vector<G4double>{air_rindex, air_rindex});
+  air_prop->AddProperty("RINDEX", KVC_Optical::E_Air, AirRindex());
   m_material_map["Air"]->SetMaterialPropertiesTable(air_prop);
   
   // +----------------------+
@@ -311,11 +327,9 @@ DetectorConstruction::AddOpticalProperties()
   // | Teflon Property |
   // +-----------------+
   G4int wrap_type = gConfMan.GetInt("wrap_type");
-  G4double teflon_rindex = 1.35;
-  if (gConfMan.Check("teflon_rindex")) teflon_rindex = gConfMan.GetDouble("teflon_rindex");
   
   auto teflon_prop = new G4MaterialPropertiesTable();
-  teflon_prop->AddProperty("RINDEX", KVC_Optical::E_Teflon, std::vector<G4double>{teflon_rindex, teflon_rindex});
+  teflon_prop->AddProperty("RINDEX", KVC_Optical::E_Teflon, TeflonRindex());
   
   if (wrap_type == 3) {
       // Transmissive Teflon: Long Absorption Length
@@ -364,6 +378,97 @@ DetectorConstruction::AddOpticalProperties()
 }
 
 //_____________________________________________________________________________
+std::vector<G4double>
+DetectorConstruction::QuartzAbsLength() const
+{
+  std::vector<G4double> r_quartz_abs = KVC_Optical::R_Quartz_ABS;
+  if (gConfMan.Check("quartz_abs_scale")) {
+      G4double scale = gConfMan.GetDouble("quartz_abs_scale");
+      for(auto& val : r_quartz_abs) val *= scale;
+  }
+  return r_quartz_abs;
+}
+
+//_____________________________________________________________________________
+std::vector<G4double>
+DetectorConstruction::AirRindex() const
+{
+  G4double air_rindex = 1.0;
+  if (gConfMan.Check("air_rindex")) air_rindex = gConfMan.GetDouble("air_rindex");
+  return { air_rindex, air_rindex };
+}
+
+//_____________________________________________________________________________
+std::vector<G4double>
+DetectorConstruction::TeflonRindex() const
+{
+  G4double teflon_rindex = 1.35;
+  if (gConfMan.Check("teflon_rindex")) teflon_rindex = gConfMan.GetDouble("teflon_rindex");
+  return { teflon_rindex, teflon_rindex };
+}
+
+//_____________________________________________________________________________
+// Re-applies changed conf keys to the existing optical tables between runs
+// (parameter sweeps). Only the tables that depend on the changed keys are
+// rebuilt; geometry keys cannot change without a new process. Returns true
+// when a refractive index changed and the physics tables must be rebuilt.
+G4bool
+DetectorConstruction::UpdateOpticalParameters(const std::set<std::string>& keys)
+{
+  static const std::set<std::string> geometry_keys = {
+    "quartz_thickness", "air_layer_thickness", "wrapper_thickness",
+    "do_segmentize", "wrap_type", "n_segments", "segment_pitch"
+  };
+  G4bool quartz_surface = false, wrapper_surface = false, mppc_surface = false;
+  G4bool physics_modified = false;
+
+  for (const auto& full_key : keys) {
+    // "seg<i>.<key>": same tables as <key>, rebuilt for every segment
+    const std::size_t dot = full_key.find('.');
+    const std::string key = (dot == std::string::npos) ? full_key : full_key.substr(dot + 1);
+    if (geometry_keys.count(key)) {
+      G4Exception("DetectorConstruction::UpdateOpticalParameters", "GeometryKey",
+                  FatalException, ("'" + full_key + "' changes the geometry and cannot be swept in-process").c_str());
+    }
+    if (G4StrUtil::starts_with(key, "quartz_") || G4StrUtil::starts_with(key, "Quartz_")
+        || key == "sigma_alpha") {
+      if (key == "quartz_abs_scale") {
+        auto mpt = m_material_map["QuartzKVC"]->GetMaterialPropertiesTable();
+        mpt->RemoveProperty("ABSLENGTH");
+        mpt->AddProperty("ABSLENGTH", KVC_Optical::E_Quartz_ABS, QuartzAbsLength());
+      } else {
+        quartz_surface = true;
+      }
+    } else if (key == "air_rindex" || key == "teflon_rindex") {
+      // RINDEX also feeds the Cerenkov tables: replace it in the existing
+      // table and let the run manager rebuild physics.
+      const G4bool air = (key == "air_rindex");
+      auto mpt = m_material_map[air ? "Air" : "Teflon"]->GetMaterialPropertiesTable();
+      mpt->RemoveProperty("RINDEX");
+      if (air) mpt->AddProperty("RINDEX", KVC_Optical::E_Air, AirRindex());
+      else     mpt->AddProperty("RINDEX", KVC_Optical::E_Teflon, TeflonRindex());
+      physics_modified = true;
+    } else if (G4StrUtil::starts_with(key, "teflon_") || G4StrUtil::starts_with(key, "ej510_")
+               || key == "is_teflon" || key == "is_paint") {
+      wrapper_surface = true;
+    } else if (key == "qe_scale") {
+      mppc_surface = true; // Method B picks qe_scale up in MPPCSD::Initialize
+    }
+  }
+
+  for (std::size_t i = 0; i < m_segments.size(); ++i) {
+    if (quartz_surface)  ConfigureQuartzSurface(i);
+    if (wrapper_surface) ConfigureWrapperSurface(i);
+  }
+  if (mppc_surface)    ConfigureMppcSurface();
+  return physics_modified;
+}
+
+//_____________________________________________________________________________
+// One segment, or n_segments of them side by side along x, each in its own
+// air mother volume (copy number = segment index) with its wrapper, MPPCs
+// and blacksheet. The radiator, MPPC and blacksheet logical volumes are
+// shared; the wrapper material follows the segment's wrap_type.
 void
 DetectorConstruction::ConstructKVC()
 {
@@ -371,14 +476,13 @@ DetectorConstruction::ConstructKVC()
   using CLHEP::deg;
   using CLHEP::eV;
 
-  G4PhysicalVolumeStore* store = G4PhysicalVolumeStore::GetInstance();
+  const SimParameters& params = SimParameters::Get();
 
   // Parameters from ConfManager 
   G4double quartz_thickness    = gConfMan.GetDouble("quartz_thickness") * mm;
   G4double air_layer_thickness = gConfMan.GetDouble("air_layer_thickness") * mm;
   G4double wrapper_thickness   = gConfMan.GetDouble("wrapper_thickness") * mm;
   G4int do_segmentize          = gConfMan.GetInt("do_segmentize");
-  G4int wrap_type              = gConfMan.GetInt("wrap_type");
 
   G4ThreeVector kvc_size = (do_segmentize == 1)
     ? G4ThreeVector(26.0 * mm, 120.0 * mm, quartz_thickness)
@@ -386,15 +490,11 @@ DetectorConstruction::ConstructKVC()
 
   G4ThreeVector origin_pos(0.0*mm, 0.0*mm, 0.0*mm);
 
-  // Mother Volume (Air)
+  // Mother Volume (Air): neighbouring segments share a face
   auto mother_solid = new G4Box("KvcMotherSolid", 
-                                kvc_size.x()/2.0 + 50.0*mm,
+                                params.n_segments > 0 ? params.segment_pitch/2.0 : kvc_size.x()/2.0 + 50.0*mm,
                                 kvc_size.y()/2.0 + 50.0*mm,
                                 kvc_size.z()/2.0 + 50.0*mm); 
-  m_mother_lv = new G4LogicalVolume(mother_solid, m_material_map["Air"], "KvcMotherLV");
-  m_mother_pv = new G4PVPlacement(nullptr, origin_pos, m_mother_lv,
-                                  "KvcMotherPV", m_world_lv, false, 0, m_check_overlaps);
-  m_mother_lv->SetVisAttributes(G4VisAttributes::GetInvisible());
 
   // Radiator
   auto kvc_solid = new G4Box("KvcSolid", 
@@ -402,20 +502,16 @@ DetectorConstruction::ConstructKVC()
 			     kvc_size.y()/2.0,
 			     kvc_size.z()/2.0);
   auto kvc_lv = new G4LogicalVolume(kvc_solid, m_material_map["QuartzKVC"], "KvcLV");  
-  m_kvc_pv = new G4PVPlacement(nullptr, origin_pos, kvc_lv, "KvcPV",
-                               m_mother_lv, false, 0, m_check_overlaps);
   kvc_lv->SetVisAttributes(G4Colour::Yellow());
 
-  // Wrapper
-  G4Material* wrap_material = nullptr;
-  if      (wrap_type == 0) wrap_material = m_material_map["Teflon"];
-  else if (wrap_type == 1) wrap_material = m_material_map["Mylar"];
-  else if (wrap_type == 2) wrap_material = m_material_map["EJ510"];
-  else if (wrap_type == 3) wrap_material = m_material_map["Teflon"]; // Transmissive Teflon
-  else {
-    G4Exception("DetectorConstruction::ConstructKVC", "InvalidWrapType", FatalException, "wrap_type must be 0,1,2,3");
+  if (PhotonLUT::LookupMode()) {
+    m_kvc_region = new G4Region("KvcRegion");
+    m_kvc_region->AddRootLogicalVolume(kvc_lv);
+    m_kvc_region->SetProductionCuts(
+      G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
   }
 
+  // Wrapper
   auto wrap_solid_full = new G4Box("WrapSolidFull",
 			     kvc_size.x()/2.0 + air_layer_thickness + wrapper_thickness,
 			     kvc_size.y()/2.0,
@@ -426,46 +522,17 @@ DetectorConstruction::ConstructKVC()
 			     kvc_size.z()/2.0 + air_layer_thickness);
   
   G4SubtractionSolid* wrap_solid = new G4SubtractionSolid("WrapSolid", wrap_solid_full, wrap_solid_cut, nullptr, origin_pos);
-  auto wrap_lv = new G4LogicalVolume(wrap_solid, wrap_material, "WrapLV");
-  m_wrap_pv = new G4PVPlacement(nullptr, origin_pos, wrap_lv, "WrapPV", m_mother_lv, false, 0, m_check_overlaps); 
-  wrap_lv->SetVisAttributes(G4Colour::White());
 
   // MPPC 
   G4ThreeVector mppc_size(6.0*mm, 6.0*mm, 1.0*mm);
   auto mppc_solid = new G4Box("MppcSolid", mppc_size.x()/2.0, mppc_size.y()/2.0, mppc_size.z()/2.0);
   auto mppc_lv = new G4LogicalVolume(mppc_solid, m_material_map["Epoxi"], "MppcLV");
-  
-  auto rot = new G4RotationMatrix;
-  rot->rotateX(90.0*deg);
-  G4int n_mppc = (do_segmentize == 1) ? 4 : 16;
-  G4double offset = 0.0 * mm;
-
-  if (6.0*mm < quartz_thickness && quartz_thickness < 12.0*mm) {
-    for(G4int i=0; i<n_mppc; ++i){
-      G4ThreeVector pos_up(-(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), kvc_size.y()/2.0 + mppc_size.z()/2.0 + offset, 0.0*mm);
-      G4ThreeVector pos_low(-(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), -kvc_size.y()/2.0 - mppc_size.z()/2.0 - offset, 0.0*mm);
-      m_mppc_pvs.push_back(new G4PVPlacement(rot, pos_up,  mppc_lv, "MppcPV", m_mother_lv, false, i,          m_check_overlaps));
-      m_mppc_pvs.push_back(new G4PVPlacement(rot, pos_low, mppc_lv, "MppcPV", m_mother_lv, false, i+n_mppc,   m_check_overlaps));
-    }
-  } else if (12.0*mm <= quartz_thickness) {
-    for(G4int i=0; i<n_mppc; ++i){
-      G4double z_offset = quartz_thickness/6.0 + 1.0*mm;
-      G4ThreeVector pos_up1( -(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), kvc_size.y()/2.0 + mppc_size.z()/2.0 + offset,  z_offset);
-      G4ThreeVector pos_up2( -(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), kvc_size.y()/2.0 + mppc_size.z()/2.0 + offset, -z_offset);
-      G4ThreeVector pos_low1(-(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), -kvc_size.y()/2.0 - mppc_size.z()/2.0 - offset,  z_offset);
-      G4ThreeVector pos_low2(-(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), -kvc_size.y()/2.0 - mppc_size.z()/2.0 - offset, -z_offset);
-      m_mppc_pvs.push_back(new G4PVPlacement(rot, pos_up1,  mppc_lv, "MppcPV", m_mother_lv, false, i,          m_check_overlaps));
-      m_mppc_pvs.push_back(new G4PVPlacement(rot, pos_up2,  mppc_lv, "MppcPV", m_mother_lv, false, i+n_mppc,   m_check_overlaps));
-      m_mppc_pvs.push_back(new G4PVPlacement(rot, pos_low1, mppc_lv, "MppcPV", m_mother_lv, false, i+2*n_mppc, m_check_overlaps));
-      m_mppc_pvs.push_back(new G4PVPlacement(rot, pos_low2, mppc_lv, "MppcPV", m_mother_lv, false, i+3*n_mppc, m_check_overlaps));
-    }
-  } else {
+  m_mppc_lv = mppc_lv;
+  mppc_lv->SetVisAttributes(G4Colour::Blue());
+
+  if (quartz_thickness <= 6.0*mm) {
     G4Exception("DetectorConstruction::ConstructKVC", "InvalidQuartzThickness", FatalException, "Quartz thickness too small.");
   }
-  mppc_lv->SetVisAttributes(G4Colour::Blue());
-  auto mppcSD = new MPPCSD("mppcSD");
-  G4SDManager::GetSDMpointer()->AddNewDetector(mppcSD);
-  mppc_lv->SetSensitiveDetector(mppcSD);
 
   // Blacksheet
   auto blacksheet_solid_full = new G4Box("BlacksheetSolidFull",
@@ -478,8 +545,71 @@ DetectorConstruction::ConstructKVC()
                                          kvc_size.z()/2.0 + air_layer_thickness + wrapper_thickness + 1.0*mm);
   auto blacksheet_solid = new G4SubtractionSolid("BlacksheetSolid", blacksheet_solid_full, blacksheet_solid_cut, nullptr, origin_pos);
   m_blacksheet_lv = new G4LogicalVolume(blacksheet_solid, m_material_map["Blacksheet"], "BlacksheetLV");
-  new G4PVPlacement(nullptr, origin_pos, m_blacksheet_lv, "BlacksheetPV", m_mother_lv, false, 0, m_check_overlaps);
   m_blacksheet_lv->SetVisAttributes(G4Colour::Black());
+
+  // The Teflon bulk (AddOpticalProperties) follows the global wrap_type:
+  // transmissive Teflon cannot be mixed with the others.
+  const G4bool transmissive = (gConfMan.GetInt("wrap_type") == 3);
+
+  m_segments.assign(params.NSegments(), Segment());
+  for (G4int seg = 0; seg < params.NSegments(); ++seg) {
+    Segment& segment = m_segments[seg];
+    G4ThreeVector mother_pos(params.SegmentOffset(seg), 0.0*mm, 0.0*mm);
+
+    auto mother_lv = new G4LogicalVolume(mother_solid, m_material_map["Air"], "KvcMotherLV");
+    segment.mother_pv = new G4PVPlacement(nullptr, mother_pos, mother_lv,
+                                          "KvcMotherPV", m_world_lv, false, seg, m_check_overlaps);
+    mother_lv->SetVisAttributes(G4VisAttributes::GetInvisible());
+
+    segment.kvc_pv = new G4PVPlacement(nullptr, origin_pos, kvc_lv, "KvcPV",
+                                       mother_lv, false, 0, m_check_overlaps);
+
+    G4int wrap_type = gConfMan.GetInt(params.SegmentKey(seg, "wrap_type"));
+    G4Material* wrap_material = nullptr;
+    if      (wrap_type == 0) wrap_material = m_material_map["Teflon"];
+    else if (wrap_type == 1) wrap_material = m_material_map["Mylar"];
+    else if (wrap_type == 2) wrap_material = m_material_map["EJ510"];
+    else if (wrap_type == 3) wrap_material = m_material_map["Teflon"]; // Transmissive Teflon
+    else {
+      G4Exception("DetectorConstruction::ConstructKVC", "InvalidWrapType", FatalException, "wrap_type must be 0,1,2,3");
+    }
+    if ((wrap_type == 3) != transmissive) {
+      G4Exception("DetectorConstruction::ConstructKVC", "InvalidWrapType", FatalException,
+                  "wrap_type 3 (transmissive Teflon) cannot be mixed with other wrap types");
+    }
+    auto wrap_lv = new G4LogicalVolume(wrap_solid, wrap_material, "WrapLV");
+    segment.wrap_pv = new G4PVPlacement(nullptr, origin_pos, wrap_lv, "WrapPV", mother_lv, false, 0, m_check_overlaps); 
+    wrap_lv->SetVisAttributes(G4Colour::White());
+
+    auto rot = new G4RotationMatrix;
+    rot->rotateX(90.0*deg);
+    G4int n_mppc = (do_segmentize == 1) ? 4 : 16;
+    G4double offset = 0.0 * mm;
+    auto& mppc_pvs = segment.mppc_pvs;
+
+    if (quartz_thickness < 12.0*mm) {
+      for(G4int i=0; i<n_mppc; ++i){
+        G4ThreeVector pos_up(-(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), kvc_size.y()/2.0 + mppc_size.z()/2.0 + offset, 0.0*mm);
+        G4ThreeVector pos_low(-(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), -kvc_size.y()/2.0 - mppc_size.z()/2.0 - offset, 0.0*mm);
+        mppc_pvs.push_back(new G4PVPlacement(rot, pos_up,  mppc_lv, "MppcPV", mother_lv, false, i,          m_check_overlaps));
+        mppc_pvs.push_back(new G4PVPlacement(rot, pos_low, mppc_lv, "MppcPV", mother_lv, false, i+n_mppc,   m_check_overlaps));
+      }
+    } else {
+      for(G4int i=0; i<n_mppc; ++i){
+        G4double z_offset = quartz_thickness/6.0 + 1.0*mm;
+        G4ThreeVector pos_up1( -(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), kvc_size.y()/2.0 + mppc_size.z()/2.0 + offset,  z_offset);
+        G4ThreeVector pos_up2( -(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), kvc_size.y()/2.0 + mppc_size.z()/2.0 + offset, -z_offset);
+        G4ThreeVector pos_low1(-(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), -kvc_size.y()/2.0 - mppc_size.z()/2.0 - offset,  z_offset);
+        G4ThreeVector pos_low2(-(mppc_size.x() + 0.5*mm) * ((n_mppc-1)/2.0 - i), -kvc_size.y()/2.0 - mppc_size.z()/2.0 - offset, -z_offset);
+        mppc_pvs.push_back(new G4PVPlacement(rot, pos_up1,  mppc_lv, "MppcPV", mother_lv, false, i,          m_check_overlaps));
+        mppc_pvs.push_back(new G4PVPlacement(rot, pos_up2,  mppc_lv, "MppcPV", mother_lv, false, i+n_mppc,   m_check_overlaps));
+        mppc_pvs.push_back(new G4PVPlacement(rot, pos_low1, mppc_lv, "MppcPV", mother_lv, false, i+2*n_mppc, m_check_overlaps));
+        mppc_pvs.push_back(new G4PVPlacement(rot, pos_low2, mppc_lv, "MppcPV", mother_lv, false, i+3*n_mppc, m_check_overlaps));
+      }
+    }
+
+    new G4PVPlacement(nullptr, origin_pos, m_blacksheet_lv, "BlacksheetPV", mother_lv, false, 0, m_check_overlaps);
+  }
 }
 
 //_____________________________________________________________________________
@@ -489,21 +619,108 @@ DetectorConstruction::AddSurfaceProperties()
   using CLHEP::mm;
   using CLHEP::eV;
 
-  G4int wrap_type              = gConfMan.GetInt("wrap_type");
   G4double air_layer_thickness = gConfMan.GetDouble("air_layer_thickness") * mm;
-  G4int quartz_finish          = gConfMan.GetInt("quartz_finish");  // 0:polished, 1:ground
-  G4double sigma_alpha         = 0.0;
-  if (gConfMan.Check("Quartz_A_Alpha") && quartz_finish == 0) {
-      sigma_alpha = gConfMan.GetDouble("Quartz_A_Alpha");
-  } else if (gConfMan.Check("Quartz_B_Alpha") && quartz_finish == 1) {
-      sigma_alpha = gConfMan.GetDouble("Quartz_B_Alpha");
-  } else if (gConfMan.Check("sigma_alpha")) {
-      sigma_alpha = gConfMan.GetDouble("sigma_alpha");
-  }
 
   // Quartz Surface (used ONLY for Quartz-Air and Quartz-Wrap boundaries;
   // Quartz-MPPC boundary uses surface_mppc below, i.e. polished / mirror-like.)
-  auto surface_quartz = new G4OpticalSurface("surface_quartz");
+  // and Wrapper Surface, one pair per segment
+  for (std::size_t seg = 0; seg < m_segments.size(); ++seg) {
+    Segment& segment = m_segments[seg];
+    segment.surface_quartz = new G4OpticalSurface("surface_quartz");
+    ConfigureQuartzSurface(seg);
+    auto surface_quartz = segment.surface_quartz;
+
+    segment.surface_wrapper = new G4OpticalSurface("surface_wrapper");
+    ConfigureWrapperSurface(seg);
+    G4OpticalSurface* wrap_surface = segment.surface_wrapper;
+
+    // Border Surfaces
+    auto kvc_pv = segment.kvc_pv, mother_pv = segment.mother_pv, wrap_pv = segment.wrap_pv;
+    if (air_layer_thickness > 0.0) {
+      new G4LogicalBorderSurface("QuartzToAir", kvc_pv,    mother_pv, surface_quartz);
+      new G4LogicalBorderSurface("AirToQuartz", mother_pv, kvc_pv,    surface_quartz);
+      new G4LogicalBorderSurface("AirToWrap",   mother_pv, wrap_pv,   wrap_surface);
+      new G4LogicalBorderSurface("WrapToAir",   wrap_pv,   mother_pv, wrap_surface);
+    } else {
+      new G4LogicalBorderSurface("QuartzToWrap", kvc_pv,  wrap_pv, wrap_surface);
+      new G4LogicalBorderSurface("WrapToQuartz", wrap_pv, kvc_pv,  wrap_surface);
+    }
+  }
+
+  // BlackSheet Surface
+  auto surface_bs = new G4OpticalSurface("surface_bs", unified, ground, dielectric_metal);
+  auto bs_prop = new G4MaterialPropertiesTable();
+  bs_prop->AddProperty("REFLECTIVITY", KVC_Optical::E_Blacksheet, KVC_Optical::R_Blacksheet_REFLECTIVITY);
+  surface_bs->SetMaterialPropertiesTable(bs_prop);
+  if (m_blacksheet_lv) new G4LogicalSkinSurface("BlackSheetSurface", m_blacksheet_lv, surface_bs);
+
+#ifdef USE_SURFACE_PDE
+  // MPPC Surface (Added for Method A). The skin is on the shared MppcLV, so
+  // its EFFICIENCY follows the global qe_scale, not seg<i>.qe_scale.
+  auto mppc_lv = m_mppc_lv;
+  if (mppc_lv) {
+      m_surface_mppc = new G4OpticalSurface("surface_mppc");
+      auto surface_mppc = m_surface_mppc;
+      surface_mppc->SetType(dielectric_dielectric);
+      surface_mppc->SetFinish(polished);
+      surface_mppc->SetModel(unified); // or glisur
+      ConfigureMppcSurface();
+      new G4LogicalSkinSurface("MppcSurface", mppc_lv, surface_mppc);
+
+      // Quartz–MPPC interface: always polished (mirror-like), not ground/frosted.
+      for (const auto& segment : m_segments) {
+          for (size_t i = 0; i < segment.mppc_pvs.size(); ++i) {
+              new G4LogicalBorderSurface("QuartzToMppc", segment.kvc_pv, segment.mppc_pvs[i], surface_mppc);
+              new G4LogicalBorderSurface("MppcToQuartz", segment.mppc_pvs[i], segment.kvc_pv, surface_mppc);
+          }
+      }
+  }
+#endif
+
+  // --- Always apply physical optical boundary for Quartz to MPPC to allow Fresnel reflection ---
+  // Even if we don't use surface PDE (Method B SD handles detection), 
+  // we MUST simulate physical reflection at the boundary.
+  auto mppc_lv_for_reflection = m_mppc_lv;
+  if (mppc_lv_for_reflection) {
+      auto surface_mppc_refl = new G4OpticalSurface("surface_mppc_refl");
+      surface_mppc_refl->SetType(dielectric_dielectric);
+      surface_mppc_refl->SetFinish(polished);
+      surface_mppc_refl->SetModel(unified);
+      
+      // Note: Material properties like RINDEX are already attached to Epoxi.
+      // A bare dielectric_dielectric polished surface uses the RINDEX of the two materials
+      // (Quartz and Epoxi) to correctly calculate Fresnel reflection and transmission.
+      for (const auto& segment : m_segments) {
+          for (size_t i = 0; i < segment.mppc_pvs.size(); ++i) {
+              // Creating a border surface enables Fresnel reflection between Quartz and MPPC
+              new G4LogicalBorderSurface("QuartzToMppcRefl", segment.kvc_pv, segment.mppc_pvs[i], surface_mppc_refl);
+              new G4LogicalBorderSurface("MppcToQuartzRefl", segment.mppc_pvs[i], segment.kvc_pv, surface_mppc_refl);
+          }
+      }
+  }
+}
+
+//_____________________________________________________________________________
+// Finish, roughness and unified-model constants of the quartz surface of one
+// segment ("seg<i>.<key>" overrides <key>). Also used between sweep points to
+// re-apply changed parameters.
+void
+DetectorConstruction::ConfigureQuartzSurface(G4int segment)
+{
+  const SimParameters& params = SimParameters::Get();
+  auto key = [&](const std::string& name) { return params.SegmentKey(segment, name); };
+
+  G4int quartz_finish          = gConfMan.GetInt(key("quartz_finish"));  // 0:polished, 1:ground
+  G4double sigma_alpha         = 0.0;
+  if (gConfMan.Check(key("Quartz_A_Alpha")) && quartz_finish == 0) {
+      sigma_alpha = gConfMan.GetDouble(key("Quartz_A_Alpha"));
+  } else if (gConfMan.Check(key("Quartz_B_Alpha")) && quartz_finish == 1) {
+      sigma_alpha = gConfMan.GetDouble(key("Quartz_B_Alpha"));
+  } else if (gConfMan.Check(key("sigma_alpha"))) {
+      sigma_alpha = gConfMan.GetDouble(key("sigma_alpha"));
+  }
+
+  auto surface_quartz = m_segments[segment].surface_quartz;
   surface_quartz->SetModel(unified);
   surface_quartz->SetType(dielectric_dielectric);
   if(quartz_finish == 1){
@@ -515,25 +732,28 @@ DetectorConstruction::AddSurfaceProperties()
 
   auto quartz_prop = new G4MaterialPropertiesTable();
   std::vector<G4double> e_surface = KVC_Optical::E_Unified_Surface;
-  quartz_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble("quartz_specularLobe"), true);
-  quartz_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble("quartz_specularSpike"), true);
-  quartz_prop->AddConstProperty("BACKSCATTERCONSTANT",  gConfMan.GetDouble("quartz_backScatter"), true);
+  quartz_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble(key("quartz_specularLobe")), true);
+  quartz_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble(key("quartz_specularSpike")), true);
+  quartz_prop->AddConstProperty("BACKSCATTERCONSTANT",  gConfMan.GetDouble(key("quartz_backScatter")), true);
 
-  G4double q_boundary_r = gConfMan.GetDouble("quartz_boundary_reflectivity");
+  G4double q_boundary_r = gConfMan.GetDouble(key("quartz_boundary_reflectivity"));
   if (q_boundary_r >= 0.0) {
       quartz_prop->AddProperty("REFLECTIVITY", e_surface, std::vector<G4double>{q_boundary_r, q_boundary_r});
   }
 
-  surface_quartz->SetMaterialPropertiesTable(quartz_prop);
+  ReplaceSurfaceTable(surface_quartz, quartz_prop);
+}
 
-  // Wrapper Surface
-  G4OpticalSurface* wrap_surface = nullptr;
+//_____________________________________________________________________________
+void
+DetectorConstruction::ConfigureWrapperSurface(G4int segment)
+{
+  const SimParameters& params = SimParameters::Get();
+  auto key = [&](const std::string& name) { return params.SegmentKey(segment, name); };
 
-  // Wrappers (Teflon, Mylar, EJ-510)
-  // Shared logic for wrapper configuration to avoid code duplication and confusion
-  // Specific material properties are selected based on wrap_type
+  G4int wrap_type = gConfMan.GetInt(key("wrap_type"));
 
-  G4OpticalSurface* surface_wrapper = new G4OpticalSurface("surface_wrapper");
+  G4OpticalSurface* surface_wrapper = m_segments[segment].surface_wrapper;
   surface_wrapper->SetModel(unified);
 
   auto wrapper_prop = new G4MaterialPropertiesTable();
@@ -545,38 +765,38 @@ DetectorConstruction::AddSurfaceProperties()
   if (wrap_type == 0) { // Teflon
       surface_wrapper->SetType(dielectric_dielectric);
       surface_wrapper->SetFinish(groundfrontpainted);
-      surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble("teflon_sigma_alpha")); 
+      surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble(key("teflon_sigma_alpha"))); 
 
       std::vector<G4double> r_ptfe = KVC_Optical::R_PTFE_Thin;
       // Note: In v118 original, scaling might have been 1.0. We use the config value.
-      G4double r_scale = gConfMan.GetDouble("teflon_reflectivity_scale");
+      G4double r_scale = gConfMan.GetDouble(key("teflon_reflectivity_scale"));
       for(auto& r : r_ptfe) r *= r_scale;
       wrapper_prop->AddProperty("REFLECTIVITY", KVC_Optical::Energy, r_ptfe);
 
-      wrapper_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble("teflon_specularLobe"), true);
-      wrapper_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble("teflon_specularSpike"), true);
-      wrapper_prop->AddConstProperty("BACKSCATTERCONSTANT",   gConfMan.GetDouble("teflon_backScatter"), true);
-      wrapper_prop->AddConstProperty("DIFFUSELOBECONSTANT",    gConfMan.GetDouble("teflon_diffuseLobe"), true);
+      wrapper_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble(key("teflon_specularLobe")), true);
+      wrapper_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble(key("teflon_specularSpike")), true);
+      wrapper_prop->AddConstProperty("BACKSCATTERCONSTANT",   gConfMan.GetDouble(key("teflon_backScatter")), true);
+      wrapper_prop->AddConstProperty("DIFFUSELOBECONSTANT",    gConfMan.GetDouble(key("teflon_diffuseLobe")), true);
 
   } else if (wrap_type == 1) { // Specular Wrapper (Mylar, Teflon, or Paint)
       G4bool is_teflon = false;
       G4bool is_paint  = false;
-      if (gConfMan.Check("is_teflon")) is_teflon = (gConfMan.GetInt("is_teflon") == 1);
-      if (gConfMan.Check("is_paint"))  is_paint  = (gConfMan.GetInt("is_paint") == 1);
+      if (gConfMan.Check(key("is_teflon"))) is_teflon = (gConfMan.GetInt(key("is_teflon")) == 1);
+      if (gConfMan.Check(key("is_paint")))  is_paint  = (gConfMan.GetInt(key("is_paint")) == 1);
 
       surface_wrapper->SetType(dielectric_metal);
       
       if (is_teflon) {
           surface_wrapper->SetFinish(ground);
-          surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble("teflon_sigma_alpha"));
+          surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble(key("teflon_sigma_alpha")));
           
-          G4double r_scale = gConfMan.GetDouble("teflon_reflectivity_scale");
+          G4double r_scale = gConfMan.GetDouble(key("teflon_reflectivity_scale"));
           std::vector<G4double> r_ptfe = KVC_Optical::R_PTFE_Thin;
           for(auto& r : r_ptfe) r *= r_scale;
           wrapper_prop->AddProperty("REFLECTIVITY", KVC_Optical::Energy, r_ptfe);
       } else if (is_paint) {
           surface_wrapper->SetFinish(ground);
-          surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble("ej510_sigma_alpha"));
+          surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble(key("ej510_sigma_alpha")));
           wrapper_prop->AddProperty("REFLECTIVITY", KVC_Optical::Energy, KVC_Optical::R_EJ510);
       } else {
           // Default: Mylar (Seg 1)
@@ -589,28 +809,28 @@ DetectorConstruction::AddSurfaceProperties()
       surface_wrapper->SetFinish(groundfrontpainted);
       
       G4bool is_teflon = false;
-      if (gConfMan.Check("is_teflon")) is_teflon = (gConfMan.GetInt("is_teflon") == 1);
+      if (gConfMan.Check(key("is_teflon"))) is_teflon = (gConfMan.GetInt(key("is_teflon")) == 1);
 
       if (is_teflon) {
-          surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble("teflon_sigma_alpha"));
+          surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble(key("teflon_sigma_alpha")));
           
-          G4double r_scale = gConfMan.GetDouble("teflon_reflectivity_scale");
+          G4double r_scale = gConfMan.GetDouble(key("teflon_reflectivity_scale"));
           std::vector<G4double> r_vec = KVC_Optical::R_EJ510; // Use Paint grid as base for volume model
           for(auto& r : r_vec) r *= r_scale;
           wrapper_prop->AddProperty("REFLECTIVITY", KVC_Optical::Energy, r_vec);
 
-          wrapper_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble("teflon_specularLobe"), true);
-          wrapper_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble("teflon_specularSpike"), true);
-          wrapper_prop->AddConstProperty("BACKSCATTERCONSTANT",   gConfMan.GetDouble("teflon_backScatter"), true);
-          wrapper_prop->AddConstProperty("DIFFUSELOBECONSTANT",    gConfMan.GetDouble("teflon_diffuseLobe"), true);
+          wrapper_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble(key("teflon_specularLobe")), true);
+          wrapper_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble(key("teflon_specularSpike")), true);
+          wrapper_prop->AddConstProperty("BACKSCATTERCONSTANT",   gConfMan.GetDouble(key("teflon_backScatter")), true);
+          wrapper_prop->AddConstProperty("DIFFUSELOBECONSTANT",    gConfMan.GetDouble(key("teflon_diffuseLobe")), true);
       } else {
-          surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble("ej510_sigma_alpha")); 
+          surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble(key("ej510_sigma_alpha"))); 
 
           wrapper_prop->AddProperty("REFLECTIVITY", KVC_Optical::Energy, KVC_Optical::R_EJ510);
-          wrapper_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble("ej510_specularLobe"), true);
-          wrapper_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble("ej510_specularSpike"), true);
-          wrapper_prop->AddConstProperty("BACKSCATTERCONSTANT",   gConfMan.GetDouble("ej510_backScatter"), true);
-          wrapper_prop->AddConstProperty("DIFFUSELOBECONSTANT",    gConfMan.GetDouble("ej510_diffuseLobe"), true);
+          wrapper_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble(key("ej510_specularLobe")), true);
+          wrapper_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble(key("ej510_specularSpike")), true);
+          wrapper_prop->AddConstProperty("BACKSCATTERCONSTANT",   gConfMan.GetDouble(key("ej510_backScatter")), true);
+          wrapper_prop->AddConstProperty("DIFFUSELOBECONSTANT",    gConfMan.GetDouble(key("ej510_diffuseLobe")), true);
       }
 
   } else if (wrap_type == 3) { // Transmissive Teflon (Transmission Mode)
@@ -619,101 +839,50 @@ DetectorConstruction::AddSurfaceProperties()
       // Requires Teflon RINDEX (defined) and long ABSLENGTH (set in AddOpticalProperties).
       surface_wrapper->SetType(dielectric_dielectric);
       surface_wrapper->SetFinish(ground); 
-      surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble("teflon_sigma_alpha")); 
+      surface_wrapper->SetSigmaAlpha(gConfMan.GetDouble(key("teflon_sigma_alpha"))); 
 
       // Note: Do NOT set REFLECTIVITY here. Let Fresnel handle R vs T.
       // But we can set SigmaAlpha and Lobes for the *Surface* interaction.
-      wrapper_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble("teflon_specularLobe"), true);
-      wrapper_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble("teflon_specularSpike"), true);
-      wrapper_prop->AddConstProperty("BACKSCATTERCONSTANT",   gConfMan.GetDouble("teflon_backScatter"), true);
+      wrapper_prop->AddConstProperty("SPECULARLOBECONSTANT",  gConfMan.GetDouble(key("teflon_specularLobe")), true);
+      wrapper_prop->AddConstProperty("SPECULARSPIKECONSTANT", gConfMan.GetDouble(key("teflon_specularSpike")), true);
+      wrapper_prop->AddConstProperty("BACKSCATTERCONSTANT",   gConfMan.GetDouble(key("teflon_backScatter")), true);
       
       // Check Transmission? wrapper_prop->AddProperty("TRANSMITTANCE", ...) ? 
       // For 'dielectric_dielectric', T is implicit.
 
   } else {
-       G4Exception("DetectorConstruction::AddSurfaceProperties", "InvalidWrapType", FatalException, "wrap_type must be 0,1,2,3");
-  }
-
-  surface_wrapper->SetMaterialPropertiesTable(wrapper_prop);
-
-  // Assign the created wrapper surface
-  wrap_surface = surface_wrapper;
-
-  // Border Surfaces
-  if (m_kvc_pv && m_mother_pv && m_wrap_pv) {
-    if (air_layer_thickness > 0.0) {
-      new G4LogicalBorderSurface("QuartzToAir", m_kvc_pv,    m_mother_pv, surface_quartz);
-      new G4LogicalBorderSurface("AirToQuartz", m_mother_pv, m_kvc_pv,    surface_quartz);
-      new G4LogicalBorderSurface("AirToWrap",   m_mother_pv, m_wrap_pv,   wrap_surface);
-      new G4LogicalBorderSurface("WrapToAir",   m_wrap_pv,   m_mother_pv, wrap_surface);
-    } else {
-      new G4LogicalBorderSurface("QuartzToWrap", m_kvc_pv,  m_wrap_pv, wrap_surface);
-      new G4LogicalBorderSurface("WrapToQuartz", m_wrap_pv, m_kvc_pv,  wrap_surface);
-    }
+       G4Exception("DetectorConstruction::ConfigureWrapperSurface", "InvalidWrapType", FatalException, "wrap_type must be 0,1,2,3");
   }
 
-  // BlackSheet Surface
-  auto surface_bs = new G4OpticalSurface("surface_bs", unified, ground, dielectric_metal);
-  auto bs_prop = new G4MaterialPropertiesTable();
-  bs_prop->AddProperty("REFLECTIVITY", KVC_Optical::E_Blacksheet, KVC_Optical::R_Blacksheet_REFLECTIVITY);
-  surface_bs->SetMaterialPropertiesTable(bs_prop);
-  if (m_blacksheet_lv) new G4LogicalSkinSurface("BlackSheetSurface", m_blacksheet_lv, surface_bs);
-
-#ifdef USE_SURFACE_PDE
-  // MPPC Surface (Added for Method A)
-  // Retrieve MppcLV from Store since it's not a member
-  auto mppc_lv = G4LogicalVolumeStore::GetInstance()->GetVolume("MppcLV", false);
-  if (mppc_lv) {
-      auto surface_mppc = new G4OpticalSurface("surface_mppc");
-      surface_mppc->SetType(dielectric_dielectric);
-      surface_mppc->SetFinish(polished);
-      surface_mppc->SetModel(unified); // or glisur
-
-      auto mppc_surf_prop = new G4MaterialPropertiesTable();
-      // Method A: Add EFFICIENCY to the surface
-      G4double qe_scale = 1.0;
-      if (gConfMan.Check("qe_scale")) qe_scale = gConfMan.GetDouble("qe_scale");
-      
-      std::vector<G4double> r_pde = KVC_Optical::R_MPPC_PDE;
-      for(auto& val : r_pde) val *= qe_scale;
+  ReplaceSurfaceTable(surface_wrapper, wrapper_prop);
+}
 
-      mppc_surf_prop->AddProperty("EFFICIENCY", KVC_Optical::E_MPPC_PDE, r_pde);
-      surface_mppc->SetMaterialPropertiesTable(mppc_surf_prop);
-      new G4LogicalSkinSurface("MppcSurface", mppc_lv, surface_mppc);
+//_____________________________________________________________________________
+// Method A: EFFICIENCY of the MPPC surface, with qe_scale folded in.
+void
+DetectorConstruction::ConfigureMppcSurface()
+{
+  if (!m_surface_mppc) return;
+  auto mppc_surf_prop = new G4MaterialPropertiesTable();
+  G4double qe_scale = 1.0;
+  if (gConfMan.Check("qe_scale")) qe_scale = gConfMan.GetDouble("qe_scale");
 
-      // Quartz–MPPC interface: always polished (mirror-like), not ground/frosted.
-      if (m_kvc_pv) {
-          for (size_t i = 0; i < m_mppc_pvs.size(); ++i) {
-              new G4LogicalBorderSurface("QuartzToMppc", m_kvc_pv, m_mppc_pvs[i], surface_mppc);
-              new G4LogicalBorderSurface("MppcToQuartz", m_mppc_pvs[i], m_kvc_pv, surface_mppc);
-          }
-      }
-  }
-#endif
+  std::vector<G4double> r_pde = KVC_Optical::R_MPPC_PDE;
+  for(auto& val : r_pde) val *= qe_scale;
 
-  // --- Always apply physical optical boundary for Quartz to MPPC to allow Fresnel reflection ---
-  // Even if we don't use surface PDE (Method B SD handles detection), 
-  // we MUST simulate physical reflection at the boundary.
-  auto mppc_lv_for_reflection = G4LogicalVolumeStore::GetInstance()->GetVolume("MppcLV", false);
-  if (mppc_lv_for_reflection) {
-      auto surface_mppc_refl = new G4OpticalSurface("surface_mppc_refl");
-      surface_mppc_refl->SetType(dielectric_dielectric);
-      surface_mppc_refl->SetFinish(polished);
-      surface_mppc_refl->SetModel(unified);
-      
-      // Note: Material properties like RINDEX are already attached to Epoxi.
-      // A bare dielectric_dielectric polished surface uses the RINDEX of the two materials
-      // (Quartz and Epoxi) to correctly calculate Fresnel reflection and transmission.
-      if (m_kvc_pv) {
-          for (size_t i = 0; i < m_mppc_pvs.size(); ++i) {
-              // Creating a border surface enables Fresnel reflection between Quartz and MPPC
-              new G4LogicalBorderSurface("QuartzToMppcRefl", m_kvc_pv, m_mppc_pvs[i], surface_mppc_refl);
-              new G4LogicalBorderSurface("MppcToQuartzRefl", m_mppc_pvs[i], m_kvc_pv, surface_mppc_refl);
-          }
-      }
-  }
+  mppc_surf_prop->AddProperty("EFFICIENCY", KVC_Optical::E_MPPC_PDE, r_pde);
+  ReplaceSurfaceTable(m_surface_mppc, mppc_surf_prop);
 }
 
+//_____________________________________________________________________________
+void
+DetectorConstruction::ReplaceSurfaceTable(G4OpticalSurface* surface,
+                                          G4MaterialPropertiesTable* table)
+{
+  auto old_table = surface->GetMaterialPropertiesTable();
+  surface->SetMaterialPropertiesTable(table);
+  if (old_table != table) delete old_table;
+}
 
 //_____________________________________________________________________________
 void DetectorConstruction::DumpMaterialProperties(G4Material* mat)
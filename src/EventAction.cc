@@ -1,11 +1,6 @@
 #include "EventAction.hh"
 #include "AnaManager.hh"
 
-namespace
-{
-  auto& gAnaMan = AnaManager::GetInstance();
-}
-
 EventAction::EventAction() : G4UserEventAction(), fNCherenkovGen(0) {
 }
 
@@ -14,7 +9,7 @@ EventAction::~EventAction() {
 
 //_____________________________________________________________________________
 void EventAction::BeginOfEventAction(const G4Event* anEvent) {
-  gAnaMan.BeginOfEventAction(anEvent);
+  AnaManager::GetInstance().BeginOfEventAction(anEvent);
   fNCherenkovGen = 0; // Initialize Cherenkov photon count
 }
 
@@ -22,8 +17,9 @@ void EventAction::BeginOfEventAction(const G4Event* anEvent) {
 void EventAction::EndOfEventAction(const G4Event* anEvent) {
   G4int eventID = anEvent->GetEventID();
 
-  gAnaMan.SetCherenkovGen(fNCherenkovGen);
-  gAnaMan.EndOfEventAction(anEvent); // Save event data to AnaManager
+  auto& anaMan = AnaManager::GetInstance();
+  anaMan.SetCherenkovGen(fNCherenkovGen);
+  anaMan.EndOfEventAction(anEvent); // Save event data to AnaManager
 
 
   if (eventID % 100 == 0) {
@@ -0,0 +1,119 @@
+#include "EventSeeder.hh"
+#include "Checkpoint.hh"
+#include "ConfManager.hh"
+
+#include "G4ios.hh"
+#include "Randomize.hh"
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+G4long EventSeeder::s_master_seed = 0;
+G4int EventSeeder::s_run_id = 0;
+G4bool EventSeeder::s_replay = false;
+G4bool EventSeeder::s_common = false;
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+
+  // SplitMix64 finalizer: consecutive inputs give uncorrelated outputs.
+  std::uint64_t Mix(std::uint64_t x)
+  {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  void FillSeeds(std::uint64_t h, long seeds[4])
+  {
+    for (G4int i = 0; i < 4; ++i) {
+      h = Mix(h);
+      seeds[i] = static_cast<long>((h & 0x7ffffffeULL) | 1ULL);
+    }
+  }
+
+  // Hash of (master seed, run ID, event ID) of the thread's current event
+  G4ThreadLocal std::uint64_t tEventKey = 0;
+
+  std::uint64_t EventKey(G4long master_seed, G4int run_id, G4int event_id)
+  {
+    std::uint64_t h = Mix(static_cast<std::uint64_t>(master_seed));
+    h = Mix(h ^ static_cast<std::uint32_t>(run_id));
+    return Mix(h ^ static_cast<std::uint32_t>(event_id));
+  }
+}
+
+//_____________________________________________________________________________
+void
+EventSeeder::Configure()
+{
+  if (Checkpoint::Resuming()) {
+    s_master_seed = Checkpoint::ResumeState().master_seed;
+    G4cout << "Random seed: " << s_master_seed << " (From checkpoint)" << G4endl;
+  } else if (gConfMan.Check("seed")) {
+    s_master_seed = gConfMan.GetInt("seed");
+    G4cout << "Random seed: " << s_master_seed << " (Fixed from config)" << G4endl;
+  } else {
+    std::random_device rd;
+    s_master_seed = rd();
+    G4cout << "Random seed: " << s_master_seed << " (Randomized)" << G4endl;
+  }
+  // Used only outside events (and by the MT master to draw its own seeds).
+  G4Random::setTheSeed(s_master_seed);
+
+  s_replay = gConfMan.Check("replay_event");
+  if (s_replay) {
+    // The replayed event keeps its ID (beam sampling is keyed by it).
+    gConfMan.Set("first_event", gConfMan.Get("replay_event"));
+    G4cout << "Replaying event " << gConfMan.Get("replay_event") << " of run "
+           << (gConfMan.Check("replay_run") ? gConfMan.GetInt("replay_run") : 0) << G4endl;
+  }
+
+  s_common = gConfMan.Check("common_random_numbers") && gConfMan.GetInt("common_random_numbers") == 1;
+  if (s_common)
+    G4cout << "Common random numbers: every run is seeded as run 0, tracks are reseeded" << G4endl;
+}
+
+//_____________________________________________________________________________
+void
+EventSeeder::BeginRun(G4int run_id)
+{
+  s_run_id = run_id;
+  if (Checkpoint::Resuming()) s_run_id = Checkpoint::ResumeState().run_id;
+  if (s_replay && gConfMan.Check("replay_run")) s_run_id = gConfMan.GetInt("replay_run");
+  // Same event seeds in every run (written as run_id 0, so replay still works)
+  if (s_common) s_run_id = 0;
+}
+
+//_____________________________________________________________________________
+void
+EventSeeder::SeedEvent(G4int event_id)
+{
+  tEventKey = EventKey(s_master_seed, s_run_id, event_id);
+  long seeds[5];
+  FillSeeds(tEventKey, seeds);
+  seeds[4] = 0;
+  G4Random::setTheSeeds(seeds, -1);
+}
+
+//_____________________________________________________________________________
+void
+EventSeeder::SeedTrack(G4int track_id)
+{
+  // Track IDs follow the creation order, which does not depend on the
+  // optical parameters: the same track gets the same stream in every run.
+  long seeds[5];
+  FillSeeds(Mix(tEventKey ^ (static_cast<std::uint64_t>(track_id) << 32)), seeds);
+  seeds[4] = 0;
+  G4Random::setTheSeeds(seeds, -1);
+}
+
+//_____________________________________________________________________________
+void
+EventSeeder::DeriveSeeds(G4long master_seed, G4int run_id, G4int event_id, long seeds[4])
+{
+  FillSeeds(EventKey(master_seed, run_id, event_id), seeds);
+}
@@ -0,0 +1,3 @@
+#include "KVC_TrackInfo.hh"
+
+G4ThreadLocal G4Allocator<KVC_TrackInfo>* KVC_TrackInfoAllocator = nullptr;
@@ -4,7 +4,7 @@
 #include "G4UnitsTable.hh"
 #include "G4ios.hh"
 
-G4Allocator<MPPCHit> MPPCHitAllocator;
+G4ThreadLocal G4Allocator<MPPCHit>* MPPCHitAllocator = nullptr;
 
 MPPCHit::MPPCHit()
     : fPosition(G4ThreeVector()),
@@ -14,8 +14,10 @@ MPPCHit::MPPCHit()
       fWaveLength(0.),
       fParticleID(0),
       fCopyNumber(0),
+      fSegment(0),
       fEventID(0),
-      fDetectFlag(0)
+      fDetectFlag(0),
+      fWeight(1.)
 {
 }
 
@@ -29,8 +31,10 @@ MPPCHit::MPPCHit(const MPPCHit& right) : G4VHit() {
     fWaveLength = right.fWaveLength;
     fParticleID = right.fParticleID;
     fCopyNumber = right.fCopyNumber;
+    fSegment = right.fSegment;
     fEventID = right.fEventID;
     fDetectFlag = right.fDetectFlag;
+    fWeight = right.fWeight;
 }
 
 void MPPCHit::Print() const {
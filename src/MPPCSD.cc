@@ -1,6 +1,7 @@
 #include "MPPCSD.hh"
-#include "ConfManager.hh"
-#include "KVC_OpticalProperties.hh"
+#include "SimParameters.hh"
+#include "KVC_TrackInfo.hh"
+#include "PhotonLUT.hh"
 
 #include "G4SDManager.hh"
 #include "G4Step.hh"
@@ -10,28 +11,15 @@
 #include "G4EventManager.hh"
 #include "Randomize.hh"
 
-#include "TGraph.h"
-#include "TSpline.h"
-
 //_____________________________________________________________________________
 MPPCSD::MPPCSD(const G4String& name)
-  : G4VSensitiveDetector(name),
-    m_qe_spline(nullptr),
-    m_range_min(1. * CLHEP::eV),
-    m_range_max(7. * CLHEP::eV),
-    m_qe_scale(1.0)
+  : G4VSensitiveDetector(name)
 {
     collectionName.insert("MppcCollection");
-
-    InitializeQESpline();
-
-    m_qe_scale = ConfManager::GetInstance().GetDouble("qe_scale");
-    if (m_qe_scale <= 0.0) m_qe_scale = 1.0;
 }
 
 //_____________________________________________________________________________
 MPPCSD::~MPPCSD() {
-  delete m_qe_spline;
 }
 
 //_____________________________________________________________________________
@@ -40,6 +28,12 @@ void MPPCSD::Initialize(G4HCofThisEvent* HCTE)
   m_hits_collection = new G4THitsCollection<MPPCHit>(SensitiveDetectorName,
 						     collectionName[0]);
   HCTE->AddHitsCollection(GetCollectionID(0), m_hits_collection);
+
+  // Re-read per event so that in-process parameter sweeps take effect.
+  const SimParameters& params = SimParameters::Get();
+  if (m_pde.size() != (std::size_t)params.NSegments()) m_pde.resize(params.NSegments());
+  for (std::size_t i = 0; i < m_pde.size(); ++i)
+    m_pde[i].SetScale(params.n_segments > 0 ? params.segment_qe_scale[i] : params.qe_scale);
 }
 
 //_____________________________________________________________________________
@@ -57,6 +51,9 @@ G4bool MPPCSD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist)
   G4double energy = aTrack->GetTotalEnergy();
   G4double waveLength = (CLHEP::h_Planck * CLHEP::c_light / energy) / CLHEP::nm;
   G4int copyNumber = postStepPoint->GetTouchableHandle()->GetCopyNumber();
+  G4int segment = postStepPoint->GetTouchableHandle()->GetCopyNumber(1); // KvcMotherPV
+  if (segment < 0 || segment >= (G4int)m_pde.size()) segment = 0;
+  const PDETable& pde = m_pde[segment];
   G4int eventID = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
   G4int detectFlag = 0;
 
@@ -71,12 +68,7 @@ G4bool MPPCSD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist)
   detectFlag = 1;
 #else
   // -- QE check (Method B) -----
-  G4double eval_energy = energy;
-  if      (eval_energy < m_range_min) eval_energy = m_range_min;
-  else if (eval_energy > m_range_max) eval_energy = m_range_max;
-
-  G4double qe_value = m_qe_spline->Eval(eval_energy) * m_qe_scale;
-  if (qe_value > 1.0) qe_value = 1.0;
+  G4double qe_value = pde.Value(energy);
 
   G4double random_value = G4UniformRand();
   if (random_value <= qe_value) {
@@ -84,6 +76,16 @@ G4bool MPPCSD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist)
   }
 #endif
 
+  // Photon history: the MPPC reached and the PDE before qe_scale
+  if (SimParameters::Get().photon_history != 0) {
+    auto info = static_cast<KVC_TrackInfo*>(aTrack->GetUserInformation());
+#ifdef USE_SURFACE_PDE
+    if (info) info->SetArrival(copyNumber, -1., true);
+#else
+    if (info) info->SetArrival(copyNumber, pde.RawValue(energy), detectFlag == 1);
+#endif
+  }
+
   // -- record -----
   if (detectFlag == 1) {
     MPPCHit* aHit = new MPPCHit();
@@ -94,10 +96,23 @@ G4bool MPPCSD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist)
     aHit->SetTime(hitTime);
     aHit->SetParticleID(particleID);
     aHit->SetCopyNumber(copyNumber);
+    aHit->SetSegment(segment);
     aHit->SetEventID(eventID);
     aHit->SetDetectFlag(detectFlag);
+    aHit->SetWeight(aTrack->GetWeight());
 
     m_hits_collection->insert(aHit);
+
+    // Training run for the lookup-table fast simulation: detection of a
+    // quartz-born photon, keyed by its emission point.
+    if (PhotonLUT::TrainingMode()) {
+      auto info = static_cast<KVC_TrackInfo*>(aTrack->GetUserInformation());
+      if (info && info->IsFromQuartz())
+        PhotonLUT::GetThreadTable()->RecordDetected(aTrack->GetVertexPosition(),
+                                                    aTrack->GetVertexMomentumDirection(),
+                                                    aTrack->GetVertexKineticEnergy(),
+                                                    copyNumber, postStepPoint->GetLocalTime());
+    }
   }
 
   
@@ -108,15 +123,3 @@ G4bool MPPCSD::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist)
 void MPPCSD::EndOfEvent(G4HCofThisEvent*)
 {
 }
-
-//_____________________________________________________________________________
-void MPPCSD::InitializeQESpline()
-{
-  // Use PDE data from KVC_OpticalProperties.hh instead of hardcoding a redundant copy here.
-  auto graph = new TGraph(KVC_Optical::E_MPPC_PDE.size(), &KVC_Optical::E_MPPC_PDE[0], &KVC_Optical::R_MPPC_PDE[0]);
-  m_qe_spline = new TSpline3("qe_spline", graph);
-  m_range_min = m_qe_spline->GetXmin();
-  m_range_max = m_qe_spline->GetXmax();
-
-  delete graph;
-}
@@ -0,0 +1,180 @@
+#include "OutputNTuple.hh"
+#include "OutputSchema.hh"
+
+#include "G4Exception.hh"
+
+#include "RVersion.h"
+#include "TFile.h"
+
+#include <functional>
+#include <type_traits>
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,30,0)
+#define KVC_HAS_RNTUPLE
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,36,0)
+namespace RNT = ROOT;
+#else
+namespace RNT = ROOT::Experimental;
+#endif
+#endif
+
+// Each selected column owns a field of the default entry; 'copy' moves the
+// buffer content in before Fill() and 'restore' hands swapped vectors back.
+struct OutputNTuple::Columns
+{
+#ifdef KVC_HAS_RNTUPLE
+  std::unique_ptr<RNT::RNTupleWriter> writer;
+#endif
+  std::vector<std::function<void(EventRecord&)>> copy;
+  std::vector<std::function<void(EventRecord&)>> restore;
+};
+
+#ifdef KVC_HAS_RNTUPLE
+namespace
+{
+  using Binder = std::vector<std::function<void(EventRecord&)>>;
+
+  template <typename T>
+  void Scalar(RNT::RNTupleModel& model, const OutputSchema& schema, Binder& copy,
+              const char* name, T EventRecord::* member)
+  {
+    if (!schema.Selected(name)) return;
+    auto field = model.MakeField<T>(name);
+    copy.emplace_back([field, member](EventRecord& b) { *field = b.*member; });
+  }
+
+  template <typename C, typename T>
+  void CopyField(RNT::RNTupleModel& model, Binder& copy,
+                 const char* name, std::vector<T> EventRecord::* member)
+  {
+    auto field = model.MakeField<std::vector<C>>(name);
+    copy.emplace_back([field, member](EventRecord& b) {
+      field->assign((b.*member).begin(), (b.*member).end());
+    });
+  }
+
+  // Vectors are swapped in and out (no copy) unless stored as float or short.
+  template <typename T>
+  void Vector(RNT::RNTupleModel& model, const OutputSchema& schema,
+              Binder& copy, Binder& restore,
+              const char* name, std::vector<T> EventRecord::* member)
+  {
+    if (!schema.Selected(name)) return;
+    if (std::is_floating_point<T>::value && schema.Float()) {
+      CopyField<float>(model, copy, name, member);
+      return;
+    }
+    if (std::is_integral<T>::value && schema.ShortInt(name)) {
+      CopyField<short>(model, copy, name, member);
+      return;
+    }
+    auto field = model.MakeField<std::vector<T>>(name);
+    auto swap = [field, member](EventRecord& b) { field->swap(b.*member); };
+    copy.emplace_back(swap);
+    restore.emplace_back(swap);
+  }
+}
+#endif
+
+//_____________________________________________________________________________
+OutputNTuple::OutputNTuple()
+{
+}
+
+//_____________________________________________________________________________
+OutputNTuple::~OutputNTuple()
+{
+  Close();
+}
+
+//_____________________________________________________________________________
+void OutputNTuple::Open(TFile* file, const OutputSchema& schema)
+{
+#ifdef KVC_HAS_RNTUPLE
+  m_columns.reset(new Columns);
+  auto model = RNT::RNTupleModel::Create();
+  auto& c = m_columns->copy;
+  auto& r = m_columns->restore;
+
+  Scalar(*model, schema, c, "evnum", &EventRecord::evnum);
+  Scalar(*model, schema, c, "event_id", &EventRecord::event_id);
+  Scalar(*model, schema, c, "cerenkov_all", &EventRecord::cerenkov_all);
+  Scalar(*model, schema, c, "cerenkov_quartz", &EventRecord::cerenkov_quartz);
+
+  // beam info
+  Scalar(*model, schema, c, "beam_energy", &EventRecord::beam_energy);
+  Scalar(*model, schema, c, "beam_mom_x", &EventRecord::beam_mom_x);
+  Scalar(*model, schema, c, "beam_mom_y", &EventRecord::beam_mom_y);
+  Scalar(*model, schema, c, "beam_mom_z", &EventRecord::beam_mom_z);
+  Scalar(*model, schema, c, "beam_pos_x", &EventRecord::beam_pos_x);
+  Scalar(*model, schema, c, "beam_pos_y", &EventRecord::beam_pos_y);
+  Scalar(*model, schema, c, "beam_pos_z", &EventRecord::beam_pos_z);
+  Scalar(*model, schema, c, "n_cherenkov_gen", &EventRecord::n_cherenkov_gen);
+  Scalar(*model, schema, c, "npe", &EventRecord::npe);
+  Scalar(*model, schema, c, "npe_weighted", &EventRecord::npe_weighted);
+
+  // Trapping/Monitoring info
+  Scalar(*model, schema, c, "nTrapped_Air", &EventRecord::nTrapped_Air);
+  Scalar(*model, schema, c, "nKilled_Blacksheet", &EventRecord::nKilled_Blacksheet);
+  Scalar(*model, schema, c, "nKilled_Trapped", &EventRecord::nKilled_Trapped);
+  Scalar(*model, schema, c, "killed_prob", &EventRecord::killed_prob);
+
+  // MPPC info
+  Scalar(*model, schema, c, "nhit_mppc", &EventRecord::nhit_mppc);
+  Scalar(*model, schema, c, "segment", &EventRecord::segment);
+  Vector(*model, schema, c, r, "pos_x", &EventRecord::pos_x);
+  Vector(*model, schema, c, r, "pos_y", &EventRecord::pos_y);
+  Vector(*model, schema, c, r, "pos_z", &EventRecord::pos_z);
+  Vector(*model, schema, c, r, "time", &EventRecord::time);
+  Vector(*model, schema, c, r, "energy", &EventRecord::energy);
+  Vector(*model, schema, c, r, "wave_length", &EventRecord::wave_length);
+  Vector(*model, schema, c, r, "particle_id", &EventRecord::particle_id);
+  Vector(*model, schema, c, r, "seg", &EventRecord::seg);
+  Vector(*model, schema, c, r, "mppc_segment", &EventRecord::mppc_segment);
+  Vector(*model, schema, c, r, "detect_flag", &EventRecord::detect_flag);
+  Vector(*model, schema, c, r, "weight", &EventRecord::weight);
+  Vector(*model, schema, c, r, "gen_wave_length", &EventRecord::gen_wave_length);
+  Vector(*model, schema, c, r, "gen_wave_length_hist", &EventRecord::gen_wave_length_hist);
+
+  // Photon history
+  Vector(*model, schema, c, r, "ph_wave_length", &EventRecord::ph_wave_length);
+  Vector(*model, schema, c, r, "ph_path_quartz", &EventRecord::ph_path_quartz);
+  Vector(*model, schema, c, r, "ph_abs_depth", &EventRecord::ph_abs_depth);
+  Vector(*model, schema, c, r, "ph_pde", &EventRecord::ph_pde);
+  Vector(*model, schema, c, r, "ph_weight", &EventRecord::ph_weight);
+  Vector(*model, schema, c, r, "ph_n_quartz", &EventRecord::ph_n_quartz);
+  Vector(*model, schema, c, r, "ph_n_wrapper", &EventRecord::ph_n_wrapper);
+  Vector(*model, schema, c, r, "ph_fate", &EventRecord::ph_fate);
+  Vector(*model, schema, c, r, "ph_seg", &EventRecord::ph_seg);
+
+  RNT::RNTupleWriteOptions options;
+  if (schema.CompressionSettings() >= 0) options.SetCompression(schema.CompressionSettings());
+  m_columns->writer = RNT::RNTupleWriter::Append(std::move(model), "tree", *file, options);
+#else
+  (void)file;
+  (void)schema;
+  G4Exception("OutputNTuple::Open", "RNTupleUnavailable", FatalException,
+              "output_mode ntuple requires ROOT 6.30 or newer");
+#endif
+}
+
+//_____________________________________________________________________________
+void OutputNTuple::Fill(EventRecord& buffer)
+{
+#ifdef KVC_HAS_RNTUPLE
+  for (auto& copy : m_columns->copy) copy(buffer);
+  m_columns->writer->Fill();
+  for (auto& restore : m_columns->restore) restore(buffer);
+#else
+  (void)buffer;
+#endif
+}
+
+//_____________________________________________________________________________
+void OutputNTuple::Close()
+{
+  // Destroying the writer commits the clusters and the footer.
+  m_columns.reset();
+}
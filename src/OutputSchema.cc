@@ -0,0 +1,265 @@
+#include "OutputSchema.hh"
+#include "ConfManager.hh"
+#include "SimParameters.hh"
+
+#include "G4Exception.hh"
+#include "G4ios.hh"
+
+#include "Compression.h"
+#include "TBranch.h"
+#include "TFile.h"
+#include "TTree.h"
+
+#include <sstream>
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+
+  template <typename T, typename C>
+  void CopyTo(const std::vector<T>& from, std::vector<C>& to)
+  {
+    to.assign(from.begin(), from.end());
+  }
+}
+
+//_____________________________________________________________________________
+OutputSchema::OutputSchema()
+  : m_drop_redundant(false),
+    m_float(false),
+    m_compact(false),
+    m_algorithm(-1),
+    m_level(-1),
+    m_basket_size(0)
+{
+}
+
+//_____________________________________________________________________________
+void OutputSchema::Configure()
+{
+  m_branches.clear();
+  if (gConfMan.Check("output_branches") && gConfMan.Get("output_branches") != "all") {
+    std::istringstream iss(gConfMan.Get("output_branches"));
+    std::string name;
+    while (std::getline(iss, name, ',')) {
+      if (!name.empty()) m_branches.insert(name);
+    }
+  }
+
+  m_drop_redundant = gConfMan.Check("output_drop_redundant") &&
+                     gConfMan.GetInt("output_drop_redundant") != 0;
+
+  G4String precision = gConfMan.Check("output_precision") ? G4String(gConfMan.Get("output_precision")) : G4String("double");
+  if (precision != "double" && precision != "float" && precision != "compact") {
+    G4Exception("OutputSchema::Configure", "InvalidPrecision", FatalException,
+                "output_precision must be double, float or compact");
+  }
+  m_compact = (precision == "compact");
+  m_float = (precision == "float" || m_compact);
+
+  m_algorithm = -1;
+  if (gConfMan.Check("output_compression")) {
+    G4String algorithm = gConfMan.Get("output_compression");
+    if      (algorithm == "zlib") m_algorithm = ROOT::RCompressionSetting::EAlgorithm::kZLIB;
+    else if (algorithm == "lzma") m_algorithm = ROOT::RCompressionSetting::EAlgorithm::kLZMA;
+    else if (algorithm == "lz4")  m_algorithm = ROOT::RCompressionSetting::EAlgorithm::kLZ4;
+    else if (algorithm == "zstd") m_algorithm = ROOT::RCompressionSetting::EAlgorithm::kZSTD;
+    else {
+      G4Exception("OutputSchema::Configure", "InvalidCompression", FatalException,
+                  "output_compression must be zlib, lzma, lz4 or zstd");
+    }
+  }
+  m_level = gConfMan.Check("output_compression_level") ? gConfMan.GetInt("output_compression_level") : -1;
+  m_basket_size = gConfMan.Check("output_basket_size") ? gConfMan.GetInt("output_basket_size") : 0;
+}
+
+//_____________________________________________________________________________
+void OutputSchema::ApplyCompression(TFile* file) const
+{
+  if (m_algorithm >= 0) file->SetCompressionAlgorithm(m_algorithm);
+  if (m_level >= 0)     file->SetCompressionLevel(m_level);
+}
+
+//_____________________________________________________________________________
+G4int OutputSchema::CompressionSettings() const
+{
+  if (m_algorithm < 0 && m_level < 0) return -1;
+  G4int algorithm = m_algorithm >= 0 ? m_algorithm : ROOT::RCompressionSetting::EAlgorithm::kZLIB;
+  G4int level = m_level;
+  if (level < 0) {
+    switch (algorithm) {
+      case ROOT::RCompressionSetting::EAlgorithm::kLZMA: level = ROOT::RCompressionSetting::ELevel::kDefaultLZMA; break;
+      case ROOT::RCompressionSetting::EAlgorithm::kLZ4:  level = ROOT::RCompressionSetting::ELevel::kDefaultLZ4;  break;
+      case ROOT::RCompressionSetting::EAlgorithm::kZSTD: level = ROOT::RCompressionSetting::ELevel::kDefaultZSTD; break;
+      default:                                           level = ROOT::RCompressionSetting::ELevel::kDefaultZLIB; break;
+    }
+  }
+  return ROOT::CompressionSettings(ROOT::RCompressionSetting::EAlgorithm::EValues(algorithm), level);
+}
+
+//_____________________________________________________________________________
+G4bool OutputSchema::Selected(const std::string& name) const
+{
+  if (m_drop_redundant &&
+      (name == "particle_id" || name == "detect_flag" || name == "energy"))
+    return false;
+  // Generated wavelengths: only the form gen_wavelength_mode records
+  const G4int gen_mode = SimParameters::Get().gen_wavelength_mode;
+  if ((name == "gen_wave_length" && gen_mode != SimParameters::kGenWavelengthVector) ||
+      (name == "gen_wave_length_hist" && gen_mode != SimParameters::kGenWavelengthHist))
+    return false;
+  // Segment numbers: only with several segments
+  if ((name == "segment" || name == "mppc_segment") && SimParameters::Get().n_segments == 0)
+    return false;
+  // Photon history: only when recorded
+  if (name.compare(0, 3, "ph_") == 0 && SimParameters::Get().photon_history == 0)
+    return false;
+  return m_branches.empty() || m_branches.count(name) > 0;
+}
+
+//_____________________________________________________________________________
+// Copy numbers, segments, the PDG code of the optical photon and the detect
+// flag all fit in a short.
+G4bool OutputSchema::ShortInt(const std::string& name) const
+{
+  return m_compact && (name == "particle_id" || name == "seg" ||
+                       name == "mppc_segment" || name == "detect_flag");
+}
+
+//_____________________________________________________________________________
+template <typename T>
+void OutputSchema::Vector(TTree* tree, const char* name, std::vector<T>& v, G4bool attach)
+{
+  if (!Selected(name)) return;
+  if (attach) tree->SetBranchAddress(name, &v);
+  else        tree->Branch(name, &v);
+}
+
+//_____________________________________________________________________________
+void OutputSchema::Vector(TTree* tree, const char* name, std::vector<G4double>& v,
+                          std::vector<float>& compact, G4bool attach)
+{
+  if (!Selected(name)) return;
+  if (m_float) Vector(tree, name, compact, attach);
+  else         Vector(tree, name, v, attach);
+}
+
+//_____________________________________________________________________________
+void OutputSchema::Vector(TTree* tree, const char* name, std::vector<G4int>& v,
+                          std::vector<short>& compact, G4bool attach)
+{
+  if (!Selected(name)) return;
+  if (ShortInt(name)) Vector(tree, name, compact, attach);
+  else                Vector(tree, name, v, attach);
+}
+
+//_____________________________________________________________________________
+void OutputSchema::Book(TTree* tree, EventRecord& buffer)
+{
+  Bind(tree, buffer, false);
+  if (m_basket_size > 0) tree->SetBasketSize("*", m_basket_size);
+}
+
+//_____________________________________________________________________________
+void OutputSchema::Attach(TTree* tree, EventRecord& buffer)
+{
+  Bind(tree, buffer, true);
+}
+
+//_____________________________________________________________________________
+void OutputSchema::Bind(TTree* tree, EventRecord& b, G4bool attach)
+{
+  auto scalar = [&](const char* name, void* address, const char* leaf) {
+    if (!Selected(name)) return;
+    if (attach) tree->SetBranchAddress(name, address);
+    else        tree->Branch(name, address, leaf);
+  };
+
+  scalar("evnum", &b.evnum, "evnum/I");
+  scalar("event_id", &b.event_id, "event_id/I");
+  scalar("cerenkov_all", &b.cerenkov_all, "cerenkov_all/I");
+  scalar("cerenkov_quartz", &b.cerenkov_quartz, "cerenkov_quartz/I");
+
+  // beam info
+  scalar("beam_energy", &b.beam_energy, "beam_energy/D");
+  scalar("beam_mom_x", &b.beam_mom_x, "beam_mom_x/D");
+  scalar("beam_mom_y", &b.beam_mom_y, "beam_mom_y/D");
+  scalar("beam_mom_z", &b.beam_mom_z, "beam_mom_z/D");
+  scalar("beam_pos_x", &b.beam_pos_x, "beam_pos_x/D");
+  scalar("beam_pos_y", &b.beam_pos_y, "beam_pos_y/D");
+  scalar("beam_pos_z", &b.beam_pos_z, "beam_pos_z/D");
+  scalar("n_cherenkov_gen", &b.n_cherenkov_gen, "n_cherenkov_gen/I"); // Number of generated Cherenkov photons
+  scalar("npe", &b.npe, "npe/I");                                    // Number of detected photoelectrons
+  scalar("npe_weighted", &b.npe_weighted, "npe_weighted/D");         // Sum of hit weights
+
+  // Trapping/Monitoring info
+  scalar("nTrapped_Air", &b.nTrapped_Air, "nTrapped_Air/I");
+  scalar("nKilled_Blacksheet", &b.nKilled_Blacksheet, "nKilled_Blacksheet/I");
+  scalar("nKilled_Trapped", &b.nKilled_Trapped, "nKilled_Trapped/I");
+  scalar("killed_prob", &b.killed_prob, "killed_prob/D");
+
+  // MPPC info
+  scalar("nhit_mppc", &b.nhit_mppc, "nhit_mppc/I");
+  scalar("segment", &b.segment, "segment/I");
+  Vector(tree, "pos_x", b.pos_x, m_pos_x, attach);
+  Vector(tree, "pos_y", b.pos_y, m_pos_y, attach);
+  Vector(tree, "pos_z", b.pos_z, m_pos_z, attach);
+  Vector(tree, "time", b.time, m_time, attach);
+  Vector(tree, "energy", b.energy, m_energy, attach);
+  Vector(tree, "wave_length", b.wave_length, m_wave_length, attach);
+  Vector(tree, "particle_id", b.particle_id, m_particle_id, attach);
+  Vector(tree, "seg", b.seg, m_seg, attach);
+  Vector(tree, "mppc_segment", b.mppc_segment, m_mppc_segment, attach);
+  Vector(tree, "detect_flag", b.detect_flag, m_detect_flag, attach);
+  Vector(tree, "weight", b.weight, m_weight, attach);
+  Vector(tree, "gen_wave_length", b.gen_wave_length, m_gen_wave_length, attach);
+  Vector(tree, "gen_wave_length_hist", b.gen_wave_length_hist, attach);
+
+  // Photon history
+  Vector(tree, "ph_wave_length", b.ph_wave_length, attach);
+  Vector(tree, "ph_path_quartz", b.ph_path_quartz, attach);
+  Vector(tree, "ph_abs_depth", b.ph_abs_depth, attach);
+  Vector(tree, "ph_pde", b.ph_pde, attach);
+  Vector(tree, "ph_weight", b.ph_weight, attach);
+  Vector(tree, "ph_n_quartz", b.ph_n_quartz, attach);
+  Vector(tree, "ph_n_wrapper", b.ph_n_wrapper, attach);
+  Vector(tree, "ph_fate", b.ph_fate, attach);
+  Vector(tree, "ph_seg", b.ph_seg, attach);
+}
+
+//_____________________________________________________________________________
+void OutputSchema::Convert(const EventRecord& b)
+{
+  if (!m_float) return;
+  CopyTo(b.pos_x, m_pos_x);
+  CopyTo(b.pos_y, m_pos_y);
+  CopyTo(b.pos_z, m_pos_z);
+  CopyTo(b.time, m_time);
+  CopyTo(b.energy, m_energy);
+  CopyTo(b.wave_length, m_wave_length);
+  CopyTo(b.weight, m_weight);
+  CopyTo(b.gen_wave_length, m_gen_wave_length);
+  if (!m_compact) return;
+  CopyTo(b.particle_id, m_particle_id);
+  CopyTo(b.seg, m_seg);
+  CopyTo(b.mppc_segment, m_mppc_segment);
+  CopyTo(b.detect_flag, m_detect_flag);
+}
+
+//_____________________________________________________________________________
+void OutputSchema::Report(TTree* tree) const
+{
+  Long64_t entries = tree->GetEntries();
+  if (entries <= 0) return;
+
+  G4cout << "------------------------------------------------------------" << G4endl;
+  G4cout << " Output size per event (" << entries << " events)" << G4endl;
+  G4cout << "  total: " << G4double(tree->GetZipBytes()) / entries << " bytes ("
+         << G4double(tree->GetTotBytes()) / entries << " uncompressed)" << G4endl;
+  TIter next(tree->GetListOfBranches());
+  while (auto branch = static_cast<TBranch*>(next())) {
+    G4cout << "  " << branch->GetName() << ": "
+           << G4double(branch->GetZipBytes("*")) / entries << " bytes" << G4endl;
+  }
+  G4cout << "------------------------------------------------------------" << G4endl;
+}
@@ -0,0 +1,447 @@
+#include "OutputWriter.hh"
+#include "Checkpoint.hh"
+#include "CherenkovTable.hh"
+#include "ConfManager.hh"
+#include "EventSeeder.hh"
+#include "SimParameters.hh"
+
+#include "G4Exception.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include "TFile.h"
+#include "TH1D.h"
+#include "TKey.h"
+#include "TParameter.h"
+#include "TTree.h"
+#include "TVectorD.h"
+
+#include <chrono>
+
+namespace
+{
+  constexpr std::size_t kQueueCapacity = 4096;
+}
+
+//_____________________________________________________________________________
+OutputWriter& OutputWriter::GetInstance()
+{
+  static OutputWriter instance;
+  return instance;
+}
+
+//_____________________________________________________________________________
+OutputWriter::OutputWriter()
+  : m_queue(kQueueCapacity),
+    m_free(kQueueCapacity),
+    m_stop(false),
+    m_running(false),
+    m_mode(Mode::kTree),
+    m_first_event(0),
+    m_end_event(0),
+    m_file(nullptr),
+    m_tree(nullptr),
+    m_h_npe(nullptr),
+    m_h_npe_weighted(nullptr),
+    m_h_mppc(nullptr),
+    m_h_time(nullptr),
+    m_h_trapped(nullptr),
+    m_h_cherenkov_gen(nullptr),
+    m_h_gen_wave_length(nullptr),
+    m_next_event_id(0),
+    m_evnum(0)
+{
+}
+
+//_____________________________________________________________________________
+OutputWriter::~OutputWriter()
+{
+  Close();
+  EventRecord* record = nullptr;
+  while (m_free.Pop(record)) delete record;
+}
+
+//_____________________________________________________________________________
+void OutputWriter::Open(const G4String& path, G4int n_events)
+{
+  if (m_running) Close();
+  m_stop = false;
+  m_running = true;
+  m_path = path;
+  m_next_event_id = SimParameters::Get().first_event;
+  m_first_event = m_next_event_id;
+  m_end_event = m_next_event_id + n_events;
+  m_summary = RunSummary();
+  m_event_npe.clear();
+  auto& confMan = ConfManager::GetInstance();
+  G4String mode = confMan.Check("output_mode") ? G4String(confMan.Get("output_mode")) : G4String("tree");
+  if      (mode == "tree")   m_mode = Mode::kTree;
+  else if (mode == "ntuple") m_mode = Mode::kNTuple;
+  else if (mode == "hist")   m_mode = Mode::kHist;
+  else {
+    G4Exception("OutputWriter::Open", "InvalidOutputMode", FatalException,
+                "output_mode must be tree, ntuple or hist");
+  }
+  m_schema.Configure();
+  if (Checkpoint::Resuming()) {
+    if (m_mode == Mode::kNTuple) {
+      G4Exception("OutputWriter::Open", "ResumeNTuple", FatalException,
+                  "resume is not supported with output_mode ntuple");
+    }
+    const auto& state = Checkpoint::ResumeState();
+    m_first_event = state.first_event;
+    m_evnum = state.entries;
+    m_summary.n_events = state.summary_events;
+    m_summary.npe_sum  = state.npe_sum;
+    m_summary.npe_sum2 = state.npe_sum2;
+  }
+  m_thread = std::thread(&OutputWriter::WriterLoop, this, path);
+}
+
+//_____________________________________________________________________________
+void OutputWriter::Close()
+{
+  if (!m_running) return;
+  m_stop.store(true, std::memory_order_release);
+  if (m_thread.joinable()) m_thread.join();
+  m_running = false;
+}
+
+//_____________________________________________________________________________
+void OutputWriter::Push(EventRecord& event)
+{
+  EventRecord* record = AcquireRecord();
+  record->TakeFrom(event);
+  event.ClearHits();
+  // Back-pressure only when the writer is 4096 events behind.
+  while (!m_queue.Push(record)) std::this_thread::yield();
+}
+
+//_____________________________________________________________________________
+void OutputWriter::WriterLoop(G4String path)
+{
+  // File, tree and histograms are created on the writer thread and never
+  // touched by any other thread.
+  const G4bool resume = Checkpoint::Resuming();
+  m_file = new TFile(path, resume ? "UPDATE" : "RECREATE");
+  if (m_file->IsZombie()) {
+    G4Exception("OutputWriter::WriterLoop", "FileNotOpened", FatalException,
+                ("cannot open output file " + path).c_str());
+  }
+  if (!resume) m_schema.ApplyCompression(m_file);
+  switch (m_mode) {
+    case Mode::kTree:   BookTree(); break;
+    case Mode::kNTuple: m_ntuple.Open(m_file, m_schema); break;
+    case Mode::kHist:   BookHistograms(); break;
+  }
+  if (resume && m_mode == Mode::kHist) RestoreHistograms();
+
+  EventRecord* record = nullptr;
+  for (;;) {
+    if (m_queue.Pop(record)) {
+      m_pending.emplace(record->event_id, record);
+      DrainPending(false);
+      continue;
+    }
+    if (m_stop.load(std::memory_order_acquire)) {
+      // Workers are done: empty the queue, then write whatever is left
+      // (gaps appear only for aborted events).
+      while (m_queue.Pop(record)) m_pending.emplace(record->event_id, record);
+      DrainPending(true);
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+
+  m_file->cd();
+  switch (m_mode) {
+    case Mode::kTree:
+      m_tree->Write("", TObject::kOverwrite); // replaces the last auto-save
+      m_schema.Report(m_tree);
+      break;
+    case Mode::kNTuple:
+      m_ntuple.Close();
+      break;
+    case Mode::kHist:
+      WriteHistograms();
+      break;
+  }
+  WriteRunInfo();
+  m_file->Close(); // deletes the tree and histograms
+  delete m_file;
+  m_file = nullptr;
+  m_tree = nullptr;
+  m_h_npe = m_h_npe_weighted = m_h_mppc = m_h_time = nullptr;
+  m_h_trapped = m_h_cherenkov_gen = m_h_gen_wave_length = nullptr;
+  m_h_npe_segment.clear();
+  m_h_mppc_segment.clear();
+}
+
+//_____________________________________________________________________________
+void OutputWriter::BookTree()
+{
+  if (Checkpoint::Resuming()) {
+    // The tree as of the last checkpoint. A job killed between the
+    // auto-save and the checkpoint file leaves events past the checkpoint:
+    // keep only the first `entries` and save that tree before continuing.
+    m_tree = m_file->Get<TTree>("tree");
+    const G4int entries = Checkpoint::ResumeState().entries;
+    if (m_tree && m_tree->GetEntries() > entries) {
+      G4cout << "OutputWriter: dropping " << m_tree->GetEntries() - entries
+             << " tree entries written after the last checkpoint" << G4endl;
+      TTree* kept = m_tree->CloneTree(entries);
+      delete m_tree;
+      m_file->Delete("tree;*");
+      m_tree = kept;
+      m_tree->SetDirectory(m_file);
+      m_file->cd();
+      m_tree->AutoSave("SaveSelf");
+    }
+    if (!m_tree || m_tree->GetEntries() != entries) {
+      G4Exception("OutputWriter::BookTree", "ResumeMismatch", FatalException,
+                  ("output tree does not match the checkpoint (" + std::to_string(entries) +
+                   " events expected)").c_str());
+    }
+    m_schema.Attach(m_tree, m_buffer);
+    m_tree->SetAutoSave(0);
+    return;
+  }
+
+  m_tree = new TTree("tree", "GEANT4 optical simulation for KVC");
+
+  m_schema.Book(m_tree, m_buffer);
+  // Auto-save only at checkpoints, so that the saved tree always matches one.
+  if (Checkpoint::Interval() > 0) m_tree->SetAutoSave(0);
+}
+
+//_____________________________________________________________________________
+void OutputWriter::BookHistograms()
+{
+  auto& confMan = ConfManager::GetInstance();
+  G4int npe_max = 200;
+  if (confMan.Check("hist_npe_max")) npe_max = confMan.GetInt("hist_npe_max");
+
+  m_h_npe             = new TH1D("h_npe", "npe;npe;events", npe_max, 0., npe_max);
+  m_h_npe_weighted    = new TH1D("h_npe_weighted", "weighted npe;npe;events", npe_max, 0., npe_max);
+  m_h_mppc            = new TH1D("h_mppc", "detected photons per MPPC;copy number;photons", 64, 0., 64.);
+  m_h_time            = new TH1D("h_time", "arrival time;time [ns];photons", 400, 0., 20.);
+  m_h_trapped         = new TH1D("h_trapped", "trapped photons;nTrapped_Air;events", 200, 0., 2000.);
+  m_h_cherenkov_gen   = new TH1D("h_cherenkov_gen", "generated Cherenkov photons;n_cherenkov_gen;events", 200, 0., 2000.);
+  m_h_gen_wave_length = new TH1D("h_gen_wave_length", "generated wavelength;wavelength [nm];photons",
+                                 CherenkovTable::kWavelengthBins, CherenkovTable::kWavelengthMin,
+                                 CherenkovTable::kWavelengthMax);
+
+  m_h_npe_segment.clear();
+  m_h_mppc_segment.clear();
+  for (G4int i = 0; i < SimParameters::Get().n_segments; ++i) {
+    const std::string name = "h_npe_seg" + std::to_string(i);
+    const std::string title = "weighted npe, segment " + std::to_string(i) + ";npe;events";
+    m_h_npe_segment.push_back(new TH1D(name.c_str(), title.c_str(), npe_max, 0., npe_max));
+    const std::string mppc_name = "h_mppc_seg" + std::to_string(i);
+    const std::string mppc_title = "detected photons per MPPC, segment " + std::to_string(i)
+                                 + ";copy number;photons";
+    m_h_mppc_segment.push_back(new TH1D(mppc_name.c_str(), mppc_title.c_str(), 64, 0., 64.));
+  }
+}
+
+//_____________________________________________________________________________
+std::vector<TH1D*> OutputWriter::Histograms() const
+{
+  std::vector<TH1D*> histograms = { m_h_npe, m_h_npe_weighted, m_h_mppc, m_h_time,
+                                    m_h_trapped, m_h_cherenkov_gen, m_h_gen_wave_length };
+  histograms.insert(histograms.end(), m_h_npe_segment.begin(), m_h_npe_segment.end());
+  histograms.insert(histograms.end(), m_h_mppc_segment.begin(), m_h_mppc_segment.end());
+  return histograms;
+}
+
+//_____________________________________________________________________________
+void OutputWriter::FillHistograms(const EventRecord& event)
+{
+  m_h_npe->Fill(event.npe);
+  m_h_npe_weighted->Fill(event.npe_weighted);
+  m_h_trapped->Fill(event.nTrapped_Air);
+  m_h_cherenkov_gen->Fill(event.n_cherenkov_gen);
+  if (event.segment >= 0 && event.segment < (G4int)m_h_npe_segment.size())
+    m_h_npe_segment[event.segment]->Fill(event.npe_weighted);
+  for (std::size_t i = 0; i < event.seg.size(); ++i) {
+    if (event.detect_flag[i] != 1) continue;
+    m_h_mppc->Fill(event.seg[i], event.weight[i]);
+    // Copy numbers repeat in every segment
+    const G4int segment = i < event.mppc_segment.size() ? event.mppc_segment[i] : -1;
+    if (segment >= 0 && segment < (G4int)m_h_mppc_segment.size())
+      m_h_mppc_segment[segment]->Fill(event.seg[i], event.weight[i]);
+    m_h_time->Fill(event.time[i], event.weight[i]);
+  }
+  for (auto wl : event.gen_wave_length) m_h_gen_wave_length->Fill(wl);
+  // gen_wavelength_mode hist: already binned like h_gen_wave_length
+  if (!event.gen_wave_length_hist.empty()) {
+    G4long n = 0;
+    for (std::size_t bin = 0; bin < event.gen_wave_length_hist.size(); ++bin) {
+      if (event.gen_wave_length_hist[bin] == 0) continue;
+      m_h_gen_wave_length->AddBinContent(bin, event.gen_wave_length_hist[bin]);
+      n += event.gen_wave_length_hist[bin];
+    }
+    m_h_gen_wave_length->SetEntries(m_h_gen_wave_length->GetEntries() + n);
+  }
+}
+
+//_____________________________________________________________________________
+void OutputWriter::WriteHistograms()
+{
+  for (auto h : Histograms())
+    h->Write("", TObject::kOverwrite);
+
+  // Expected Cherenkov spectrum (beta = 1) with the same number of photons
+  TH1D expected("h_gen_wave_length_expected",
+                "expected generated wavelength (beta = 1);wavelength [nm];photons",
+                CherenkovTable::kWavelengthBins, CherenkovTable::kWavelengthMin,
+                CherenkovTable::kWavelengthMax);
+  expected.SetDirectory(nullptr);
+  const auto& spectrum = CherenkovTable::Get().Spectrum();
+  const G4double n_gen = m_h_gen_wave_length->GetEntries();
+  for (std::size_t bin = 0; bin < spectrum.size(); ++bin)
+    expected.SetBinContent(bin, spectrum[bin] * n_gen);
+  expected.Write("", TObject::kOverwrite);
+
+  // Run moments of the (weighted) npe
+  TVectorD stats(3);
+  stats[0] = m_summary.n_events;
+  stats[1] = m_summary.Mean();
+  stats[2] = m_summary.RMS();
+  stats.Write("npe_stats", TObject::kOverwrite);
+}
+
+//_____________________________________________________________________________
+void OutputWriter::RestoreHistograms()
+{
+  // Add the histograms saved at the checkpoint to the freshly booked ones.
+  for (auto h : Histograms()) {
+    TKey* key = m_file->GetKey(h->GetName());
+    auto saved = key ? key->ReadObject<TH1D>() : nullptr;
+    if (!saved) {
+      G4Exception("OutputWriter::RestoreHistograms", "ResumeMismatch", FatalException,
+                  (G4String("histogram ") + h->GetName() + " missing from the output").c_str());
+      continue;
+    }
+    saved->SetDirectory(nullptr);
+    h->Add(saved);
+    delete saved;
+  }
+}
+
+//_____________________________________________________________________________
+void OutputWriter::WriteCheckpoint(const EventRecord& record)
+{
+  // Every event before record.event_id is in the output at this point.
+  m_file->cd();
+  switch (m_mode) {
+    case Mode::kTree:   m_tree->AutoSave("SaveSelf"); break;
+    case Mode::kNTuple: return; // no intermediate commit of an RNTuple
+    case Mode::kHist:   WriteHistograms(); m_file->SaveSelf(); break;
+  }
+
+  CheckpointState state;
+  state.first_event = m_first_event;
+  state.n_events = m_end_event;
+  state.next_event = record.event_id;
+  state.entries = m_evnum;
+  state.summary_events = m_summary.n_events;
+  state.npe_sum = m_summary.npe_sum;
+  state.npe_sum2 = m_summary.npe_sum2;
+  state.master_seed = EventSeeder::MasterSeed();
+  state.run_id = EventSeeder::RunID();
+  Checkpoint::Write(m_path, state);
+}
+
+//_____________________________________________________________________________
+void OutputWriter::WriteRunInfo()
+{
+  // Seeding inputs: with the event IDs they reproduce every event.
+  TParameter<Long64_t>("master_seed", EventSeeder::MasterSeed()).Write("", TObject::kOverwrite);
+  TParameter<Int_t>("run_id", EventSeeder::RunID()).Write("", TObject::kOverwrite);
+  // Event range of the run, checked by KVCMerge
+  TParameter<Int_t>("first_event", m_first_event).Write("", TObject::kOverwrite);
+  TParameter<Int_t>("n_events", m_end_event - m_first_event).Write("", TObject::kOverwrite);
+  auto& confMan = ConfManager::GetInstance();
+  if (confMan.Check("n_jobs")) {
+    TParameter<Int_t>("job_index", confMan.GetInt("job_index")).Write("", TObject::kOverwrite);
+    TParameter<Int_t>("n_jobs", confMan.GetInt("n_jobs")).Write("", TObject::kOverwrite);
+  }
+  const SimParameters& params = SimParameters::Get();
+  if (params.n_segments > 0) {
+    TParameter<Int_t>("n_segments", params.n_segments).Write("", TObject::kOverwrite);
+    TParameter<Double_t>("segment_pitch", params.segment_pitch / CLHEP::mm).Write("", TObject::kOverwrite);
+  }
+  // Photon history: the optics it was simulated with, read by KVCReweight
+  if (params.photon_history != 0) {
+    auto value = [&](const char* key, G4double fallback) {
+      return confMan.Check(key) ? confMan.GetDouble(key) : fallback;
+    };
+    G4double quartz_r = value("quartz_boundary_reflectivity", -1.);
+    if (quartz_r < 0.) quartz_r = 1.; // no REFLECTIVITY: Geant4 default
+    TParameter<Int_t>("photon_history", params.photon_history).Write("", TObject::kOverwrite);
+    TParameter<Double_t>("teflon_reflectivity_scale", value("teflon_reflectivity_scale", 1.)).Write("", TObject::kOverwrite);
+    TParameter<Double_t>("quartz_boundary_reflectivity", quartz_r).Write("", TObject::kOverwrite);
+    TParameter<Double_t>("quartz_abs_scale", value("quartz_abs_scale", 1.)).Write("", TObject::kOverwrite);
+    TParameter<Double_t>("qe_scale", params.qe_scale).Write("", TObject::kOverwrite);
+  }
+}
+
+//_____________________________________________________________________________
+void OutputWriter::DrainPending(G4bool flush_all)
+{
+  while (!m_pending.empty()) {
+    auto it = m_pending.begin();
+    if (!flush_all && it->first != m_next_event_id) break;
+    m_next_event_id = it->first + 1;
+    Write(it->second);
+    m_pending.erase(it);
+  }
+}
+
+//_____________________________________________________________________________
+void OutputWriter::Write(EventRecord* record)
+{
+  if (Checkpoint::IsDue(record->event_id) && record->event_id > SimParameters::Get().first_event)
+    WriteCheckpoint(*record);
+  m_buffer.TakeFrom(*record);
+  m_buffer.evnum = m_evnum;
+  switch (m_mode) {
+    case Mode::kTree:
+      m_schema.Convert(m_buffer);
+      m_tree->Fill();
+      break;
+    case Mode::kNTuple:
+      m_ntuple.Fill(m_buffer);
+      break;
+    case Mode::kHist:
+      FillHistograms(m_buffer);
+      break;
+  }
+  m_evnum++;
+  m_summary.n_events++;
+  m_summary.npe_sum  += m_buffer.npe_weighted;
+  m_summary.npe_sum2 += m_buffer.npe_weighted * m_buffer.npe_weighted;
+  if (EventSeeder::CommonRandomNumbers()) {
+    const std::size_t index = m_buffer.event_id - m_first_event;
+    if (index >= m_event_npe.size()) m_event_npe.resize(index + 1, 0.);
+    m_event_npe[index] = m_buffer.npe_weighted;
+  }
+  // The record now holds the previous buffer vectors; recycle it.
+  record->ClearHits();
+  ReleaseRecord(record);
+}
+
+//_____________________________________________________________________________
+EventRecord* OutputWriter::AcquireRecord()
+{
+  EventRecord* record = nullptr;
+  if (m_free.Pop(record)) return record;
+  return new EventRecord;
+}
+
+//_____________________________________________________________________________
+void OutputWriter::ReleaseRecord(EventRecord* record)
+{
+  if (!m_free.Push(record)) delete record;
+}
@@ -0,0 +1,33 @@
+#include "PDETable.hh"
+#include "KVC_OpticalProperties.hh"
+
+#include "TGraph.h"
+#include "TSpline.h"
+
+//_____________________________________________________________________________
+PDETable::PDETable()
+  : m_emin(KVC_Optical::E_MPPC_PDE.front()),
+    m_inv_step((kNBins - 1) / (KVC_Optical::E_MPPC_PDE.back() - KVC_Optical::E_MPPC_PDE.front())),
+    m_scale(-1.),
+    m_raw(kNBins + 1),
+    m_table(kNBins + 1)
+{
+  TGraph graph(KVC_Optical::E_MPPC_PDE.size(), &KVC_Optical::E_MPPC_PDE[0], &KVC_Optical::R_MPPC_PDE[0]);
+  TSpline3 spline("pde_spline", &graph);
+  for (G4int i = 0; i < kNBins; ++i)
+    m_raw[i] = spline.Eval(m_emin + i / m_inv_step);
+  // Pad so that Value() at the upper edge can read m_table[i + 1].
+  m_raw[kNBins] = m_raw[kNBins - 1];
+
+  SetScale(1.0);
+}
+
+//_____________________________________________________________________________
+void
+PDETable::SetScale(G4double scale)
+{
+  if (scale == m_scale) return;
+  m_scale = scale;
+  for (std::size_t i = 0; i < m_raw.size(); ++i)
+    m_table[i] = std::min(m_raw[i] * scale, 1.0);
+}
@@ -0,0 +1,201 @@
+#include "ParameterSweep.hh"
+#include "AnaManager.hh"
+#include "ConfManager.hh"
+#include "DetectorConstruction.hh"
+#include "EventSeeder.hh"
+#include "OutputWriter.hh"
+#include "PhotonLUT.hh"
+#include "SimParameters.hh"
+
+#include "G4Exception.hh"
+#include "G4RunManager.hh"
+#include "G4Timer.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+
+  // Keys read once per process (beam pool, fast simulation mode, threads,
+  // seeding, output and job setup): RunPoint cannot apply them.
+  const std::set<std::string> kFixedKeys = {
+    "generator", "particle", "input_beam_file", "beam_sampling", "beam_shuffle_seed",
+    "seed", "replay_event", "replay_run", "common_random_numbers", "threads",
+    "first_event", "n_events", "job_index", "n_jobs", "segment_beam",
+    "fastsim_mode", "fastsim_table", "fastsim_min_stat", "fastsim_batch",
+    "output_mode", "hist_npe_max", "gen_wavelength_mode", "photon_history",
+    "output_branches", "output_drop_redundant", "output_precision",
+    "output_compression", "output_compression_level", "output_basket_size",
+    "checkpoint_events", "resume", "sweep_file", "sweep_events",
+  };
+
+  // Mean and standard error of the event-by-event npe difference of two runs
+  // with the same event seeds (common_random_numbers).
+  void PairedDifference(const std::vector<G4double>& npe, const std::vector<G4double>& reference,
+                        G4double& mean, G4double& error)
+  {
+    const std::size_t n = std::min(npe.size(), reference.size());
+    G4double sum = 0., sum2 = 0.;
+    for (std::size_t i = 0; i < n; ++i) {
+      const G4double d = npe[i] - reference[i];
+      sum += d;
+      sum2 += d * d;
+    }
+    mean = n > 0 ? sum / n : 0.;
+    const G4double var = n > 1 ? (sum2 - n * mean * mean) / (n - 1) : 0.;
+    error = var > 0. ? std::sqrt(var / n) : 0.;
+  }
+}
+
+//_____________________________________________________________________________
+ParameterSweep::ParameterSweep(G4RunManager* runManager, DetectorConstruction* detector)
+  : m_run_manager(runManager), m_detector(detector)
+{
+}
+
+//_____________________________________________________________________________
+ParameterSweep::~ParameterSweep()
+{
+}
+
+//_____________________________________________________________________________
+G4bool ParameterSweep::LoadPoints(const G4String& filename)
+{
+  std::ifstream file(filename);
+  if (!file) {
+    G4cerr << "Error: Cannot open sweep file " << filename << G4endl;
+    return false;
+  }
+
+  m_keys.clear();
+  m_points.clear();
+  std::vector<std::vector<std::string>> grid_values;
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream iss(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (iss >> token) tokens.push_back(token);
+    if (tokens.empty() || tokens[0][0] == '#') continue;
+
+    if (tokens[0] == "grid") {
+      if (tokens.size() < 3) continue;
+      m_keys.push_back(tokens[1]);
+      grid_values.emplace_back(tokens.begin() + 2, tokens.end());
+    } else if (m_keys.empty()) {
+      m_keys = tokens;
+    } else if (tokens.size() == m_keys.size()) {
+      m_points.push_back(tokens);
+    } else {
+      G4cerr << "Warning: sweep point '" << line << "' has " << tokens.size()
+             << " values for " << m_keys.size() << " keys; skipped" << G4endl;
+    }
+  }
+
+  for (const auto& key : m_keys) {
+    if (!SimParameters::IsKnownKey(key))
+      G4cerr << "Warning: sweep key '" << key << "' is not a known conf key" << G4endl;
+    // "seg<i>.<key>": same restriction as <key>
+    const std::size_t dot = key.find('.');
+    if (kFixedKeys.count(dot == std::string::npos ? key : key.substr(dot + 1))) {
+      G4Exception("ParameterSweep::LoadPoints", "FixedKey", FatalException,
+                  ("'" + key + "' is read once per process and cannot be swept").c_str());
+      return false;
+    }
+  }
+
+  // Expand the grid (last key varies fastest)
+  if (!grid_values.empty()) {
+    m_points.assign(1, std::vector<std::string>());
+    for (const auto& values : grid_values) {
+      std::vector<std::vector<std::string>> expanded;
+      for (const auto& point : m_points) {
+        for (const auto& v : values) {
+          expanded.push_back(point);
+          expanded.back().push_back(v);
+        }
+      }
+      m_points.swap(expanded);
+    }
+  }
+
+  G4cout << "ParameterSweep: " << m_points.size() << " points over "
+         << m_keys.size() << " keys from " << filename << G4endl;
+  return !m_points.empty();
+}
+
+//_____________________________________________________________________________
+RunSummary ParameterSweep::RunPoint(const std::vector<std::string>& keys,
+                                    const std::vector<std::string>& values,
+                                    G4int n_events, const G4String& path)
+{
+  std::set<std::string> changed;
+  for (std::size_t k = 0; k < keys.size(); ++k) {
+    const auto& key = keys[k];
+    const auto& value = values[k];
+    if (gConfMan.Check(key) && gConfMan.Get(key) == value) continue;
+    gConfMan.Set(key, value);
+    changed.insert(key);
+  }
+  if (!changed.empty()) SimParameters::Resolve();
+  if (!changed.empty() && m_detector->UpdateOpticalParameters(changed))
+    m_run_manager->PhysicsHasBeenModified();
+  if (!changed.empty() && PhotonLUT::LookupMode()) PhotonLUT::UpdateSharedTable();
+
+  AnaManager::SetOutputRootfilePath(path);
+  m_run_manager->BeamOn(n_events);
+  return OutputWriter::GetInstance().GetRunSummary();
+}
+
+//_____________________________________________________________________________
+void ParameterSweep::Run(G4int n_events)
+{
+  G4String stem = AnaManager::GetOutputRootfilePath();
+  if (G4StrUtil::ends_with(stem, ".root")) stem.erase(stem.size() - 5);
+
+  std::ofstream summary(stem + "_sweep.tsv");
+  summary << "point";
+  for (const auto& key : m_keys) summary << "\t" << key;
+  summary << "\tn_events\tnpe_mean\tnpe_rms\tseconds";
+  // Correlated sampling: difference to the first point, event by event
+  const G4bool paired = EventSeeder::CommonRandomNumbers();
+  if (paired) summary << "\tnpe_diff\tnpe_diff_err";
+  summary << std::endl;
+  std::vector<G4double> reference;
+
+  for (std::size_t i = 0; i < m_points.size(); ++i) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_p%03zu.root", i);
+
+    G4cout << "=== Sweep point " << i << "/" << m_points.size() << ":";
+    for (std::size_t k = 0; k < m_keys.size(); ++k)
+      G4cout << " " << m_keys[k] << "=" << m_points[i][k];
+    G4cout << " ===" << G4endl;
+
+    G4Timer timer;
+    timer.Start();
+    const RunSummary run = RunPoint(m_keys, m_points[i], n_events, stem + suffix);
+    timer.Stop();
+
+    summary << i;
+    for (const auto& value : m_points[i]) summary << "\t" << value;
+    summary << "\t" << run.n_events << "\t" << run.Mean() << "\t" << run.RMS()
+            << "\t" << timer.GetRealElapsed();
+    if (paired) {
+      const auto& npe = OutputWriter::GetInstance().GetEventNpe();
+      if (i == 0) reference = npe;
+      G4double diff = 0., error = 0.;
+      PairedDifference(npe, reference, diff, error);
+      summary << "\t" << diff << "\t" << error;
+    }
+    summary << std::endl;
+  }
+  AnaManager::SetOutputRootfilePath(stem + ".root");
+}
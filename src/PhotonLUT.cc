@@ -0,0 +1,401 @@
+#include "PhotonLUT.hh"
+#include "ConfManager.hh"
+#include "KVC_OpticalProperties.hh"
+
+#include "G4AutoLock.hh"
+#include "G4Box.hh"
+#include "G4Exception.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VPhysicalVolume.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+
+  const char kMagic[8] = {'K','V','C','L','U','T','0','2'};
+
+  G4ThreadLocal PhotonLUT* tThreadTable = nullptr;
+  PhotonLUT* gSharedTable = nullptr; // merged (train) or loaded (lut)
+  G4Mutex gLUTMutex = G4MUTEX_INITIALIZER;
+
+  inline G4int Bin(G4double value, G4double lo, G4double hi, G4int n)
+  {
+    G4int i = (G4int)((value - lo) / (hi - lo) * n);
+    return std::min(std::max(i, 0), n - 1);
+  }
+
+  // Centre of KvcPV in the world (neither KvcPV nor KvcMotherPV is rotated)
+  G4ThreeVector RadiatorOrigin()
+  {
+    auto store = G4PhysicalVolumeStore::GetInstance();
+    G4ThreeVector origin;
+    if (auto mother_pv = store->GetVolume("KvcMotherPV", false)) origin += mother_pv->GetTranslation();
+    if (auto kvc_pv = store->GetVolume("KvcPV", false)) origin += kvc_pv->GetTranslation();
+    return origin;
+  }
+
+  template <typename T>
+  void WriteVector(std::ofstream& out, const std::vector<T>& v)
+  {
+    out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+  }
+
+  template <typename T>
+  void ReadVector(std::ifstream& in, std::vector<T>& v, std::size_t n)
+  {
+    v.resize(n);
+    in.read(reinterpret_cast<char*>(v.data()), n * sizeof(T));
+  }
+}
+
+//_____________________________________________________________________________
+PhotonLUT::PhotonLUT()
+  : m_nx(4), m_ny(12), m_nz(4), m_ndy(8), m_nphi(8), m_ne(6), m_ncopy(0), m_nt(64),
+    m_hx(0.), m_hy(0.), m_hz(0.),
+    m_emin(KVC_Optical::E_MPPC_PDE.front()), m_emax(KVC_Optical::E_MPPC_PDE.back()),
+    m_tmax(8.0 * ns),
+    m_min_stat(20)
+{
+  if (gConfMan.Check("fastsim_min_stat")) m_min_stat = gConfMan.GetInt("fastsim_min_stat");
+}
+
+//_____________________________________________________________________________
+PhotonLUT::~PhotonLUT()
+{
+}
+
+//_____________________________________________________________________________
+void PhotonLUT::Configure()
+{
+  auto store = G4PhysicalVolumeStore::GetInstance();
+  auto kvc_pv = store->GetVolume("KvcPV", false);
+  auto kvc_box = kvc_pv ? dynamic_cast<G4Box*>(kvc_pv->GetLogicalVolume()->GetSolid()) : nullptr;
+  if (!kvc_box) {
+    G4Exception("PhotonLUT::Configure", "NoRadiator", FatalException,
+                "KvcPV with a G4Box solid is required for the lookup table.");
+    return;
+  }
+  m_hx = kvc_box->GetXHalfLength();
+  m_hy = kvc_box->GetYHalfLength();
+  m_hz = kvc_box->GetZHalfLength();
+
+  // MPPC copies are placed directly in the mother volume, like KvcPV; their
+  // positions are kept relative to the radiator centre.
+  m_origin = RadiatorOrigin();
+  m_copy_pos.clear();
+  for (auto pv : *store) {
+    if (pv->GetName() != "MppcPV") continue;
+    G4int copy = pv->GetCopyNo();
+    if (copy >= (G4int)m_copy_pos.size()) m_copy_pos.resize(copy + 1);
+    m_copy_pos[copy] = pv->GetTranslation() - kvc_pv->GetTranslation();
+  }
+  m_ncopy = m_copy_pos.size();
+  m_key = ConfigurationKey();
+
+  const std::size_t ncell = (std::size_t)m_nx * m_ny * m_nz * m_ndy * m_nphi * m_ne;
+  m_emitted.assign(ncell, 0);
+  m_detected.assign(ncell * m_ncopy, 0);
+  m_delay.assign(ncell * m_nt, 0);
+}
+
+//_____________________________________________________________________________
+G4int PhotonLUT::FindCell(const G4ThreeVector& pos, const G4ThreeVector& dir, G4double energy) const
+{
+  if (energy < m_emin || energy >= m_emax) return -1; // not tabulated (the PDE is clamped, not zero, outside)
+  G4int ix   = Bin(pos.x(), -m_hx, m_hx, m_nx);
+  G4int iy   = Bin(pos.y(), -m_hy, m_hy, m_ny);
+  G4int iz   = Bin(pos.z(), -m_hz, m_hz, m_nz);
+  G4int idy  = Bin(dir.y(), -1., 1., m_ndy);
+  G4int iphi = Bin(std::atan2(dir.z(), dir.x()), -CLHEP::pi, CLHEP::pi, m_nphi);
+  G4int ie   = Bin(energy, m_emin, m_emax, m_ne);
+  return ((((ix * m_ny + iy) * m_nz + iz) * m_ndy + idy) * m_nphi + iphi) * m_ne + ie;
+}
+
+//_____________________________________________________________________________
+void PhotonLUT::RecordEmitted(const G4ThreeVector& pos, const G4ThreeVector& dir, G4double energy)
+{
+  G4int cell = FindCell(pos - m_origin, dir, energy);
+  if (cell >= 0) ++m_emitted[cell];
+}
+
+//_____________________________________________________________________________
+void PhotonLUT::RecordDetected(const G4ThreeVector& pos, const G4ThreeVector& dir, G4double energy,
+                               G4int copy, G4double delay)
+{
+  G4int cell = FindCell(pos - m_origin, dir, energy);
+  if (cell < 0 || copy < 0 || copy >= m_ncopy) return;
+  ++m_detected[(std::size_t)cell * m_ncopy + copy];
+  ++m_delay[(std::size_t)cell * m_nt + Bin(delay, 0., m_tmax, m_nt)];
+}
+
+//_____________________________________________________________________________
+void PhotonLUT::Add(const PhotonLUT& other)
+{
+  if (other.m_emitted.size() != m_emitted.size()
+      || other.m_detected.size() != m_detected.size()) {
+    G4Exception("PhotonLUT::Add", "BinningMismatch", FatalException,
+                "Cannot merge lookup tables with different binning.");
+    return;
+  }
+  for (std::size_t i = 0; i < m_emitted.size(); ++i)  m_emitted[i]  += other.m_emitted[i];
+  for (std::size_t i = 0; i < m_detected.size(); ++i) m_detected[i] += other.m_detected[i];
+  for (std::size_t i = 0; i < m_delay.size(); ++i)    m_delay[i]    += other.m_delay[i];
+}
+
+//_____________________________________________________________________________
+G4bool PhotonLUT::Save(const G4String& path) const
+{
+  std::ofstream out(path, std::ios::binary);
+  if (!out) return false;
+  out.write(kMagic, sizeof(kMagic));
+  uint32_t key_size = m_key.size();
+  out.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+  out.write(m_key.data(), key_size);
+  G4int ibins[8] = { m_nx, m_ny, m_nz, m_ndy, m_nphi, m_ne, m_ncopy, m_nt };
+  G4double dbins[6] = { m_hx, m_hy, m_hz, m_emin, m_emax, m_tmax };
+  out.write(reinterpret_cast<const char*>(ibins), sizeof(ibins));
+  out.write(reinterpret_cast<const char*>(dbins), sizeof(dbins));
+  for (const auto& p : m_copy_pos) {
+    G4double xyz[3] = { p.x(), p.y(), p.z() };
+    out.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+  }
+  WriteVector(out, m_emitted);
+  WriteVector(out, m_detected);
+  WriteVector(out, m_delay);
+  return out.good();
+}
+
+//_____________________________________________________________________________
+G4bool PhotonLUT::Load(const G4String& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  char magic[sizeof(kMagic)];
+  in.read(magic, sizeof(magic));
+  if (!std::equal(magic, magic + sizeof(magic), kMagic)) return false;
+
+  uint32_t key_size = 0;
+  in.read(reinterpret_cast<char*>(&key_size), sizeof(key_size));
+  std::string key(key_size, '\0');
+  in.read(&key[0], key_size);
+  if (key != ConfigurationKey()) {
+    G4Exception("PhotonLUT::Load", "KeyMismatch", FatalException,
+                ("Lookup table " + path + " was trained for a different configuration:\n  "
+                 + key + "\ncurrent:\n  " + ConfigurationKey()).c_str());
+    return false;
+  }
+  m_key = key;
+
+  G4int ibins[8];
+  G4double dbins[6];
+  in.read(reinterpret_cast<char*>(ibins), sizeof(ibins));
+  in.read(reinterpret_cast<char*>(dbins), sizeof(dbins));
+  m_nx = ibins[0]; m_ny = ibins[1]; m_nz = ibins[2]; m_ndy = ibins[3];
+  m_nphi = ibins[4]; m_ne = ibins[5]; m_ncopy = ibins[6]; m_nt = ibins[7];
+  m_hx = dbins[0]; m_hy = dbins[1]; m_hz = dbins[2];
+  m_emin = dbins[3]; m_emax = dbins[4]; m_tmax = dbins[5];
+  m_origin = RadiatorOrigin();
+  m_copy_pos.resize(m_ncopy);
+  for (auto& p : m_copy_pos) {
+    G4double xyz[3];
+    in.read(reinterpret_cast<char*>(xyz), sizeof(xyz));
+    p.set(xyz[0], xyz[1], xyz[2]);
+  }
+  const std::size_t ncell = (std::size_t)m_nx * m_ny * m_nz * m_ndy * m_nphi * m_ne;
+  ReadVector(in, m_emitted, ncell);
+  ReadVector(in, m_detected, ncell * m_ncopy);
+  ReadVector(in, m_delay, ncell * m_nt);
+  if (!in) return false;
+
+  BuildSamplingTables();
+  return true;
+}
+
+//_____________________________________________________________________________
+void PhotonLUT::BuildSamplingTables()
+{
+  const std::size_t ncell = m_emitted.size();
+  m_p_detect.assign(ncell, 0.f);
+  m_copy_cdf.assign(ncell * m_ncopy, 0.f);
+  m_delay_cdf.assign(ncell * m_nt, 0.f);
+  for (std::size_t c = 0; c < ncell; ++c) {
+    G4double n_det = 0.;
+    for (G4int i = 0; i < m_ncopy; ++i) n_det += m_detected[c * m_ncopy + i];
+    if (m_emitted[c] == 0 || n_det == 0.) continue;
+    m_p_detect[c] = std::min(1., n_det / m_emitted[c]);
+
+    G4double sum = 0.;
+    for (G4int i = 0; i < m_ncopy; ++i) {
+      sum += m_detected[c * m_ncopy + i];
+      m_copy_cdf[c * m_ncopy + i] = sum / n_det;
+    }
+    G4double n_delay = 0.;
+    for (G4int i = 0; i < m_nt; ++i) n_delay += m_delay[c * m_nt + i];
+    sum = 0.;
+    for (G4int i = 0; i < m_nt; ++i) {
+      sum += m_delay[c * m_nt + i];
+      m_delay_cdf[c * m_nt + i] = n_delay > 0. ? sum / n_delay : 1.;
+    }
+  }
+}
+
+//_____________________________________________________________________________
+G4bool PhotonLUT::IsReliable(G4int cell) const
+{
+  return cell >= 0 && m_emitted[cell] >= m_min_stat;
+}
+
+//_____________________________________________________________________________
+G4bool PhotonLUT::Sample(G4int cell, G4int& copy, G4double& delay) const
+{
+  if (cell < 0 || G4UniformRand() >= m_p_detect[cell]) return false;
+
+  const float* copy_cdf = &m_copy_cdf[(std::size_t)cell * m_ncopy];
+  G4double u = G4UniformRand();
+  copy = std::lower_bound(copy_cdf, copy_cdf + m_ncopy, (float)u) - copy_cdf;
+  if (copy >= m_ncopy) copy = m_ncopy - 1;
+
+  const float* delay_cdf = &m_delay_cdf[(std::size_t)cell * m_nt];
+  u = G4UniformRand();
+  G4int bin = std::lower_bound(delay_cdf, delay_cdf + m_nt, (float)u) - delay_cdf;
+  if (bin >= m_nt) bin = m_nt - 1;
+  delay = (bin + G4UniformRand()) * m_tmax / m_nt;
+  return true;
+}
+
+//_____________________________________________________________________________
+G4ThreeVector PhotonLUT::GetCopyPosition(G4int copy) const
+{
+  if (copy < 0 || copy >= m_ncopy) return G4ThreeVector();
+  return m_origin + m_copy_pos[copy];
+}
+
+//_____________________________________________________________________________
+G4bool PhotonLUT::TrainingMode()
+{
+  static const G4bool train = gConfMan.Check("fastsim_mode") && gConfMan.Get("fastsim_mode") == "train";
+  return train;
+}
+
+//_____________________________________________________________________________
+G4bool PhotonLUT::LookupMode()
+{
+  static const G4bool lut = gConfMan.Check("fastsim_mode") && gConfMan.Get("fastsim_mode") == "lut";
+  return lut;
+}
+
+//_____________________________________________________________________________
+// Every conf value the detection probability depends on.
+std::string PhotonLUT::ConfigurationKey()
+{
+  static const char* keys[] = {
+    "quartz_thickness", "do_segmentize", "wrapper_thickness", "air_layer_thickness",
+    "wrap_type", "quartz_finish", "Quartz_A_Alpha", "Quartz_B_Alpha", "sigma_alpha",
+    "quartz_boundary_reflectivity", "quartz_specularSpike", "quartz_specularLobe",
+    "quartz_backScatter", "quartz_diffuseLobe", "quartz_abs_scale", "air_rindex",
+    "teflon_rindex", "teflon_reflectivity_scale", "teflon_sigma_alpha",
+    "teflon_specularSpike", "teflon_specularLobe", "teflon_backScatter",
+    "teflon_diffuseLobe", "ej510_sigma_alpha", "ej510_specularSpike",
+    "ej510_specularLobe", "ej510_backScatter", "ej510_diffuseLobe",
+    "is_teflon", "is_paint", "qe_scale"
+  };
+  std::string key;
+  for (auto k : keys) {
+    key += k;
+    key += "=";
+    key += gConfMan.Check(k) ? gConfMan.Get(k) : "-";
+    key += ";";
+  }
+  return key;
+}
+
+//_____________________________________________________________________________
+G4String PhotonLUT::DefaultTablePath()
+{
+  if (gConfMan.Check("fastsim_table")) return gConfMan.Get("fastsim_table");
+  char name[64];
+  std::snprintf(name, sizeof(name), "kvc_lut_%016zx.bin",
+                std::hash<std::string>()(ConfigurationKey()));
+  return name;
+}
+
+//_____________________________________________________________________________
+PhotonLUT* PhotonLUT::GetThreadTable()
+{
+  if (!tThreadTable) {
+    tThreadTable = new PhotonLUT;
+    tThreadTable->Configure();
+  }
+  return tThreadTable;
+}
+
+//_____________________________________________________________________________
+void PhotonLUT::MergeThreadTable()
+{
+  if (!tThreadTable) return;
+  G4AutoLock lock(&gLUTMutex);
+  if (!gSharedTable) {
+    gSharedTable = new PhotonLUT;
+    gSharedTable->Configure();
+  }
+  gSharedTable->Add(*tThreadTable);
+  delete tThreadTable;
+  tThreadTable = nullptr;
+}
+
+//_____________________________________________________________________________
+void PhotonLUT::SaveTrainingTable()
+{
+  G4AutoLock lock(&gLUTMutex);
+  if (!gSharedTable) return;
+  G4String path = DefaultTablePath();
+  if (gSharedTable->Save(path)) {
+    G4cout << "PhotonLUT: training table written to " << path << G4endl;
+  } else {
+    G4Exception("PhotonLUT::SaveTrainingTable", "WriteFailed", JustWarning,
+                ("Cannot write " + path).c_str());
+  }
+  delete gSharedTable;
+  gSharedTable = nullptr;
+}
+
+//_____________________________________________________________________________
+const PhotonLUT* PhotonLUT::GetSharedTable()
+{
+  G4AutoLock lock(&gLUTMutex);
+  if (!gSharedTable) {
+    G4String path = DefaultTablePath();
+    auto table = new PhotonLUT;
+    if (!table->Load(path)) {
+      delete table;
+      G4Exception("PhotonLUT::GetSharedTable", "LoadFailed", FatalException,
+                  ("Cannot read lookup table " + path + " (run with fastsim_mode train first)").c_str());
+      return nullptr;
+    }
+    G4cout << "PhotonLUT: loaded " << path << G4endl;
+    gSharedTable = table;
+  }
+  return gSharedTable;
+}
+
+//_____________________________________________________________________________
+void PhotonLUT::UpdateSharedTable()
+{
+  G4AutoLock lock(&gLUTMutex);
+  if (!gSharedTable || gSharedTable->m_key == ConfigurationKey()) return;
+  G4String path = DefaultTablePath();
+  if (!gSharedTable->Load(path)) {
+    G4Exception("PhotonLUT::UpdateSharedTable", "LoadFailed", FatalException,
+                ("Cannot read lookup table " + path + " (run with fastsim_mode train first)").c_str());
+    return;
+  }
+  G4cout << "PhotonLUT: reloaded " << path << G4endl;
+}
@@ -0,0 +1,89 @@
+#include "PhotonLUTModel.hh"
+#include "PhotonLUT.hh"
+#include "MPPCHit.hh"
+
+#include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4FastStep.hh"
+#include "G4FastTrack.hh"
+#include "G4EmProcessSubType.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SDManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+
+//_____________________________________________________________________________
+PhotonLUTModel::PhotonLUTModel(const G4String& name, G4Region* envelope)
+  : G4VFastSimulationModel(name, envelope),
+    m_table(PhotonLUT::GetSharedTable()),
+    m_coll_id(-1),
+    m_cell(-1)
+{
+}
+
+//_____________________________________________________________________________
+PhotonLUTModel::~PhotonLUTModel()
+{
+}
+
+//_____________________________________________________________________________
+G4bool PhotonLUTModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return &particle == G4OpticalPhoton::OpticalPhotonDefinition();
+}
+
+//_____________________________________________________________________________
+// Only freshly created Cherenkov photons: the table describes the fate from
+// the emission point on.
+G4bool PhotonLUTModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  if (track->GetCurrentStepNumber() > 1) return false;
+  const G4VProcess* creator = track->GetCreatorProcess();
+  if (!creator || creator->GetProcessSubType() != fCerenkov) return false;
+
+  // Local coordinates of the envelope, KvcLV, as the table is binned
+  m_cell = m_table->FindCell(fastTrack.GetPrimaryTrackLocalPosition(),
+                             fastTrack.GetPrimaryTrackLocalDirection(),
+                             track->GetKineticEnergy());
+  // Outside the tabulated energy range (E_MPPC_PDE) the PDE takes its
+  // non-zero end-point value: track those photons. Otherwise require enough
+  // training statistics.
+  return m_cell >= 0 && m_table->IsReliable(m_cell);
+}
+
+//_____________________________________________________________________________
+void PhotonLUTModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.0);
+
+  G4int copy = -1;
+  G4double delay = 0.;
+  if (!m_table->Sample(m_cell, copy, delay)) return;
+
+  const G4Event* event = G4EventManager::GetEventManager()->GetConstCurrentEvent();
+  G4HCofThisEvent* HCTE = event ? event->GetHCofThisEvent() : nullptr;
+  if (!HCTE) return;
+  if (m_coll_id < 0) m_coll_id = G4SDManager::GetSDMpointer()->GetCollectionID("MppcCollection");
+  if (m_coll_id < 0) return;
+  auto hitsCollection = static_cast<G4THitsCollection<MPPCHit>*>(HCTE->GetHC(m_coll_id));
+  if (!hitsCollection) return;
+
+  G4double energy = track->GetTotalEnergy();
+  auto aHit = new MPPCHit();
+  aHit->SetPosition(G4ThreeVector()); // centre of the MPPC (local)
+  aHit->SetWorldPosition(m_table->GetCopyPosition(copy));
+  aHit->SetEnergy(energy);
+  aHit->SetWaveLength((CLHEP::h_Planck * CLHEP::c_light / energy) / CLHEP::nm);
+  aHit->SetTime(track->GetGlobalTime() + delay);
+  aHit->SetParticleID(track->GetDefinition()->GetPDGEncoding());
+  aHit->SetCopyNumber(copy);
+  aHit->SetEventID(event->GetEventID());
+  aHit->SetDetectFlag(1);
+  aHit->SetWeight(track->GetWeight());
+  hitsCollection->insert(aHit);
+}
@@ -11,10 +11,10 @@
 #include "G4LorentzVector.hh"
 #include "Randomize.hh"
 
-#include <TFile.h>
-#include <TTree.h>
-
+#include "BeamPool.hh"
 #include "ConfManager.hh"
+#include "EventSeeder.hh"
+#include "SimParameters.hh"
 
 #define DEBUG 0
 
@@ -24,38 +24,27 @@ namespace
   using CLHEP::deg;
   using CLHEP::GeV;
   const auto particleTable = G4ParticleTable::GetParticleTable();
-  auto& gAnaMan  = AnaManager::GetInstance();
   auto& gConfMan = ConfManager::GetInstance();
 }
 
 //_____________________________________________________________________________
 PrimaryGeneratorAction::PrimaryGeneratorAction()
   : G4VUserPrimaryGeneratorAction(),
-    fRootFile(nullptr), fTree(nullptr), fMaxEntries(0)
+    fBeamPool(nullptr), fSegment(0), fSample(0)
 {
   fParticleGun = new G4ParticleGun(1);
 
-  // Initialize ROOT beam if file is provided
-  G4String input_file = gConfMan.Get("input_beam_file");
-  if(!input_file.empty() && input_file != "none") {
-    fRootFile = new TFile(input_file, "READ");
-    if(fRootFile && fRootFile->IsOpen()) {
-      fTree = (TTree*)fRootFile->Get("tree"); // Expecting tree named "tree"
-      if(fTree) {
-        fMaxEntries = fTree->GetEntries();
-        fTree->SetBranchAddress("px", &fPx);
-        fTree->SetBranchAddress("py", &fPy);
-        fTree->SetBranchAddress("pz", &fPz);
-        fTree->SetBranchAddress("vx", &fVx);
-        fTree->SetBranchAddress("vy", &fVy);
-        fTree->SetBranchAddress("vz", &fVz);
-        G4cout << "PrimaryGeneratorAction: ROOT beam mode enabled (Random Sampling). File: " << input_file 
-               << " (Pool Size: " << fMaxEntries << ")" << G4endl;
-      } else {
-        G4Exception("PrimaryGeneratorAction::PrimaryGeneratorAction", "TreeNotFound", FatalException, "TTree 'tree' not found in ROOT beam file.");
-      }
-    } else {
-      G4Exception("PrimaryGeneratorAction::PrimaryGeneratorAction", "FileNotFound", FatalException, "Failed to open ROOT beam file.");
+  // ROOT beam: the file is read once into the shared BeamPool. Split
+  // segments each read seg<i>.input_beam_file (default input_beam_file).
+  const SimParameters& params = SimParameters::Get();
+  const G4int n_pools = (params.n_segments > 0 && !params.segment_beam_merged) ? params.n_segments : 1;
+  fBeamPools.assign(n_pools, nullptr);
+  for(G4int i = 0; i < n_pools; ++i) {
+    const std::string key = params.SegmentKey(i, "input_beam_file");
+    G4String input_file = gConfMan.Check(key) ? G4String(gConfMan.Get(key)) : G4String();
+    if(!input_file.empty() && input_file != "none") {
+      auto& pool = BeamPool::GetInstance(i);
+      if(pool.Load(input_file)) fBeamPools[i] = &pool;
     }
   }
 }
@@ -64,33 +53,70 @@ PrimaryGeneratorAction::PrimaryGeneratorAction()
 PrimaryGeneratorAction::~PrimaryGeneratorAction()
 {
   delete fParticleGun;
-  if(fRootFile) {
-    fRootFile->Close();
-    delete fRootFile;
-  }
 }
 
 //_____________________________________________________________________________
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
-  if(fTree) {
+  const SimParameters& params = SimParameters::Get();
+  const G4int event = anEvent->GetEventID() + params.first_event;
+
+  // Before the first random number of the event
+  EventSeeder::SeedEvent(event);
+
+  // Split segments take the events in turn, each drawing from its own beam
+  fSegment = 0;
+  fSample = event;
+  if(params.n_segments > 0 && !params.segment_beam_merged) {
+    fSegment = event % params.n_segments;
+    fSample = event / params.n_segments;
+  }
+  fBeamPool = fBeamPools[fSegment];
+
+  if(params.photon_gun) {
+    GeneratePhoton(anEvent);
+  } else if(fBeamPool) {
     GenerateRootBeam(anEvent);
   } else {
     GenerateBeam(anEvent);
   }
+  AnaManager::GetInstance().SetSegment(fSegment);
+}
+
+//_____________________________________________________________________________
+// Vertices are generated in the frame of one segment. Split: shift to the
+// segment of the event. Merged: the vertex is already in the layout frame
+// and decides the segment.
+G4ThreeVector PrimaryGeneratorAction::ToLayout(const G4ThreeVector& position)
+{
+  const SimParameters& params = SimParameters::Get();
+  if(params.n_segments > 0 && params.segment_beam_merged) {
+    fSegment = params.SegmentAt(position.x());
+    return position;
+  }
+  return position + G4ThreeVector(params.SegmentOffset(fSegment), 0., 0.);
+}
+
+//_____________________________________________________________________________
+G4double PrimaryGeneratorAction::BeamYOffset() const
+{
+  const SimParameters& params = SimParameters::Get();
+  if(params.n_segments > 0 && !params.segment_beam_merged)
+    return params.segment_beam_y_offset[fSegment];
+  return params.beam_y_offset;
 }
 
 //_____________________________________________________________________________
 void PrimaryGeneratorAction::GenerateBeam(G4Event *anEvent)
 {
-  static const G4String particle_name = gConfMan.Get("particle");
+  static const G4String particle_name = SimParameters::Get().particle;
   static const auto particle = particleTable->FindParticle(particle_name);
   fParticleGun->SetParticleDefinition(particle);
 
   // -----------------------
   // Momentum
   // -----------------------
-  G4double p0 = gConfMan.GetDouble("momentum") * GeV;
+  G4double p0 = SimParameters::Get().momentum;
   G4double sigma_p = p0 * 0.02 / 2.355;
   // G4double momentum = G4RandGauss::shoot(p0, sigma_p);
   G4double momentum = p0;
@@ -99,7 +125,7 @@ void PrimaryGeneratorAction::GenerateBeam(G4Event *anEvent)
   G4double energy = std::sqrt(mass * mass + momentum * momentum);
   G4double kineticE = energy - mass;
 
-  gAnaMan.SetBeamEnergy(kineticE);
+  AnaManager::GetInstance().SetBeamEnergy(kineticE);
   fParticleGun->SetParticleEnergy(kineticE); // Set kinetic energy
 
   // -----------------------
@@ -116,7 +142,7 @@ void PrimaryGeneratorAction::GenerateBeam(G4Event *anEvent)
   G4double pz = momentum * std::cos(theta);
 
   G4ThreeVector direction(px, py, pz);
-  gAnaMan.SetBeamMomentum(direction);
+  AnaManager::GetInstance().SetBeamMomentum(direction);
   direction = direction.unit(); // normalize
 
   // fParticleGun->SetParticleMomentum(momentum);
@@ -132,12 +158,12 @@ void PrimaryGeneratorAction::GenerateBeam(G4Event *anEvent)
   // G4double x = G4RandGauss::shoot(x0, sigmaX);
   // G4double y = G4RandGauss::shoot(y0, sigmaY);
   G4double x = 0.0 * mm;
-  G4double y = gConfMan.GetDouble("beam_y_offset") * mm;
+  G4double y = BeamYOffset();
   G4double z = z0;
 
-  G4ThreeVector position(x, y, z);
+  G4ThreeVector position = ToLayout(G4ThreeVector(x, y, z));
   fParticleGun->SetParticlePosition(position);
-  gAnaMan.SetBeamPosition(position);
+  AnaManager::GetInstance().SetBeamPosition(position);
 
   // -----------------------
   // Debug
@@ -174,7 +200,7 @@ void PrimaryGeneratorAction::GeneratePhoton(G4Event* anEvent)
   G4double wavelength = G4UniformRand() * (wl_max - wl_min) + wl_min;
   wavelength = 400.0 * CLHEP::nm;
   G4double energy = (CLHEP::h_Planck * CLHEP::c_light  / wavelength);
-  gAnaMan.SetBeamEnergy(energy);  
+  AnaManager::GetInstance().SetBeamEnergy(energy);  
   fParticleGun->SetParticleEnergy(energy);
 
     
@@ -196,7 +222,7 @@ void PrimaryGeneratorAction::GeneratePhoton(G4Event* anEvent)
   G4double pz = std::cos(theta);
 
   G4ThreeVector direction(px, py, pz);
-  gAnaMan.SetBeamMomentum(direction);
+  AnaManager::GetInstance().SetBeamMomentum(direction);
   direction = direction.unit();  // normalize
 
   // fParticleGun->SetParticleMomentum(momentum);
@@ -215,9 +241,9 @@ void PrimaryGeneratorAction::GeneratePhoton(G4Event* anEvent)
   G4double y = 0.0 * mm;
   G4double z = z0;
 
-  G4ThreeVector position(x, y, z);
+  G4ThreeVector position = ToLayout(G4ThreeVector(x, y, z));
   fParticleGun->SetParticlePosition(position);
-  gAnaMan.SetBeamPosition(position);
+  AnaManager::GetInstance().SetBeamPosition(position);
 
   // -----------------------
   // Debug
@@ -240,15 +266,14 @@ void PrimaryGeneratorAction::GeneratePhoton(G4Event* anEvent)
 //_____________________________________________________________________________
 void PrimaryGeneratorAction::GenerateRootBeam(G4Event* anEvent)
 {
-  // Random sampling (Bootstrap) from the pool of realistic particles
-  G4int entry = G4RandFlat::shootInt(fMaxEntries);
-  fTree->GetEntry(entry);
+  // Sampling from the pool of realistic particles (beam_sampling)
+  const G4long entry = fBeamPool->Entry(fSample);
 
-  static const G4String particle_name = gConfMan.Get("particle");
+  static const G4String particle_name = SimParameters::Get().particle;
   static const auto particle = particleTable->FindParticle(particle_name);
   fParticleGun->SetParticleDefinition(particle);
 
-  G4ThreeVector direction(fPx, fPy, fPz);
+  G4ThreeVector direction(fBeamPool->Px(entry), fBeamPool->Py(entry), fBeamPool->Pz(entry));
   G4double momentum = direction.mag() * MeV; // Fixed: Input is MeV/c
   direction = direction.unit();
 
@@ -256,21 +281,22 @@ void PrimaryGeneratorAction::GenerateRootBeam(G4Event* anEvent)
   G4double energy = std::sqrt(mass * mass + momentum * momentum);
   G4double kineticE = energy - mass;
 
-  gAnaMan.SetBeamEnergy(kineticE);
-  gAnaMan.SetBeamMomentum(direction * momentum);
+  AnaManager::GetInstance().SetBeamEnergy(kineticE);
+  AnaManager::GetInstance().SetBeamMomentum(direction * momentum);
   fParticleGun->SetParticleEnergy(kineticE);
   fParticleGun->SetParticleMomentumDirection(direction);
 
-  G4double thickness = gConfMan.GetDouble("quartz_thickness") * mm;
+  G4double thickness = SimParameters::Get().quartz_thickness;
   G4double z_surf = -thickness / 2.0;
 
   // ROOT file Z is ~ -10 mm (relative to surface). 
   // We align this to Geant4 surface position.
-  G4double y_offset = gConfMan.GetDouble("beam_y_offset") * mm;
-  G4ThreeVector position(fVx * mm, fVy * mm + y_offset, z_surf + fVz * mm);
+  G4double y_offset = BeamYOffset();
+  G4ThreeVector position = ToLayout(G4ThreeVector(fBeamPool->Vx(entry) * mm, fBeamPool->Vy(entry) * mm + y_offset,
+                                                  z_surf + fBeamPool->Vz(entry) * mm));
   
   fParticleGun->SetParticlePosition(position);
-  gAnaMan.SetBeamPosition(position);
+  AnaManager::GetInstance().SetBeamPosition(position);
 
   fParticleGun->GeneratePrimaryVertex(anEvent);
 }
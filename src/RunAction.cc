@@ -1,23 +1,22 @@
 #include "RunAction.hh"
 #include "AnaManager.hh"
+#include "Checkpoint.hh"
+#include "EventSeeder.hh"
+#include "OutputWriter.hh"
+#include "PhotonLUT.hh"
+#include "RunMetrics.hh"
+#include "StepProfiler.hh"
+#include "ConfManager.hh"
 
 #include <fstream>
 
 #include <G4Run.hh>
 #include <G4RunManager.hh>
 #include <G4StateManager.hh>
-#include <G4Timer.hh>
+#include <G4Threading.hh>
 #include <G4UIterminal.hh>
 #include <G4UItcsh.hh>
 
-#include "AnaManager.hh"
-
-namespace
-{
-auto& gAnaMan = AnaManager::GetInstance();
-G4Timer timer;
-}
-
 //_____________________________________________________________________________
 RunAction::RunAction()
   : G4UserRunAction()
@@ -34,18 +33,42 @@ void
 RunAction::BeginOfRunAction(const G4Run* aRun)
 {
   G4cout << "   Run# = " << aRun->GetRunID() << G4endl;
-  gAnaMan.BeginOfRunAction(aRun);
-  G4Random::setTheSeed(std::time(nullptr));
-  timer.Start();
+  // The master (or the only thread) owns the output file; workers only
+  // build event records.
+  if (IsMaster()) {
+    EventSeeder::BeginRun(aRun->GetRunID());
+    OutputWriter::GetInstance().Open(AnaManager::GetOutputRootfilePath(),
+                                     aRun->GetNumberOfEventToBeProcessed());
+    RunMetrics::Reset();
+    KVC_PROFILE_RESET();
+  }
+  if (!IsMaster() || !G4Threading::IsMultithreadedApplication())
+    AnaManager::GetInstance().BeginOfRunAction(aRun);
+  m_timer.Start();
 }
 
 //_____________________________________________________________________________
 void
 RunAction::EndOfRunAction(const G4Run* aRun)
 {
-  timer.Stop();
-  gAnaMan.EndOfRunAction(aRun);
-  G4cout << "   Process end  = " << timer.GetClockTime()
+  m_timer.Stop();
+  if (!IsMaster() || !G4Threading::IsMultithreadedApplication()) {
+    AnaManager::GetInstance().EndOfRunAction(aRun);
+    if (PhotonLUT::TrainingMode()) PhotonLUT::MergeThreadTable();
+    RunMetrics::MergeThread();
+    KVC_PROFILE_MERGE();
+  }
+  // All workers have finished here, so the writer can drain and close.
+  if (IsMaster()) {
+    OutputWriter::GetInstance().Close();
+    Checkpoint::EndRun(AnaManager::GetOutputRootfilePath());
+    if (PhotonLUT::TrainingMode()) PhotonLUT::SaveTrainingTable();
+    auto& confMan = ConfManager::GetInstance();
+    if (confMan.Check("metrics_file"))
+      RunMetrics::Write(confMan.Get("metrics_file"), aRun->GetNumberOfEvent(), m_timer.GetRealElapsed());
+    KVC_PROFILE_REPORT();
+  }
+  G4cout << "   Process end  = " << m_timer.GetClockTime()
 	 << "   Event number = " << aRun->GetNumberOfEvent() << G4endl
-	 << "   Elapsed time = " << timer << G4endl << G4endl;
+	 << "   Elapsed time = " << m_timer << G4endl << G4endl;
 }
@@ -0,0 +1,82 @@
+#include "RunMetrics.hh"
+#include "EventSeeder.hh"
+
+#include "G4AutoLock.hh"
+#include "G4Threading.hh"
+
+#include <sys/resource.h>
+
+#include <fstream>
+
+G4ThreadLocal RunMetrics::Counts RunMetrics::t_counts;
+
+namespace
+{
+  G4Mutex gMetricsMutex = G4MUTEX_INITIALIZER;
+  G4long gOpticalSteps = 0;
+  G4long gPhotonsTracked = 0;
+  G4String gLabel;
+
+  G4double PerSecond(G4double count, G4double seconds)
+  {
+    return seconds > 0. ? count / seconds : 0.;
+  }
+}
+
+//_____________________________________________________________________________
+void
+RunMetrics::SetLabel(const G4String& label)
+{
+  gLabel = label;
+}
+
+//_____________________________________________________________________________
+void
+RunMetrics::Reset()
+{
+  G4AutoLock lock(&gMetricsMutex);
+  gOpticalSteps = 0;
+  gPhotonsTracked = 0;
+}
+
+//_____________________________________________________________________________
+void
+RunMetrics::MergeThread()
+{
+  G4AutoLock lock(&gMetricsMutex);
+  gOpticalSteps   += t_counts.optical_steps;
+  gPhotonsTracked += t_counts.photons_tracked;
+  t_counts = Counts();
+}
+
+//_____________________________________________________________________________
+void
+RunMetrics::Write(const G4String& path, G4int n_events, G4double seconds)
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  std::ofstream out(path);
+  if (!out) {
+    G4cerr << "Warning: cannot write metrics file " << path << G4endl;
+    return;
+  }
+  const G4int threads = G4Threading::IsMultithreadedApplication()
+    ? G4Threading::GetNumberOfRunningWorkerThreads() : 1;
+
+  G4AutoLock lock(&gMetricsMutex);
+  out << "{\n"
+      << "  \"label\": \"" << gLabel << "\",\n"
+      << "  \"threads\": " << threads << ",\n"
+      << "  \"seed\": " << EventSeeder::MasterSeed() << ",\n"
+      << "  \"events\": " << n_events << ",\n"
+      << "  \"wall_seconds\": " << seconds << ",\n"
+      << "  \"events_per_second\": " << PerSecond(n_events, seconds) << ",\n"
+      << "  \"optical_steps\": " << gOpticalSteps << ",\n"
+      << "  \"optical_steps_per_second\": " << PerSecond(gOpticalSteps, seconds) << ",\n"
+      << "  \"photons_tracked\": " << gPhotonsTracked << ",\n"
+      << "  \"photons_per_second\": " << PerSecond(gPhotonsTracked, seconds) << ",\n"
+      << "  \"peak_rss_kb\": " << usage.ru_maxrss << "\n"
+      << "}\n";
+  G4cout << "Metrics written to " << path << G4endl;
+}
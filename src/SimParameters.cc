@@ -0,0 +1,346 @@
+#include "SimParameters.hh"
+#include "ConfManager.hh"
+#include "PhotonHistory.hh"
+
+#include "G4Exception.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+
+  SimParameters gParameters;
+
+  enum class ParamType { kDouble, kInt, kString };
+
+  struct KeySpec
+  {
+    const char* name;
+    ParamType type;
+  };
+
+  // Every key the simulation reads.
+  const KeySpec kKnownKeys[] = {
+    // Beam / physics
+    { "generator",                    ParamType::kString },
+    { "particle",                     ParamType::kString },
+    { "momentum",                     ParamType::kDouble },
+    { "decay",                        ParamType::kInt    },
+    { "input_beam_file",              ParamType::kString },
+    { "beam_y_offset",                ParamType::kDouble },
+    { "beam_sampling",                ParamType::kString },
+    { "beam_shuffle_seed",            ParamType::kInt    },
+    { "seed",                         ParamType::kInt    },
+    { "replay_event",                 ParamType::kInt    },
+    { "replay_run",                   ParamType::kInt    },
+    { "common_random_numbers",        ParamType::kInt    },
+    { "threads",                      ParamType::kInt    },
+    { "first_event",                  ParamType::kInt    },
+    { "n_events",                     ParamType::kInt    },
+    { "job_index",                    ParamType::kInt    },
+    { "n_jobs",                       ParamType::kInt    },
+    // Geometry
+    { "quartz_thickness",             ParamType::kDouble },
+    { "do_segmentize",                ParamType::kInt    },
+    { "wrapper_thickness",            ParamType::kDouble },
+    { "air_layer_thickness",          ParamType::kDouble },
+    { "wrap_type",                    ParamType::kInt    },
+    { "n_segments",                   ParamType::kInt    },
+    { "segment_pitch",                ParamType::kDouble },
+    { "segment_beam",                 ParamType::kString },
+    // Optics
+    { "quartz_finish",                ParamType::kInt    },
+    { "Quartz_A_Alpha",               ParamType::kDouble },
+    { "Quartz_B_Alpha",               ParamType::kDouble },
+    { "sigma_alpha",                  ParamType::kDouble },
+    { "quartz_boundary_reflectivity", ParamType::kDouble },
+    { "quartz_specularSpike",         ParamType::kDouble },
+    { "quartz_specularLobe",          ParamType::kDouble },
+    { "quartz_backScatter",           ParamType::kDouble },
+    { "quartz_diffuseLobe",           ParamType::kDouble },
+    { "quartz_abs_scale",             ParamType::kDouble },
+    { "air_rindex",                   ParamType::kDouble },
+    { "teflon_rindex",                ParamType::kDouble },
+    { "teflon_reflectivity_scale",    ParamType::kDouble },
+    { "teflon_sigma_alpha",           ParamType::kDouble },
+    { "teflon_specularSpike",         ParamType::kDouble },
+    { "teflon_specularLobe",          ParamType::kDouble },
+    { "teflon_backScatter",           ParamType::kDouble },
+    { "teflon_diffuseLobe",           ParamType::kDouble },
+    { "ej510_sigma_alpha",            ParamType::kDouble },
+    { "ej510_specularSpike",          ParamType::kDouble },
+    { "ej510_specularLobe",           ParamType::kDouble },
+    { "ej510_backScatter",            ParamType::kDouble },
+    { "ej510_diffuseLobe",            ParamType::kDouble },
+    { "is_teflon",                    ParamType::kInt    },
+    { "is_paint",                     ParamType::kInt    },
+    { "qe_scale",                     ParamType::kDouble },
+    // Parameter sweep
+    { "sweep_file",                   ParamType::kString },
+    { "sweep_events",                 ParamType::kInt    },
+    // Calibration
+    { "calib_file",                   ParamType::kString },
+    { "calib_events",                 ParamType::kInt    },
+    { "calib_design_points",          ParamType::kInt    },
+    { "calib_refine_points",          ParamType::kInt    },
+    { "calib_iterations",             ParamType::kInt    },
+    { "calib_seed",                   ParamType::kInt    },
+    // Fast simulation (lookup table, batch propagation)
+    { "fastsim_mode",                 ParamType::kString },
+    { "fastsim_table",                ParamType::kString },
+    { "fastsim_min_stat",             ParamType::kInt    },
+    { "fastsim_batch",                ParamType::kInt    },
+    // Variance reduction
+    { "photon_thinning",              ParamType::kDouble },
+    { "roulette_length",              ParamType::kDouble },
+    { "roulette_survival",            ParamType::kDouble },
+    { "kill_oracle",                  ParamType::kInt    },
+    { "kill_epsilon",                 ParamType::kDouble },
+    // Output
+    { "output_mode",                  ParamType::kString },
+    { "hist_npe_max",                 ParamType::kInt    },
+    { "gen_wavelength_mode",          ParamType::kString },
+    { "photon_history",               ParamType::kInt    },
+    { "output_branches",              ParamType::kString },
+    { "output_drop_redundant",        ParamType::kInt    },
+    { "output_precision",             ParamType::kString },
+    { "output_compression",           ParamType::kString },
+    { "output_compression_level",     ParamType::kInt    },
+    { "output_basket_size",           ParamType::kInt    },
+    // Checkpoints
+    { "checkpoint_events",            ParamType::kInt    },
+    { "resume",                       ParamType::kInt    },
+    // Benchmarking
+    { "metrics_file",                 ParamType::kString },
+    { "profile_file",                 ParamType::kString },
+  };
+
+  // Keys that may be set per segment as "seg<i>.<key>" (n_segments): the
+  // surfaces, the MPPC PDE scale and the beam.
+  const char* kSegmentKeys[] = {
+    "wrap_type", "quartz_finish", "Quartz_A_Alpha", "Quartz_B_Alpha", "sigma_alpha",
+    "quartz_boundary_reflectivity", "quartz_specularSpike", "quartz_specularLobe",
+    "quartz_backScatter", "quartz_diffuseLobe",
+    "teflon_reflectivity_scale", "teflon_sigma_alpha", "teflon_specularSpike",
+    "teflon_specularLobe", "teflon_backScatter", "teflon_diffuseLobe",
+    "ej510_sigma_alpha", "ej510_specularSpike", "ej510_specularLobe",
+    "ej510_backScatter", "ej510_diffuseLobe",
+    "is_teflon", "is_paint", "qe_scale", "input_beam_file", "beam_y_offset",
+  };
+
+  // "seg<i>.<key>" -> <key>; false if key has no segment prefix
+  G4bool StripSegment(const std::string& key, std::string& base)
+  {
+    if (key.compare(0, 3, "seg") != 0) return false;
+    std::size_t i = 3;
+    while (i < key.size() && std::isdigit((unsigned char)key[i])) ++i;
+    if (i == 3 || i >= key.size() || key[i] != '.') return false;
+    base = key.substr(i + 1);
+    return true;
+  }
+
+  const KeySpec* FindKey(const std::string& key)
+  {
+    std::string name = key;
+    if (StripSegment(key, name) &&
+        std::find(std::begin(kSegmentKeys), std::end(kSegmentKeys), name) == std::end(kSegmentKeys))
+      return nullptr;
+    for (const auto& spec : kKnownKeys)
+      if (name == spec.name) return &spec;
+    return nullptr;
+  }
+
+  G4bool IsValid(const std::string& value, ParamType type)
+  {
+    if (type == ParamType::kString) return true;
+    const char* begin = value.c_str();
+    char* end = nullptr;
+    if (type == ParamType::kDouble) std::strtod(begin, &end);
+    else                            std::strtol(begin, &end, 10);
+    return end != begin && *end == '\0';
+  }
+
+  G4double Double(const char* key, G4double fallback)
+  {
+    return gConfMan.Check(key) ? gConfMan.GetDouble(key) : fallback;
+  }
+}
+
+//_____________________________________________________________________________
+const SimParameters&
+SimParameters::Get()
+{
+  return gParameters;
+}
+
+//_____________________________________________________________________________
+G4double
+SimParameters::SegmentOffset(G4int segment) const
+{
+  return (segment - 0.5 * (NSegments() - 1)) * segment_pitch;
+}
+
+//_____________________________________________________________________________
+G4int
+SimParameters::SegmentAt(G4double x) const
+{
+  if (n_segments <= 0) return 0;
+  const G4int segment = (G4int)std::floor(x / segment_pitch + 0.5 * n_segments);
+  return std::min(std::max(segment, 0), n_segments - 1);
+}
+
+//_____________________________________________________________________________
+std::string
+SimParameters::SegmentKey(G4int segment, const std::string& key) const
+{
+  if (n_segments <= 0) return key;
+  const std::string prefixed = "seg" + std::to_string(segment) + "." + key;
+  return gConfMan.Check(prefixed) ? prefixed : key;
+}
+
+//_____________________________________________________________________________
+G4bool
+SimParameters::IsKnownKey(const std::string& key)
+{
+  return FindKey(key) != nullptr;
+}
+
+//_____________________________________________________________________________
+void
+SimParameters::Resolve()
+{
+  // Validation: type errors are fatal, unknown keys are reported.
+  std::ostringstream unknown, invalid;
+  for (const auto& key : gConfMan.Keys()) {
+    const KeySpec* spec = FindKey(key);
+    if (!spec) {
+      unknown << " " << key;
+      continue;
+    }
+    const std::string value = gConfMan.Get(key);
+    if (!IsValid(value, spec->type))
+      invalid << " " << key << "='" << value << "'"
+              << (spec->type == ParamType::kInt ? " (int)" : " (double)");
+  }
+  if (!unknown.str().empty())
+    G4Exception("SimParameters::Resolve", "UnknownConfKey", JustWarning,
+                ("Unknown conf keys (ignored):" + unknown.str()).c_str());
+  if (!invalid.str().empty())
+    G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                ("Invalid conf values:" + invalid.str()).c_str());
+
+  SimParameters p;
+  const G4String generator = gConfMan.Check("generator") ? G4String(gConfMan.Get("generator")) : G4String("beam");
+  if (generator != "beam" && generator != "photon") {
+    G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                "generator must be beam or photon");
+  }
+  p.photon_gun       = (generator == "photon");
+  p.particle         = gConfMan.Check("particle") ? G4String(gConfMan.Get("particle")) : G4String();
+  p.momentum         = Double("momentum", 0.) * GeV;
+  p.beam_y_offset    = Double("beam_y_offset", 0.) * mm;
+  p.quartz_thickness = Double("quartz_thickness", 0.) * mm;
+  p.first_event      = gConfMan.Check("first_event") ? gConfMan.GetInt("first_event") : 0;
+
+  p.quartz_finish = gConfMan.Check("quartz_finish") ? gConfMan.GetInt("quartz_finish") : 0;
+  p.qe_scale = Double("qe_scale", 1.);
+  if (p.qe_scale <= 0.)
+    G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                "qe_scale must be positive");
+
+  p.photon_thinning = Double("photon_thinning", 1.);
+  if (p.photon_thinning <= 0. || p.photon_thinning > 1.)
+    G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                "photon_thinning must be in (0, 1]");
+  p.roulette_length   = Double("roulette_length", 0.) * mm;
+  p.roulette_survival = Double("roulette_survival", 1.);
+  if (p.roulette_survival <= 0. || p.roulette_survival > 1.)
+    G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                "roulette_survival must be in (0, 1]");
+  p.kill_oracle  = gConfMan.Check("kill_oracle") && gConfMan.GetInt("kill_oracle") == 1;
+  p.kill_epsilon = Double("kill_epsilon", 0.);
+
+  // Generated wavelengths: binned by default when only histograms are written
+  G4String gen_mode = "vector";
+  if (gConfMan.Check("gen_wavelength_mode"))   gen_mode = gConfMan.Get("gen_wavelength_mode");
+  else if (gConfMan.Check("output_mode") && gConfMan.Get("output_mode") == "hist") gen_mode = "hist";
+  if      (gen_mode == "vector") p.gen_wavelength_mode = kGenWavelengthVector;
+  else if (gen_mode == "hist")   p.gen_wavelength_mode = kGenWavelengthHist;
+  else if (gen_mode == "off")    p.gen_wavelength_mode = kGenWavelengthOff;
+  else {
+    G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                "gen_wavelength_mode must be vector, hist or off");
+  }
+
+  // Photon history: written from SteppingAction, so only tracked photons
+  p.photon_history = gConfMan.Check("photon_history") ? gConfMan.GetInt("photon_history") : 0;
+  if (p.photon_history < PhotonHistory::kOff || p.photon_history > PhotonHistory::kAll) {
+    G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                "photon_history must be 0 (off), 1 (photons reaching an MPPC) or 2 (all)");
+  }
+  if (p.photon_history != 0) {
+    const G4String fastsim = gConfMan.Check("fastsim_mode") ? G4String(gConfMan.Get("fastsim_mode")) : G4String();
+    if (fastsim == "lut" || fastsim == "batch")
+      G4Exception("SimParameters::Resolve", "PhotonHistory", JustWarning,
+                  "photon_history: photons of fastsim_mode lut/batch are not tracked and have no history.");
+    if (p.kill_oracle)
+      G4Exception("SimParameters::Resolve", "PhotonHistory", JustWarning,
+                  "photon_history: the kill oracle uses the current optics, reweighted results are biased.");
+  }
+
+  // Segments
+  p.n_segments = gConfMan.Check("n_segments") ? gConfMan.GetInt("n_segments") : 0;
+  if (p.n_segments < 0 || p.n_segments > kMaxSegments) {
+    G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                ("n_segments must be between 0 (single segment) and " + std::to_string(kMaxSegments)).c_str());
+  }
+  if (p.n_segments > 0) {
+    if (!gConfMan.Check("do_segmentize") || gConfMan.GetInt("do_segmentize") != 1)
+      G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                  "n_segments requires do_segmentize 1 (26 mm segments)");
+    const G4String fastsim = gConfMan.Check("fastsim_mode") ? G4String(gConfMan.Get("fastsim_mode")) : G4String();
+    if (fastsim == "lut" || fastsim == "train" || fastsim == "batch")
+      G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                  "fastsim_mode assumes a single segment and cannot be used with n_segments");
+    // Closest packing: the blacksheets of neighbouring segments touch
+    // (DetectorConstruction::ConstructKVC)
+    const G4double min_pitch = 26. * mm + 2. * (Double("air_layer_thickness", 0.) * mm +
+                                                Double("wrapper_thickness", 0.) * mm + 4. * mm);
+    p.segment_pitch = Double("segment_pitch", 0.) * mm;
+    if (p.segment_pitch <= 0.) p.segment_pitch = min_pitch;
+    if (p.segment_pitch < min_pitch)
+      G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                  ("segment_pitch must be at least " + std::to_string(min_pitch / mm) + " mm").c_str());
+    if (p.n_segments * p.segment_pitch > 1. * m)
+      G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                  "n_segments x segment_pitch exceeds the 1 m world");
+
+    const G4String beam = gConfMan.Check("segment_beam") ? G4String(gConfMan.Get("segment_beam")) : G4String("split");
+    if (beam != "split" && beam != "merged")
+      G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                  "segment_beam must be split or merged");
+    p.segment_beam_merged = (beam == "merged");
+    if (p.photon_history != 0)
+      G4Exception("SimParameters::Resolve", "PhotonHistory", JustWarning,
+                  "photon_history: KVCReweight takes the global optics, seg<i>. overrides are not reweighted.");
+  }
+  for (G4int i = 0; i < p.NSegments(); ++i) {
+    const std::string qe_key = p.SegmentKey(i, "qe_scale");
+    const G4double qe_scale = Double(qe_key.c_str(), 1.);
+    if (qe_scale <= 0.)
+      G4Exception("SimParameters::Resolve", "InvalidConfValue", FatalException,
+                  (qe_key + " must be positive").c_str());
+    p.segment_qe_scale.push_back(qe_scale);
+    const std::string finish = p.SegmentKey(i, "quartz_finish");
+    p.segment_quartz_finish.push_back(gConfMan.Check(finish) ? gConfMan.GetInt(finish) : 0);
+    p.segment_beam_y_offset.push_back(Double(p.SegmentKey(i, "beam_y_offset").c_str(), 0.) * mm);
+  }
+
+  gParameters = p;
+}
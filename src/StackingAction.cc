@@ -13,16 +13,20 @@
 
 #include "G4EventManager.hh"
 #include "EventAction.hh"
+#include "BatchPropagator.hh"
+#include "CherenkovTable.hh"
 #include "KVC_TrackInfo.hh"
+#include "PhotonLUT.hh"
+#include "SimParameters.hh"
+#include "VolumeRegistry.hh"
+#include "RunMetrics.hh"
+#include "StepProfiler.hh"
+#include "G4EmProcessSubType.hh"
+#include "Randomize.hh"
 
 #include "G4SystemOfUnits.hh"      
 #include "G4PhysicalConstants.hh"  
 
-namespace
-{
-auto& gAnaMan = AnaManager::GetInstance();
-}
-
 #define DEBUG 0
 
 //_____________________________________________________________________________
@@ -39,6 +43,7 @@ StackingAction::~StackingAction()
 G4ClassificationOfNewTrack
 StackingAction::ClassifyNewTrack(const G4Track * aTrack)
 {    
+  KVC_PROFILE_NEW_TRACK(aTrack);
 
   if(aTrack->GetDefinition() == G4OpticalPhoton::OpticalPhotonDefinition()) // Focus on optical photons
   { 
@@ -46,31 +51,45 @@ StackingAction::ClassifyNewTrack(const G4Track * aTrack)
       const auto* creator = aTrack->GetCreatorProcess();
       if (!creator) return fUrgent;     
 
-      if(aTrack->GetCreatorProcess()->GetProcessName() == "Scintillation") // Scintillation photon
+      const G4int subType = creator->GetProcessSubType();
+      if(subType == fScintillation) // Scintillation photon
         ++fScintillationAll;
-      else if(aTrack->GetCreatorProcess()->GetProcessName() == "Cerenkov") { // Cerenkov photon
+      else if(subType == fCerenkov) { // Cerenkov photon
 	      ++fCerenkovAll;
 
+    // Photon thinning (photon_thinning < 1): keep a fraction f of the Cerenkov
+    // photons with weight 1/f. The generation counters still see every photon.
+    const G4double thinning = SimParameters::Get().photon_thinning;
+    const G4bool kept = (thinning >= 1.0 || G4UniformRand() < thinning);
+
 	  const G4VPhysicalVolume* volume = aTrack->GetVolume(); // Current volume of the photon
-    const bool in_quartz = (volume && volume->GetName() == "KvcPV");
+    const bool in_quartz = (VolumeRegistry::Role(volume) == VolumeRole::kRadiator);
     const G4double E = aTrack->GetKineticEnergy();
+    // fastsim_mode batch: quartz photons are propagated by BatchPropagator
+    const G4bool batched = kept && in_quartz && BatchPropagator::Enabled();
     if (in_quartz) {
       ++fCerenkovQuartz;
-      gAnaMan.AddGenWavelength((CLHEP::h_Planck * CLHEP::c_light / E) / CLHEP::nm);
+      AnaManager::GetInstance().AddGenPhoton(E);
+      if (kept && PhotonLUT::TrainingMode())
+        PhotonLUT::GetThreadTable()->RecordEmitted(aTrack->GetPosition(), aTrack->GetMomentumDirection(), E);
     }
 
-    constexpr G4double Emin = 1.37 * eV;
-    constexpr G4double Emax = 3.87 * eV;
-
-    if(in_quartz && E >= Emin && E < Emax ){
+    if(in_quartz && E >= CherenkovTable::kGenEmin && E < CherenkovTable::kGenEmax ){
       auto eventAction = static_cast<EventAction*>(
       G4EventManager::GetEventManager()->GetUserEventAction());
       if (eventAction) eventAction->AddCherenkovGen(); // Increment Cherenkov count
       
       // Tag this track as "From Quartz"
-      aTrack->SetUserInformation(new KVC_TrackInfo(true));
+      if (kept && !batched) aTrack->SetUserInformation(new KVC_TrackInfo(true));
+    }
+
+    if (!kept) return fKill;
+    if (thinning < 1.0) const_cast<G4Track*>(aTrack)->SetWeight(aTrack->GetWeight() / thinning);
+    if (batched) {
+      BatchPropagator::GetThreadInstance()->Add(aTrack);
+      RunMetrics::CountPhotonTracked();
+      return fKill;
     }
-    
   }
 
 #if DEBUG
@@ -83,8 +102,8 @@ StackingAction::ClassifyNewTrack(const G4Track * aTrack)
 #endif
         
       }
+    RunMetrics::CountPhotonTracked(); // optical photon that will be tracked
     }
-  
 	
   return fUrgent;
 }
@@ -93,14 +112,18 @@ StackingAction::ClassifyNewTrack(const G4Track * aTrack)
 //_____________________________________________________________________________
 void StackingAction::NewStage()
 {
+  // Pending batch photons are propagated before the event ends.
+  if (BatchPropagator::Enabled()) BatchPropagator::GetThreadInstance()->Flush();
+
   // G4cout << "Number of Scintillation photons produced in this event : "
   // 	 << fScintillationAll << G4endl;
   // G4cout << "Number of Cerenkov photons produced in this event : "
   // 	 << fCerenkovAll << G4endl;
   // G4cout << "Number of Cerenkov photons produced in Quartz : "
   // 	 << fCerenkovQuartz << G4endl;
-  gAnaMan.SetNumOfCerenkovAll(fCerenkovAll);
-  gAnaMan.SetNumOfCerenkovQuartz(fCerenkovQuartz);
+  auto& anaMan = AnaManager::GetInstance();
+  anaMan.SetNumOfCerenkovAll(fCerenkovAll);
+  anaMan.SetNumOfCerenkovQuartz(fCerenkovQuartz);
 }
 
 //_____________________________________________________________________________
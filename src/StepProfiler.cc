@@ -0,0 +1,248 @@
+#include "StepProfiler.hh"
+
+#ifdef KVC_INSTRUMENT
+
+#include "ConfManager.hh"
+#include "KVC_TrackInfo.hh"
+#include "MPPCHit.hh"
+#include "VolumeRegistry.hh"
+
+#include "G4AutoLock.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4VProcess.hh"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+namespace
+{
+  auto& gConfMan = ConfManager::GetInstance();
+
+  const G4int kNRoles = (G4int)VolumeRole::kNRoles;
+  const char* kRoleNames[] = { "Other", "World", "KvcPV", "KvcMotherPV", "WrapPV", "MppcPV", "BlacksheetPV" };
+
+  const char* kAllocNames[] = { "MPPCHit", "KVC_TrackInfo" };
+
+  const char* kStatusNames[] = {
+    "Undefined", "Transmission", "FresnelRefraction", "FresnelReflection",
+    "TotalInternalReflection", "LambertianReflection", "LobeReflection",
+    "SpikeReflection", "BackScattering", "Absorption", "Detection",
+    "NotAtBoundary", "SameMaterial", "StepTooSmall", "NoRINDEX"
+  };
+
+  G4String StatusName(G4int status)
+  {
+    if (status < (G4int)(sizeof(kStatusNames) / sizeof(kStatusNames[0]))) return kStatusNames[status];
+    return "status_" + std::to_string(status);
+  }
+
+  G4double Now()
+  {
+    return std::chrono::duration<G4double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Merged totals, keyed by process name (process objects are per thread).
+  struct Totals
+  {
+    std::map<G4String, G4long>   steps[kNRoles];
+    std::map<G4String, G4long>   tracks[kNRoles];
+    std::map<G4String, G4double> time[kNRoles];
+    std::map<G4int, G4long>      status[kNRoles];
+    G4long allocs[StepProfiler::kNAllocKinds] = {};
+    G4long pool_bytes[StepProfiler::kNAllocKinds] = {}; // summed over threads
+  };
+  Totals gTotals;
+  G4Mutex gProfilerMutex = G4MUTEX_INITIALIZER;
+  G4ThreadLocal StepProfiler* tProfiler = nullptr;
+}
+
+//_____________________________________________________________________________
+StepProfiler&
+StepProfiler::ThreadInstance()
+{
+  if (!tProfiler) tProfiler = new StepProfiler();
+  return *tProfiler;
+}
+
+//_____________________________________________________________________________
+StepProfiler::StepProfiler()
+  : m_steps(kNRoles), m_tracks(kNRoles), m_time(kNRoles),
+    m_status(kNRoles, std::vector<G4long>(kNStatus, 0)),
+    m_allocs{},
+    m_counter(0), m_t0(0.), m_timing(false)
+{
+}
+
+//_____________________________________________________________________________
+G4int
+StepProfiler::ProcessIndex(const G4VProcess* process)
+{
+  for (std::size_t i = 0; i < m_processes.size(); ++i)
+    if (m_processes[i] == process) return (G4int)i;
+  m_processes.push_back(process);
+  m_process_names.push_back(process ? process->GetProcessName() : G4String("none"));
+  for (G4int r = 0; r < kNRoles; ++r) {
+    m_steps[r].push_back(0);
+    m_tracks[r].push_back(0);
+    m_time[r].push_back(0.);
+  }
+  return (G4int)m_processes.size() - 1;
+}
+
+//_____________________________________________________________________________
+void
+StepProfiler::Step(const G4Step* step)
+{
+  const G4int role = (G4int)VolumeRegistry::Role(step->GetPreStepPoint()->GetPhysicalVolume());
+  const G4int proc = ProcessIndex(step->GetPostStepPoint()->GetProcessDefinedStep());
+  ++m_steps[role][proc];
+
+  // Time from the previous stepping-action call, for one step in kSampleEvery.
+  if (m_timing) {
+    m_time[role][proc] += (Now() - m_t0) * kSampleEvery;
+    m_timing = false;
+  }
+  if (++m_counter % kSampleEvery == 0) {
+    m_t0 = Now();
+    m_timing = true;
+  }
+}
+
+//_____________________________________________________________________________
+void
+StepProfiler::Boundary(const G4Step* step, G4OpBoundaryProcessStatus status)
+{
+  const G4int role = (G4int)VolumeRegistry::Role(step->GetPreStepPoint()->GetPhysicalVolume());
+  const G4int s = ((G4int)status < kNStatus) ? (G4int)status : kNStatus - 1;
+  ++m_status[role][s];
+}
+
+//_____________________________________________________________________________
+void
+StepProfiler::NewTrack(const G4Track* track)
+{
+  const G4int role = (G4int)VolumeRegistry::Role(track->GetVolume());
+  ++m_tracks[role][ProcessIndex(track->GetCreatorProcess())];
+}
+
+//_____________________________________________________________________________
+void
+StepProfiler::Reset()
+{
+  G4AutoLock lock(&gProfilerMutex);
+  gTotals = Totals();
+}
+
+//_____________________________________________________________________________
+void
+StepProfiler::MergeThread()
+{
+  auto& p = ThreadInstance();
+  G4AutoLock lock(&gProfilerMutex);
+  for (G4int r = 0; r < kNRoles; ++r) {
+    for (std::size_t i = 0; i < p.m_processes.size(); ++i) {
+      // The steps map holds the keys the report iterates over.
+      const auto& name = p.m_process_names[i];
+      if (p.m_steps[r][i] || p.m_tracks[r][i]) {
+        gTotals.steps[r][name]  += p.m_steps[r][i];
+        gTotals.tracks[r][name] += p.m_tracks[r][i];
+        gTotals.time[r][name]   += p.m_time[r][i];
+      }
+      p.m_steps[r][i] = p.m_tracks[r][i] = 0;
+      p.m_time[r][i] = 0.;
+    }
+    for (G4int s = 0; s < kNStatus; ++s) {
+      if (p.m_status[r][s]) gTotals.status[r][s] += p.m_status[r][s];
+      p.m_status[r][s] = 0;
+    }
+  }
+  for (G4int k = 0; k < kNAllocKinds; ++k) {
+    gTotals.allocs[k] += p.m_allocs[k];
+    p.m_allocs[k] = 0;
+  }
+  // Pools keep their pages for the next run: this is their high-water mark.
+  if (MPPCHitAllocator)       gTotals.pool_bytes[kAllocHit]       += MPPCHitAllocator->GetAllocatedSize();
+  if (KVC_TrackInfoAllocator) gTotals.pool_bytes[kAllocTrackInfo] += KVC_TrackInfoAllocator->GetAllocatedSize();
+  p.m_timing = false;
+}
+
+//_____________________________________________________________________________
+void
+StepProfiler::Report()
+{
+  G4AutoLock lock(&gProfilerMutex);
+
+  // Table (G4cout formatting is restored afterwards)
+  const std::ios::fmtflags flags = G4cout.flags();
+  const std::streamsize precision = G4cout.precision();
+  G4cout << "=== Step profile (time sampled 1/" << kSampleEvery << " steps) ===" << G4endl;
+  G4cout << std::left << std::setw(14) << "volume" << std::setw(22) << "process"
+         << std::right << std::setw(14) << "steps" << std::setw(12) << "time[s]"
+         << std::setw(12) << "tracks" << G4endl;
+  for (G4int r = 0; r < kNRoles; ++r) {
+    for (const auto& entry : gTotals.steps[r]) {
+      G4cout << std::left << std::setw(14) << kRoleNames[r] << std::setw(22) << entry.first
+             << std::right << std::setw(14) << entry.second
+             << std::setw(12) << std::setprecision(4) << gTotals.time[r][entry.first]
+             << std::setw(12) << gTotals.tracks[r][entry.first] << G4endl;
+    }
+  }
+  G4cout << "--- Optical boundary status ---" << G4endl;
+  for (G4int r = 0; r < kNRoles; ++r) {
+    for (const auto& entry : gTotals.status[r]) {
+      G4cout << std::left << std::setw(14) << kRoleNames[r] << std::setw(26) << StatusName(entry.first)
+             << std::right << std::setw(14) << entry.second << G4endl;
+    }
+  }
+
+  G4cout << "--- Pool allocations ---" << G4endl;
+  for (G4int k = 0; k < kNAllocKinds; ++k) {
+    G4cout << std::left << std::setw(14) << kAllocNames[k]
+           << std::right << std::setw(14) << gTotals.allocs[k] << " objects"
+           << std::setw(12) << gTotals.pool_bytes[k] / 1024 << " kB pooled" << G4endl;
+  }
+  G4cout.flags(flags);
+  G4cout.precision(precision);
+
+  // JSON
+  const G4String path = gConfMan.Check("profile_file") ? G4String(gConfMan.Get("profile_file"))
+                                                       : G4String("kvc_profile.json");
+  std::ofstream out(path);
+  if (!out) {
+    G4cerr << "Warning: cannot write profile file " << path << G4endl;
+    return;
+  }
+  out << "{\n  \"sample_every\": " << kSampleEvery << ",\n  \"volumes\": {";
+  G4bool first_role = true;
+  for (G4int r = 0; r < kNRoles; ++r) {
+    if (gTotals.steps[r].empty() && gTotals.status[r].empty() && gTotals.tracks[r].empty()) continue;
+    out << (first_role ? "" : ",") << "\n    \"" << kRoleNames[r] << "\": {\n      \"processes\": {";
+    first_role = false;
+    G4bool first = true;
+    for (const auto& entry : gTotals.steps[r]) {
+      out << (first ? "" : ",") << "\n        \"" << entry.first << "\": { \"steps\": " << entry.second
+          << ", \"time_s\": " << gTotals.time[r][entry.first]
+          << ", \"new_tracks\": " << gTotals.tracks[r][entry.first] << " }";
+      first = false;
+    }
+    out << "\n      },\n      \"boundary_status\": {";
+    first = true;
+    for (const auto& entry : gTotals.status[r]) {
+      out << (first ? "" : ",") << "\n        \"" << StatusName(entry.first) << "\": " << entry.second;
+      first = false;
+    }
+    out << "\n      }\n    }";
+  }
+  out << "\n  },\n  \"allocations\": {";
+  for (G4int k = 0; k < kNAllocKinds; ++k) {
+    out << (k ? "," : "") << "\n    \"" << kAllocNames[k] << "\": { \"objects\": " << gTotals.allocs[k]
+        << ", \"pool_bytes\": " << gTotals.pool_bytes[k] << " }";
+  }
+  out << "\n  }\n}\n";
+  G4cout << "Step profile written to " << path << G4endl;
+}
+
+#endif
@@ -16,16 +16,79 @@
 #include "AnaManager.hh"
 #include "KVC_TrackInfo.hh"
 #include "ConfManager.hh"
+#include "SimParameters.hh"
+#include "VolumeRegistry.hh"
+#include "RunMetrics.hh"
+#include "StepProfiler.hh"
+#include "PhotonHistory.hh"
+#include "CherenkovTable.hh"
+#include "PhotonLUT.hh"
 #include "G4EventManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
 #include "G4LogicalSkinSurface.hh"
 #include "G4OpticalSurface.hh"
-#include "G4PhysicalVolumeStore.hh"
-#include "G4VPhysicalVolume.hh"
+#include "G4Box.hh"
+#include "G4Material.hh"
+
+#include <algorithm>
+#include <cmath>
 
 #define KVC_DEBUG_STEPPING 0
 
+namespace
+{
+  // Surface whose REFLECTIVITY is tried at a boundary between two roles
+  // (DetectorConstruction: surface_quartz between quartz and air, the
+  // wrapper surface on either side of the wrapper).
+  enum class HistorySurface { kNone, kQuartz, kWrapper };
+
+  HistorySurface SurfaceBetween(VolumeRole a, VolumeRole b)
+  {
+    auto pair = [&](VolumeRole x, VolumeRole y) {
+      return (a == x && b == y) || (a == y && b == x);
+    };
+    if (pair(VolumeRole::kRadiator, VolumeRole::kAirGap))  return HistorySurface::kQuartz;
+    if (pair(VolumeRole::kAirGap, VolumeRole::kWrapper) ||
+        pair(VolumeRole::kRadiator, VolumeRole::kWrapper)) return HistorySurface::kWrapper;
+    return HistorySurface::kNone;
+  }
+
+  // Boundary statuses reached only after the REFLECTIVITY trial was passed
+  G4bool SurvivedSurface(G4OpBoundaryProcessStatus status)
+  {
+    switch (status) {
+      case Undefined:
+      case NotAtBoundary:
+      case SameMaterial:
+      case StepTooSmall:
+      case NoRINDEX:
+      case Absorption:
+        return false;
+      default:
+        return true;
+    }
+  }
+
+#ifdef USE_SURFACE_PDE
+  // Method A detects only on MPPCs with an EFFICIENCY skin surface
+  // (checked once per thread, in CacheGeometry)
+  G4bool HasSurfaceEfficiency(const G4LogicalVolume* lv)
+  {
+    const G4LogicalSkinSurface* skin = G4LogicalSkinSurface::GetSurface(lv);
+    auto surface = skin ? dynamic_cast<const G4OpticalSurface*>(skin->GetSurfaceProperty()) : nullptr;
+    auto mpt = surface ? surface->GetMaterialPropertiesTable() : nullptr;
+    return mpt && mpt->GetProperty(kEFFICIENCY);
+  }
+#endif
+}
+
 SteppingAction::SteppingAction() 
-  : fOpProcess(nullptr), fAirVol(nullptr), fWrapVol(nullptr) 
+  : fOpProcess(nullptr), fMppcCollID(-1),
+    fGeometryCached(false), fGeometryOK(false), fBlacksheetRule(false), fAirGap(false)
+#ifdef USE_SURFACE_PDE
+    , fMppcEfficiency(false)
+#endif
 {
 }
 
@@ -34,16 +97,33 @@ SteppingAction::~SteppingAction()
 
 void SteppingAction::UserSteppingAction(const G4Step* step)
 {
+  KVC_PROFILE_STEP(step);
   G4Track* track = step->GetTrack();
   if(track->GetDefinition() != G4OpticalPhoton::OpticalPhotonDefinition()) return;
+  RunMetrics::CountOpticalStep();
+  const SimParameters& params = SimParameters::Get();
 
-  // Cache physical volume pointers once (Pointer comparison is MUCH faster than string comparison)
-  if(!fAirVol) {
-      auto pvStore = G4PhysicalVolumeStore::GetInstance();
-      fAirVol  = pvStore->GetVolume("KvcMotherPV", false);
-      fWrapVol = pvStore->GetVolume("WrapPV", false);
+  // Russian roulette for long-lived (trapped) photons: each time the track
+  // length crosses a multiple of roulette_length the photon survives with
+  // probability p and its weight is divided by p.
+  if (params.roulette_length > 0. && track->GetTrackStatus() != fStopAndKill) {
+    const G4double length = track->GetTrackLength();
+    const G4int n_now  = (G4int)(length / params.roulette_length);
+    const G4int n_prev = (G4int)((length - step->GetStepLength()) / params.roulette_length);
+    if (n_now > n_prev) {
+      if (G4UniformRand() >= params.roulette_survival) {
+        track->SetTrackStatus(fStopAndKill);
+        if (params.photon_history != 0) EndHistory(track, PhotonHistory::kKilled);
+        CountTrapped(step);
+        return;
+      }
+      track->SetWeight(track->GetWeight() / params.roulette_survival);
+    }
   }
 
+  // Box sizes for the kill oracle (volume roles come from VolumeRegistry)
+  if(!fGeometryCached) CacheGeometry();
+
   // Retrieve OpBoundaryProcess if not cached
   if(!fOpProcess){
     G4ProcessManager* pm = track->GetDefinition()->GetProcessManager();
@@ -60,6 +140,7 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
   if(!fOpProcess) return;
 
   G4OpBoundaryProcessStatus status = fOpProcess->GetStatus();
+  KVC_PROFILE_BOUNDARY(step, status);
   G4bool detected = false;
 
 #ifdef USE_SURFACE_PDE
@@ -70,24 +151,12 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
       // Check if it entered MPPC
       G4TouchableHandle touchable = step->GetPostStepPoint()->GetTouchableHandle();
       auto vol = touchable->GetVolume();
-      if(vol && G4StrUtil::contains(vol->GetName(), "Mppc")){
-          const G4LogicalSkinSurface* surf = G4LogicalSkinSurface::GetSurface(vol->GetLogicalVolume());
-          if(surf) {
-            G4SurfaceProperty* prop = const_cast<G4SurfaceProperty*>(surf->GetSurfaceProperty());
-            G4OpticalSurface* optSurf = dynamic_cast<G4OpticalSurface*>(prop);
-            if(optSurf){
-                G4MaterialPropertiesTable* MPT = optSurf->GetMaterialPropertiesTable();
-                if(MPT && MPT->GetProperty("EFFICIENCY")){
-                    G4double energy = track->GetTotalEnergy();
-                    G4double eff = MPT->GetProperty("EFFICIENCY")->Value(energy); 
-                    G4double qe_scale = ConfManager::GetInstance().GetDouble("qe_scale");
-                    G4double prob = eff * qe_scale;
-                    if(prob > 1.0) prob = 1.0; 
-                    if(G4UniformRand() < prob) {
-                        detected = true;
-                    }
-                }
-            }
+      if(fMppcEfficiency && VolumeRegistry::Role(vol) == VolumeRole::kMppc){
+          // The surface EFFICIENCY already carries qe_scale and this path has
+          // always applied it once more; the table keeps both factors.
+          fPDE.SetScale(params.qe_scale * params.qe_scale);
+          if(G4UniformRand() < fPDE.Value(track->GetTotalEnergy())) {
+              detected = true;
           }
       }
   }
@@ -114,18 +183,35 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
     aHit->SetTime(hitTime);
     aHit->SetParticleID(track->GetDefinition()->GetPDGEncoding());
     aHit->SetCopyNumber(copyNumber);
+    aHit->SetSegment(touchable->GetCopyNumber(1));
     aHit->SetEventID(eventID);
     aHit->SetDetectFlag(1); // Detected!
+    aHit->SetWeight(track->GetWeight());
+
+    if (params.photon_history != 0) {
+      auto info = static_cast<KVC_TrackInfo*>(track->GetUserInformation());
+      if (info) info->SetArrival(copyNumber, -1., true);
+    }
+
+    // Training run for the lookup-table fast simulation (Method A detects
+    // here, not in MPPCSD)
+    if (PhotonLUT::TrainingMode()) {
+      auto info = static_cast<KVC_TrackInfo*>(track->GetUserInformation());
+      if (info && info->IsFromQuartz())
+        PhotonLUT::GetThreadTable()->RecordDetected(track->GetVertexPosition(),
+                                                    track->GetVertexMomentumDirection(),
+                                                    track->GetVertexKineticEnergy(),
+                                                    copyNumber, postStepPoint->GetLocalTime());
+    }
 
     // Add to Collection
     auto HCTE = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetHCofThisEvent();
     if(HCTE){
-       static G4int collID = -1;
-       if(collID < 0) {
-         collID = G4SDManager::GetSDMpointer()->GetCollectionID("MppcCollection");
+       if(fMppcCollID < 0) {
+         fMppcCollID = G4SDManager::GetSDMpointer()->GetCollectionID("MppcCollection");
        }
-       if(collID >= 0){
-          auto hitsCollection = (G4THitsCollection<MPPCHit>*)(HCTE->GetHC(collID));
+       if(fMppcCollID >= 0){
+          auto hitsCollection = (G4THitsCollection<MPPCHit>*)(HCTE->GetHC(fMppcCollID));
           if(hitsCollection) hitsCollection->insert(aHit);
           else delete aHit;
        } else delete aHit;
@@ -135,16 +221,226 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
     track->SetTrackStatus(fStopAndKill);
   }
 
-  // --- Monitoring Logics ---
-  // A photon is "trapped/lost" if it is KILLED in the Air or Wrap volumes, but NOT detected.
-  // We ONLY count photons that were born in Quartz (checked via TrackInfo).
-  if (!detected && track->GetTrackStatus() == fStopAndKill) {
-      auto info = static_cast<KVC_TrackInfo*>(track->GetUserInformation());
-      if (info && info->IsFromQuartz()) {
-          G4VPhysicalVolume* preVol = step->GetPreStepPoint()->GetPhysicalVolume();
-          if(preVol == fAirVol || preVol == fWrapVol) {
-              AnaManager::GetInstance().IncrementTrappedAir();
+  // --- Kill Oracle ---
+  // Stop photons that provably cannot reach an MPPC any more. Photons killed
+  // in the air still count as trapped below, as they would have without it.
+  G4bool oracle_killed = false;
+  if (params.kill_oracle && fGeometryOK && !detected && track->GetTrackStatus() == fAlive) {
+      G4double prob_bound = 0.;
+      KillReason reason = KillUndetectable(step, status, prob_bound);
+      // A non-zero bound (kill_epsilon > 0) is a roulette: the photon survives
+      // with probability prob_bound / kill_epsilon and its weight is divided
+      // by that, so npe_weighted stays unbiased.
+      if (reason != kNotKilled && prob_bound > 0.) {
+          const G4double survival = prob_bound / params.kill_epsilon;
+          if (G4UniformRand() < survival) {
+              track->SetWeight(track->GetWeight() / survival);
+              reason = kNotKilled;
           }
       }
+      if (reason != kNotKilled) {
+          track->SetTrackStatus(fStopAndKill);
+          AnaManager::GetInstance().IncrementOracleKill(reason == kKillBlacksheet, track->GetWeight() * prob_bound);
+          oracle_killed = true;
+      }
+  }
+
+  // --- Photon History ---
+  if (params.photon_history != 0) UpdateHistory(step, status, oracle_killed);
+
+  // --- Monitoring Logics ---
+  if (!detected && track->GetTrackStatus() == fStopAndKill) CountTrapped(step);
+}
+
+//_____________________________________________________________________________
+// A photon is "trapped/lost" if it is KILLED in the Air or Wrap volumes, but NOT detected.
+// We ONLY count photons that were born in Quartz (checked via TrackInfo).
+void SteppingAction::CountTrapped(const G4Step* step)
+{
+  auto info = static_cast<KVC_TrackInfo*>(step->GetTrack()->GetUserInformation());
+  if (info && info->IsFromQuartz()) {
+      const VolumeRole preRole = VolumeRegistry::Role(step->GetPreStepPoint()->GetPhysicalVolume());
+      if(preRole == VolumeRole::kAirGap || preRole == VolumeRole::kWrapper) {
+          AnaManager::GetInstance().IncrementTrappedAir();
+      }
+  }
+}
+
+//_____________________________________________________________________________
+// Photon history of quartz-born photons: surface interactions and quartz path
+// along the track, fate at its end. The MPPC reached and the PDE trial come
+// from MPPCSD (Method B), which runs before this action.
+void SteppingAction::UpdateHistory(const G4Step* step, G4OpBoundaryProcessStatus status,
+                                   G4bool oracle_killed)
+{
+  G4Track* track = step->GetTrack();
+  auto info = static_cast<KVC_TrackInfo*>(track->GetUserInformation());
+  if (!info || !info->IsFromQuartz()) return;
+
+  const G4StepPoint* post = step->GetPostStepPoint();
+  const VolumeRole preRole = VolumeRegistry::Role(step->GetPreStepPoint()->GetPhysicalVolume());
+  if (preRole == VolumeRole::kRadiator) info->AddQuartzPath(step->GetStepLength());
+
+  HistorySurface surface = HistorySurface::kNone;
+  if (post->GetStepStatus() == fGeomBoundary) {
+    surface = SurfaceBetween(preRole, VolumeRegistry::Role(post->GetPhysicalVolume()));
+    if (surface == HistorySurface::kQuartz && SurvivedSurface(status))  info->AddQuartzBounce();
+    if (surface == HistorySurface::kWrapper && SurvivedSurface(status)) info->AddWrapperBounce();
+  }
+
+  if (track->GetTrackStatus() != fStopAndKill) return;
+
+  G4int fate = PhotonHistory::kLost;
+  const G4VProcess* process = post->GetProcessDefinedStep();
+  if (info->Arrived())
+    fate = info->Detected() ? PhotonHistory::kDetected : PhotonHistory::kMissed;
+  else if (oracle_killed)
+    fate = PhotonHistory::kKilled;
+  else if (status == Absorption && surface == HistorySurface::kQuartz)
+    fate = PhotonHistory::kQuartzSurface;
+  else if (status == Absorption && surface == HistorySurface::kWrapper)
+    fate = PhotonHistory::kWrapperSurface;
+  else if (preRole == VolumeRole::kRadiator && process && process->GetProcessName() == "OpAbsorption")
+    fate = PhotonHistory::kBulkAbsorbed;
+  EndHistory(track, fate);
+}
+
+//_____________________________________________________________________________
+void SteppingAction::EndHistory(const G4Track* track, G4int fate)
+{
+  auto info = static_cast<KVC_TrackInfo*>(track->GetUserInformation());
+  if (!info || !info->IsFromQuartz()) return;
+  const G4bool arrived = (fate == PhotonHistory::kDetected || fate == PhotonHistory::kMissed);
+  if (SimParameters::Get().photon_history == PhotonHistory::kArrivals && !arrived) return;
+
+  // Optical depth for the current ABSLENGTH (looked up here: sweeps replace
+  // the property vector between runs).
+  const G4double energy = track->GetTotalEnergy();
+  G4double abs_depth = 0.;
+  if (auto kvc_pv = VolumeRegistry::Volume(VolumeRole::kRadiator)) {
+    auto mpt = kvc_pv->GetLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
+    auto abslength = mpt ? mpt->GetProperty(kABSLENGTH) : nullptr;
+    if (abslength) abs_depth = info->GetQuartzPath() / abslength->Value(energy);
+  }
+
+  AnaManager::GetInstance().AddPhotonHistory(CherenkovTable::Wavelength(energy),
+                                             info->GetQuartzPath() / mm, abs_depth,
+                                             arrived ? info->GetArrivalPDE() : 0.,
+                                             track->GetWeight(),
+                                             info->GetNQuartz(), info->GetNWrapper(), fate,
+                                             arrived ? info->GetArrivalSeg() : -1);
+}
+
+//_____________________________________________________________________________
+void SteppingAction::CacheGeometry()
+{
+  fGeometryCached = true;
+  auto kvc_pv  = VolumeRegistry::Volume(VolumeRole::kRadiator);
+  auto mppc_pv = VolumeRegistry::Volume(VolumeRole::kMppc);
+#ifdef USE_SURFACE_PDE
+  // All MPPC copies share MppcLV and its skin surface
+  fMppcEfficiency = mppc_pv && HasSurfaceEfficiency(mppc_pv->GetLogicalVolume());
+#endif
+
+  // Box geometry as built in DetectorConstruction::ConstructKVC. KvcPV, WrapPV
+  // and the blacksheet are all centred on the origin of KvcMotherPV.
+  auto kvc_box  = kvc_pv  ? dynamic_cast<G4Box*>(kvc_pv->GetLogicalVolume()->GetSolid())  : nullptr;
+  auto mppc_box = mppc_pv ? dynamic_cast<G4Box*>(mppc_pv->GetLogicalVolume()->GetSolid()) : nullptr;
+  if (!kvc_box || !mppc_box || !VolumeRegistry::Volume(VolumeRole::kAirGap)) {
+    G4Exception("SteppingAction::CacheGeometry", "KillOracle", JustWarning,
+                "KVC geometry not found, kill oracle disabled.");
+    return;
+  }
+  fGeometryOK = true;
+
+  auto& confMan = ConfManager::GetInstance();
+  const G4double air_layer = confMan.GetDouble("air_layer_thickness") * mm;
+  const G4double wrapper   = confMan.GetDouble("wrapper_thickness") * mm;
+  fKvcHalf = G4ThreeVector(kvc_box->GetXHalfLength(), kvc_box->GetYHalfLength(), kvc_box->GetZHalfLength());
+  // MPPCs are rotated by 90 deg about X and sit on the +-Y faces.
+  fInnerHalf = G4ThreeVector(fKvcHalf.x() + air_layer + wrapper,
+                             fKvcHalf.y() + 2. * mppc_box->GetZHalfLength(),
+                             fKvcHalf.z() + air_layer + wrapper);
+
+  fBlacksheetRule = (*std::max_element(KVC_Optical::R_Blacksheet_REFLECTIVITY.begin(),
+                                       KVC_Optical::R_Blacksheet_REFLECTIVITY.end()) == 0.);
+  // Total internal reflection keeps |d| components only at a quartz/air
+  // boundary, and only when it is polished (checked per step, see below).
+  fAirGap = (air_layer > 0.);
+}
+
+//_____________________________________________________________________________
+SteppingAction::KillReason
+SteppingAction::KillUndetectable(const G4Step* step, G4OpBoundaryProcessStatus status,
+                                 G4double& prob_bound)
+{
+  prob_bound = 0.;
+  const G4StepPoint* pre  = step->GetPreStepPoint();
+  const G4StepPoint* post = step->GetPostStepPoint();
+
+  // Volume the photon is in after this step: the next one only if it was
+  // transmitted through the boundary, otherwise (reflection) the current one.
+  const G4bool transmitted = (status == FresnelRefraction || status == Transmission);
+  const G4StepPoint* where = (transmitted || pre->GetPhysicalVolume() == post->GetPhysicalVolume()) ? post : pre;
+  const VolumeRole role = VolumeRegistry::Role(where->GetPhysicalVolume());
+
+  // Mother-frame position and direction (see CacheGeometry).
+  const G4AffineTransform& toLocal = where->GetTouchable()->GetHistory()->GetTopTransform();
+  const G4ThreeVector p = toLocal.TransformPoint(post->GetPosition());
+  const G4ThreeVector d = toLocal.TransformAxis(post->GetMomentumDirection());
+
+  // (1) In the air outside the wrapper/MPPC bounding box and heading away
+  //     from it: the only thing left on this straight line is the blacksheet
+  //     (reflectivity 0) or the world boundary.
+  if (fBlacksheetRule && role == VolumeRole::kAirGap) {
+    G4double tmin = 0., tmax = DBL_MAX;
+    for (G4int i = 0; i < 3; ++i) {
+      if (d[i] == 0.) {
+        if (std::abs(p[i]) > fInnerHalf[i]) return kKillBlacksheet;
+        continue;
+      }
+      G4double t1 = (-fInnerHalf[i] - p[i]) / d[i];
+      G4double t2 = ( fInnerHalf[i] - p[i]) / d[i];
+      if (t1 > t2) std::swap(t1, t2);
+      tmin = std::max(tmin, t1);
+      tmax = std::min(tmax, t2);
+      if (tmin > tmax) return kKillBlacksheet;
+    }
+    return kNotKilled;
   }
+
+  // (2) In polished quartz with total internal reflection on both the X and Z
+  //     faces: |dy| is conserved and the photon must cover the distance to a
+  //     Y face (where the MPPCs are) inside the quartz. The bulk attenuation
+  //     over that path bounds the detection probability.
+  // Finish 0: the unified model ignores sigma_alpha for polished surfaces.
+  // The finish is that of the segment (copy number of the KvcMotherPV).
+  const auto& finish = SimParameters::Get().segment_quartz_finish;
+  const G4int segment = (role == VolumeRole::kRadiator) ? where->GetTouchable()->GetCopyNumber(1) : 0;
+  const G4bool polished = (segment >= 0 && segment < (G4int)finish.size()) ? finish[segment] == 0
+                                                                          : SimParameters::Get().quartz_finish == 0;
+  if (fAirGap && polished && role == VolumeRole::kRadiator) {
+    const G4double energy = step->GetTrack()->GetTotalEnergy();
+    auto quartz_mpt = where->GetMaterial()->GetMaterialPropertiesTable();
+    auto air_mpt    = VolumeRegistry::Volume(VolumeRole::kAirGap)->GetLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
+    if (!quartz_mpt || !air_mpt) return kNotKilled;
+    auto rindex_q = quartz_mpt->GetProperty(kRINDEX);
+    auto rindex_a = air_mpt->GetProperty(kRINDEX);
+    if (!rindex_q || !rindex_a) return kNotKilled;
+
+    const G4double ratio = rindex_a->Value(energy) / rindex_q->Value(energy);
+    const G4double sin2_crit = ratio * ratio;
+    if (1. - d.x() * d.x() <= sin2_crit) return kNotKilled; // escapes through an X face
+    if (1. - d.z() * d.z() <= sin2_crit) return kNotKilled; // escapes through a Z face
+
+    if (d.y() != 0.) {
+      auto abslength = quartz_mpt->GetProperty(kABSLENGTH);
+      if (!abslength) return kNotKilled;
+      const G4double dist = (d.y() > 0. ? fKvcHalf.y() - p.y() : fKvcHalf.y() + p.y()) / std::abs(d.y());
+      prob_bound = std::exp(-dist / abslength->Value(energy));
+    }
+    if (prob_bound <= SimParameters::Get().kill_epsilon) return kKillTrapped;
+  }
+
+  return kNotKilled;
 }
@@ -0,0 +1,22 @@
+#include "TrackingAction.hh"
+#include "EventSeeder.hh"
+
+#include "G4Track.hh"
+
+//_____________________________________________________________________________
+TrackingAction::TrackingAction()
+  : G4UserTrackingAction()
+{
+}
+
+//_____________________________________________________________________________
+TrackingAction::~TrackingAction()
+{
+}
+
+//_____________________________________________________________________________
+void
+TrackingAction::PreUserTrackingAction(const G4Track* track)
+{
+  EventSeeder::SeedTrack(track->GetTrackID());
+}
@@ -0,0 +1,56 @@
+#include "VolumeRegistry.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4PhysicalVolumeStore.hh"
+
+std::vector<VolumeRole> VolumeRegistry::s_roles;
+G4VPhysicalVolume* VolumeRegistry::s_volumes[(G4int)VolumeRole::kNRoles] = {};
+
+namespace
+{
+  // Logical-volume names given in DetectorConstruction.
+  struct RoleName
+  {
+    const char* name;
+    VolumeRole role;
+  };
+
+  const RoleName kRoleNames[] = {
+    { "World",        VolumeRole::kWorld      },
+    { "KvcLV",        VolumeRole::kRadiator   },
+    { "KvcMotherLV",  VolumeRole::kAirGap     },
+    { "WrapLV",       VolumeRole::kWrapper    },
+    { "MppcLV",       VolumeRole::kMppc       },
+    { "BlacksheetLV", VolumeRole::kBlacksheet },
+  };
+}
+
+//_____________________________________________________________________________
+void
+VolumeRegistry::Build()
+{
+  s_roles.clear();
+  for (auto& pv : s_volumes) pv = nullptr;
+
+  for (const auto lv : *G4LogicalVolumeStore::GetInstance()) {
+    for (const auto& entry : kRoleNames) {
+      if (lv->GetName() != entry.name) continue;
+      const std::size_t id = lv->GetInstanceID();
+      if (id >= s_roles.size()) s_roles.resize(id + 1, VolumeRole::kOther);
+      s_roles[id] = entry.role;
+    }
+  }
+
+  for (const auto pv : *G4PhysicalVolumeStore::GetInstance()) {
+    const VolumeRole role = Role(pv);
+    if (role != VolumeRole::kOther && !s_volumes[(G4int)role])
+      s_volumes[(G4int)role] = pv;
+  }
+}
+
+//_____________________________________________________________________________
+G4VPhysicalVolume*
+VolumeRegistry::Volume(VolumeRole role)
+{
+  return s_volumes[(G4int)role];
+}
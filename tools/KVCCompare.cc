@@ -0,0 +1,124 @@
+// KVCCompare: compares the distributions of two KVCOpticalSim outputs, e.g.
+// full Geant4 tracking against fastsim_mode batch or lut with the same conf
+// and seed.
+//
+//   KVCCompare <reference rootfile> <test rootfile> [<expression> ...]
+//
+// Every expression (default: npe_weighted and the hit time) is evaluated on
+// both trees with TTree::Draw, so vector branches contribute one value per
+// hit. For each one the means are compared (difference in standard errors)
+// and the shapes with an unbinned Kolmogorov-Smirnov test. The exit code is 1
+// when a mean differs by more than 3 standard errors or a KS probability is
+// below 0.001. Only output_mode tree files can be compared; an RNTuple
+// (output_mode ntuple) is refused.
+
+#include "TFile.h"
+#include "TKey.h"
+#include "TMath.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const Double_t kMaxPull = 3.;
+  const Double_t kMinKSProb = 1.e-3;
+
+  struct Sample
+  {
+    std::vector<Double_t> values;
+    Double_t mean = 0.;
+    Double_t rms = 0.;
+  };
+
+  Bool_t Fill(TTree* tree, const std::string& expression, Sample& sample)
+  {
+    tree->SetEstimate(-1);
+    const Long64_t n = tree->Draw(expression.c_str(), "", "goff");
+    if (n < 0) return false;
+    const Double_t* v = tree->GetV1();
+    sample.values.assign(v, v + n);
+    std::sort(sample.values.begin(), sample.values.end());
+    Double_t sum = 0., sum2 = 0.;
+    for (auto x : sample.values) {
+      sum += x;
+      sum2 += x * x;
+    }
+    if (n > 0) {
+      sample.mean = sum / n;
+      const Double_t var = sum2 / n - sample.mean * sample.mean;
+      sample.rms = var > 0. ? std::sqrt(var) : 0.;
+    }
+    return true;
+  }
+
+  TTree* OpenTree(const char* path, TFile*& file)
+  {
+    file = TFile::Open(path, "READ");
+    if (!file || file->IsZombie()) {
+      std::cerr << "Error: cannot open " << path << std::endl;
+      return nullptr;
+    }
+    TKey* key = file->GetKey("tree");
+    if (key && std::string(key->GetClassName()) != "TTree") {
+      std::cerr << "Error: " << path << " holds a " << key->GetClassName()
+                << " (output_mode ntuple); KVCCompare reads output_mode tree only" << std::endl;
+      return nullptr;
+    }
+    TTree* tree = file->Get<TTree>("tree");
+    if (!tree) std::cerr << "Error: no tree in " << path << " (tree output required)" << std::endl;
+    return tree;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    std::cerr << " Usage: " << std::endl
+              << " KVCCompare <reference rootfile> <test rootfile> [<expression> ...]" << std::endl;
+    return 1;
+  }
+
+  TFile* ref_file = nullptr;
+  TFile* test_file = nullptr;
+  TTree* ref = OpenTree(argv[1], ref_file);
+  TTree* test = OpenTree(argv[2], test_file);
+  if (!ref || !test) return 1;
+
+  std::vector<std::string> expressions(argv + 3, argv + argc);
+  if (expressions.empty()) expressions = { "npe_weighted", "time" };
+
+  Bool_t ok = true;
+  std::printf("%-16s %12s %12s %12s %12s %8s %10s\n",
+              "expression", "ref mean", "test mean", "ref rms", "test rms", "pull", "KS prob");
+  for (const auto& expression : expressions) {
+    Sample a, b;
+    if (!Fill(ref, expression, a) || !Fill(test, expression, b)) {
+      std::cout << expression << ": cannot be evaluated, skipped" << std::endl;
+      continue;
+    }
+    if (a.values.empty() || b.values.empty()) {
+      std::cout << expression << ": no entries, skipped" << std::endl;
+      continue;
+    }
+    const Double_t na = a.values.size(), nb = b.values.size();
+    const Double_t error = std::sqrt(a.rms * a.rms / na + b.rms * b.rms / nb);
+    const Double_t pull = error > 0. ? (b.mean - a.mean) / error : 0.;
+    const Double_t prob = TMath::KolmogorovTest((Int_t)na, a.values.data(),
+                                                (Int_t)nb, b.values.data(), "");
+    std::printf("%-16s %12.5g %12.5g %12.5g %12.5g %8.2f %10.3g\n", expression.c_str(),
+                a.mean, b.mean, a.rms, b.rms, pull, prob);
+    if (std::fabs(pull) > kMaxPull || prob < kMinKSProb) ok = false;
+  }
+
+  delete ref_file;
+  delete test_file;
+  if (!ok) std::cout << "KVCCompare: distributions differ (|pull| > " << kMaxPull
+                     << " or KS probability < " << kMinKSProb << ")" << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+// KVCMerge: combines the outputs of split KVCOpticalSim jobs
+// (--job-index/--n-jobs or --first-event/--n-events) into one file.
+//
+//   KVCMerge <merged rootfile> <job rootfile> [<job rootfile> ...]
+//
+// Before merging, the run metadata written by OutputWriter is checked: all
+// jobs must share master_seed and run_id, and their event ranges
+// (first_event, n_events) must tile one contiguous range. In tree mode the
+// event_id branch (when written) must hold every event of each range
+// exactly once; in hist mode the event count of npe_stats must match
+// n_events. Nothing is written if any check fails.
+//
+// The run configuration stored with the metadata (e.g. the optics of a
+// photon-history run, the segment layout) must be identical in all jobs.
+//
+// Trees are concatenated and histograms (output_mode hist) are added. The
+// merged file gets the combined metadata and npe_stats, and the run
+// configuration once. RNTuple files (output_mode ntuple) are refused.
+
+#include "TFile.h"
+#include "TFileMerger.h"
+#include "TKey.h"
+#include "TParameter.h"
+#include "TTree.h"
+#include "TVectorD.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+  // Run configuration parameters (OutputWriter::WriteRunInfo), written only
+  // when the corresponding option is used. TFileMerger would add them.
+  struct ConfigParameter
+  {
+    const char* name;
+    Bool_t integer;
+  };
+  const ConfigParameter kConfigParameters[] = {
+    { "photon_history",               true  },
+    { "teflon_reflectivity_scale",    false },
+    { "quartz_boundary_reflectivity", false },
+    { "quartz_abs_scale",             false },
+    { "qe_scale",                     false },
+    { "n_segments",                   true  },
+    { "segment_pitch",                false },
+  };
+
+  struct JobInfo
+  {
+    std::string path;
+    Long64_t master_seed = 0;
+    Int_t run_id = 0;
+    Int_t first_event = 0;
+    Int_t n_events = 0;
+    Bool_t has_tree = false;
+    Bool_t has_stats = false;
+    Double_t stats[3] = { 0., 0., 0. }; // events, mean, rms of npe_weighted
+    std::map<std::string, Double_t> config; // kConfigParameters present in the file
+  };
+
+  template <typename T>
+  Bool_t ReadParameter(TFile& file, const char* name, T& value)
+  {
+    auto parameter = file.Get<TParameter<T>>(name);
+    if (!parameter) return false;
+    value = parameter->GetVal();
+    return true;
+  }
+
+  Bool_t ReadJob(const std::string& path, JobInfo& job, std::vector<Int_t>& event_ids)
+  {
+    job.path = path;
+    TFile file(path.c_str(), "READ");
+    if (file.IsZombie() || !file.IsOpen()) {
+      std::cerr << "Error: cannot open " << path << std::endl;
+      return false;
+    }
+    if (!ReadParameter(file, "master_seed", job.master_seed) ||
+        !ReadParameter(file, "run_id", job.run_id) ||
+        !ReadParameter(file, "first_event", job.first_event) ||
+        !ReadParameter(file, "n_events", job.n_events)) {
+      std::cerr << "Error: " << path << " has no run metadata (incomplete job?)" << std::endl;
+      return false;
+    }
+
+    for (const auto& parameter : kConfigParameters) {
+      if (parameter.integer) {
+        Int_t value = 0;
+        if (ReadParameter(file, parameter.name, value)) job.config[parameter.name] = value;
+      } else {
+        Double_t value = 0.;
+        if (ReadParameter(file, parameter.name, value)) job.config[parameter.name] = value;
+      }
+    }
+
+    TKey* key = file.GetKey("tree");
+    if (key && std::string(key->GetClassName()) != "TTree") {
+      std::cerr << "Error: " << path << " holds a " << key->GetClassName()
+                << " (output_mode ntuple); only tree and hist output can be merged" << std::endl;
+      return false;
+    }
+    if (auto tree = file.Get<TTree>("tree")) {
+      job.has_tree = true;
+      if (tree->GetBranch("event_id")) {
+        Int_t event_id = 0;
+        tree->SetBranchStatus("*", 0);
+        tree->SetBranchStatus("event_id", 1);
+        tree->SetBranchAddress("event_id", &event_id);
+        const Long64_t n = tree->GetEntries();
+        for (Long64_t i = 0; i < n; ++i) {
+          tree->GetEntry(i);
+          event_ids.push_back(event_id);
+        }
+        tree->ResetBranchAddresses();
+      }
+    }
+    if (auto stats = file.Get<TVectorD>("npe_stats")) {
+      job.has_stats = true;
+      for (Int_t i = 0; i < 3; ++i) job.stats[i] = (*stats)[i];
+    }
+    return true;
+  }
+
+  // Every event of the jobs' ranges present exactly once (tree mode).
+  Bool_t CheckEventIDs(std::vector<Int_t>& ids, Int_t begin, Int_t end)
+  {
+    std::sort(ids.begin(), ids.end());
+    Bool_t ok = true;
+    for (std::size_t i = 1; i < ids.size(); ++i) {
+      if (ids[i] == ids[i - 1]) {
+        std::cerr << "Error: event " << ids[i] << " is duplicated" << std::endl;
+        ok = false;
+      }
+    }
+    auto last = std::unique(ids.begin(), ids.end());
+    Long64_t missing = (Long64_t)(end - begin) - (last - ids.begin());
+    if (ids.begin() != last && (ids.front() < begin || *(last - 1) >= end)) {
+      std::cerr << "Error: event IDs outside [" << begin << ", " << end << ")" << std::endl;
+      ok = false;
+    } else if (missing > 0) {
+      std::cerr << "Error: " << missing << " events of [" << begin << ", " << end
+                << ") are missing" << std::endl;
+      ok = false;
+    }
+    return ok;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    std::cerr << " Usage: " << std::endl
+              << " KVCMerge <merged rootfile> <job rootfile> [<job rootfile> ...]" << std::endl;
+    return 1;
+  }
+
+  std::vector<JobInfo> jobs;
+  std::vector<Int_t> event_ids;
+  Bool_t ok = true;
+  for (Int_t i = 2; i < argc; ++i) {
+    JobInfo job;
+    if (!ReadJob(argv[i], job, event_ids)) return 1;
+    jobs.push_back(job);
+  }
+  std::sort(jobs.begin(), jobs.end(),
+            [](const JobInfo& a, const JobInfo& b) { return a.first_event < b.first_event; });
+
+  // Same seeding inputs, same output mode, contiguous non-overlapping ranges
+  for (std::size_t i = 0; i < jobs.size(); ++i) {
+    const auto& job = jobs[i];
+    if (job.master_seed != jobs[0].master_seed || job.run_id != jobs[0].run_id) {
+      std::cerr << "Error: " << job.path << " has master_seed " << job.master_seed
+                << " / run_id " << job.run_id << ", " << jobs[0].path << " has "
+                << jobs[0].master_seed << " / " << jobs[0].run_id << std::endl;
+      ok = false;
+    }
+    for (const auto& parameter : kConfigParameters) {
+      auto value = job.config.find(parameter.name);
+      auto first = jobs[0].config.find(parameter.name);
+      const Bool_t has = (value != job.config.end()), first_has = (first != jobs[0].config.end());
+      if (has == first_has && (!has || value->second == first->second)) continue;
+      std::cerr << "Error: " << parameter.name << " is "
+                << (has ? std::to_string(value->second) : std::string("unset")) << " in " << job.path
+                << ", " << (first_has ? std::to_string(first->second) : std::string("unset"))
+                << " in " << jobs[0].path << std::endl;
+      ok = false;
+    }
+    if (job.has_tree != jobs[0].has_tree) {
+      std::cerr << "Error: " << job.path << " and " << jobs[0].path
+                << " have different output modes" << std::endl;
+      ok = false;
+    }
+    if (i > 0) {
+      const Int_t expected = jobs[i - 1].first_event + jobs[i - 1].n_events;
+      if (job.first_event < expected)
+        std::cerr << "Error: " << job.path << " overlaps " << jobs[i - 1].path << std::endl;
+      else if (job.first_event > expected)
+        std::cerr << "Error: events " << expected << " to " << job.first_event - 1
+                  << " are in none of the jobs" << std::endl;
+      if (job.first_event != expected) ok = false;
+    }
+  }
+  const Int_t begin = jobs.front().first_event;
+  const Int_t end   = jobs.back().first_event + jobs.back().n_events;
+  // Hist mode: the events actually written (npe_stats) against each range
+  if (!jobs[0].has_tree) {
+    for (const auto& job : jobs) {
+      if (!job.has_stats) {
+        std::cerr << "Error: " << job.path << " has no npe_stats" << std::endl;
+        ok = false;
+      } else if ((Long64_t)job.stats[0] != job.n_events) {
+        std::cerr << "Error: " << job.path << " holds " << (Long64_t)job.stats[0]
+                  << " events, its range has " << job.n_events << std::endl;
+        ok = false;
+      }
+    }
+  }
+  if (jobs[0].has_tree && !event_ids.empty()) {
+    ok = CheckEventIDs(event_ids, begin, end) && ok;
+  } else if (jobs[0].has_tree) {
+    std::cout << "Warning: no event_id branch; only the job ranges were checked" << std::endl;
+  }
+  if (!ok) {
+    std::cerr << "KVCMerge: checks failed, nothing written" << std::endl;
+    return 1;
+  }
+
+  // Trees and histograms; the metadata is combined below.
+  TFileMerger merger(false);
+  if (!merger.OutputFile(argv[1], "RECREATE")) return 1;
+  for (const auto& job : jobs) merger.AddFile(job.path.c_str());
+  merger.AddObjectNames("master_seed run_id first_event n_events job_index n_jobs npe_stats");
+  for (const auto& parameter : kConfigParameters) merger.AddObjectNames(parameter.name);
+  if (!merger.PartialMerge(TFileMerger::kAll | TFileMerger::kRegular | TFileMerger::kSkipListed)) {
+    std::cerr << "Error: merging failed" << std::endl;
+    return 1;
+  }
+
+  TFile out(argv[1], "UPDATE");
+  TParameter<Long64_t>("master_seed", jobs[0].master_seed).Write();
+  TParameter<Int_t>("run_id", jobs[0].run_id).Write();
+  TParameter<Int_t>("first_event", begin).Write();
+  TParameter<Int_t>("n_events", end - begin).Write();
+  for (const auto& parameter : kConfigParameters) {
+    auto value = jobs[0].config.find(parameter.name);
+    if (value == jobs[0].config.end()) continue;
+    if (parameter.integer) TParameter<Int_t>(parameter.name, (Int_t)value->second).Write();
+    else                   TParameter<Double_t>(parameter.name, value->second).Write();
+  }
+  if (std::all_of(jobs.begin(), jobs.end(), [](const JobInfo& job) { return job.has_stats; })) {
+    Double_t n = 0., sum = 0., sum2 = 0.;
+    for (const auto& job : jobs) {
+      n    += job.stats[0];
+      sum  += job.stats[0] * job.stats[1];
+      sum2 += job.stats[0] * (job.stats[2] * job.stats[2] + job.stats[1] * job.stats[1]);
+    }
+    TVectorD stats(3);
+    stats[0] = n;
+    stats[1] = n > 0. ? sum / n : 0.;
+    const Double_t var = n > 0. ? sum2 / n - stats[1] * stats[1] : 0.;
+    stats[2] = var > 0. ? std::sqrt(var) : 0.;
+    stats.Write("npe_stats");
+  }
+  out.Close();
+
+  std::cout << "KVCMerge: " << jobs.size() << " jobs, events " << begin << " to " << end - 1
+            << " -> " << argv[1] << std::endl;
+  return 0;
+}
@@ -0,0 +1,332 @@
+// KVCReweight: evaluates the npe distribution of a photon-history output
+// (photon_history 1 or 2, tree output) at other values of the scalar optical
+// parameters, without tracking.
+//
+//   KVCReweight <history rootfile> <points file> [<output rootfile> [<npe max>]]
+//
+// The points file has the format of sweep_file (a header of keys and one row
+// of values per point, or "grid <key> <v1> <v2> ..." lines) with the keys
+//   teflon_reflectivity_scale     wrapper REFLECTIVITY scale       s
+//   quartz_boundary_reflectivity  quartz/air surface REFLECTIVITY  r
+//   quartz_abs_scale              quartz ABSLENGTH scale           a
+//   qe_scale                      MPPC PDE scale                   q
+// Keys not given keep the values of the simulation (stored in the file).
+//
+// A photon that reached an MPPC after n_w wrapper and n_q quartz-surface
+// interactions, with optical depth tau in the quartz, is detected with
+//   p = (s'/s)^n_w (r'/r)^n_q exp(-tau (a/a' - 1)) min(pde q', 1)
+// and the npe of an event is the sum of these independent trials (Poisson
+// binomial). Its mean (weighted as npe_weighted) and RMS are exact; with an
+// output file the distribution of unweighted photons is written per point as
+// h_npe_pNNN. A table (point, values, npe mean, error, rms) goes to stdout.
+//
+// Photons lost in the simulation cannot come back: points that raise a
+// survival probability (s' > s, r' > r or a' > a) are biased low and flagged.
+// Simulate at the upper end of the ranges and reweight downwards.
+
+#include "PhotonHistory.hh"
+
+#include "TFile.h"
+#include "TH1D.h"
+#include "TKey.h"
+#include "TParameter.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  enum Param { kTeflon, kQuartz, kAbs, kQE, kNParams };
+  const char* kParamNames[kNParams] = {
+    "teflon_reflectivity_scale", "quartz_boundary_reflectivity", "quartz_abs_scale", "qe_scale"
+  };
+
+  // Photons that reached an MPPC, all events back to back
+  struct Arrivals
+  {
+    std::vector<Long64_t> offset;   // first photon of each event (+ end)
+    std::vector<short> n_wrapper;
+    std::vector<short> n_quartz;
+    std::vector<float> abs_depth;
+    std::vector<float> pde;         // < 0: unknown (Method A)
+    std::vector<float> weight;
+    std::vector<char> detected;
+    Int_t max_wrapper = 0;
+    Int_t max_quartz = 0;
+    Bool_t weighted = false;        // any weight != 1
+    Bool_t pde_unknown = false;
+    Double_t npe_weighted = 0.;     // simulated mean, for reference
+  };
+
+  Bool_t LoadPoints(const char* path, std::vector<std::string>& keys,
+                    std::vector<std::vector<std::string>>& points)
+  {
+    std::ifstream file(path);
+    if (!file) {
+      std::cerr << "Error: cannot open points file " << path << std::endl;
+      return false;
+    }
+    std::vector<std::vector<std::string>> grid_values;
+    std::string line;
+    while (std::getline(file, line)) {
+      std::istringstream iss(line);
+      std::vector<std::string> tokens;
+      std::string token;
+      while (iss >> token) tokens.push_back(token);
+      if (tokens.empty() || tokens[0][0] == '#') continue;
+
+      if (tokens[0] == "grid") {
+        if (tokens.size() < 3) continue;
+        keys.push_back(tokens[1]);
+        grid_values.emplace_back(tokens.begin() + 2, tokens.end());
+      } else if (keys.empty()) {
+        keys = tokens;
+      } else if (tokens.size() == keys.size()) {
+        points.push_back(tokens);
+      } else {
+        std::cerr << "Warning: point '" << line << "' has " << tokens.size()
+                  << " values for " << keys.size() << " keys; skipped" << std::endl;
+      }
+    }
+
+    // Expand the grid (last key varies fastest), as ParameterSweep
+    if (!grid_values.empty()) {
+      points.assign(1, std::vector<std::string>());
+      for (const auto& values : grid_values) {
+        std::vector<std::vector<std::string>> expanded;
+        for (const auto& point : points) {
+          for (const auto& v : values) {
+            expanded.push_back(point);
+            expanded.back().push_back(v);
+          }
+        }
+        points.swap(expanded);
+      }
+    }
+    return !points.empty();
+  }
+
+  Bool_t LoadArrivals(TTree* tree, Arrivals& a)
+  {
+    std::vector<float>* abs_depth = nullptr;
+    std::vector<float>* pde = nullptr;
+    std::vector<float>* weight = nullptr;
+    std::vector<short>* n_quartz = nullptr;
+    std::vector<short>* n_wrapper = nullptr;
+    std::vector<short>* fate = nullptr;
+    if (tree->SetBranchAddress("ph_abs_depth", &abs_depth) < 0 ||
+        tree->SetBranchAddress("ph_pde", &pde) < 0 ||
+        tree->SetBranchAddress("ph_weight", &weight) < 0 ||
+        tree->SetBranchAddress("ph_n_quartz", &n_quartz) < 0 ||
+        tree->SetBranchAddress("ph_n_wrapper", &n_wrapper) < 0 ||
+        tree->SetBranchAddress("ph_fate", &fate) < 0) {
+      std::cerr << "Error: ph_* branches missing (photon_history off or not selected)" << std::endl;
+      return false;
+    }
+    Double_t npe_weighted = 0.;
+    const Bool_t has_npe = tree->GetBranch("npe_weighted") != nullptr;
+    if (has_npe) tree->SetBranchAddress("npe_weighted", &npe_weighted);
+
+    const Long64_t entries = tree->GetEntries();
+    a.offset.reserve(entries + 1);
+    for (Long64_t entry = 0; entry < entries; ++entry) {
+      tree->GetEntry(entry);
+      a.offset.push_back(a.weight.size());
+      a.npe_weighted += npe_weighted;
+      for (std::size_t i = 0; i < fate->size(); ++i) {
+        const short f = (*fate)[i];
+        if (f != PhotonHistory::kDetected && f != PhotonHistory::kMissed) continue;
+        a.n_wrapper.push_back((*n_wrapper)[i]);
+        a.n_quartz.push_back((*n_quartz)[i]);
+        a.abs_depth.push_back((*abs_depth)[i]);
+        a.pde.push_back((*pde)[i]);
+        a.weight.push_back((*weight)[i]);
+        a.detected.push_back(f == PhotonHistory::kDetected);
+        a.max_wrapper = std::max<Int_t>(a.max_wrapper, (*n_wrapper)[i]);
+        a.max_quartz = std::max<Int_t>(a.max_quartz, (*n_quartz)[i]);
+        if ((*weight)[i] != 1.f) a.weighted = true;
+        if ((*pde)[i] < 0.f) a.pde_unknown = true;
+      }
+    }
+    a.offset.push_back(a.weight.size());
+    if (has_npe && entries > 0) a.npe_weighted /= entries;
+    tree->ResetBranchAddresses();
+    return true;
+  }
+
+  // ratio^n for n = 0..n_max
+  std::vector<Double_t> Powers(Double_t ratio, Int_t n_max)
+  {
+    std::vector<Double_t> p(n_max + 1, 1.);
+    for (Int_t n = 1; n <= n_max; ++n) p[n] = p[n - 1] * ratio;
+    return p;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    std::cerr << " Usage: " << std::endl
+              << " KVCReweight <history rootfile> <points file> [<output rootfile> [<npe max>]]" << std::endl;
+    return 1;
+  }
+
+  TFile* file = TFile::Open(argv[1], "READ");
+  TKey* key = (file && !file->IsZombie()) ? file->GetKey("tree") : nullptr;
+  if (key && std::string(key->GetClassName()) != "TTree") {
+    std::cerr << "Error: " << argv[1] << " holds a " << key->GetClassName()
+              << " (output_mode ntuple); KVCReweight reads output_mode tree only" << std::endl;
+    return 1;
+  }
+  TTree* tree = (file && !file->IsZombie()) ? file->Get<TTree>("tree") : nullptr;
+  if (!tree) {
+    std::cerr << "Error: no tree in " << argv[1] << " (tree output required)" << std::endl;
+    return 1;
+  }
+
+  // Values of the simulation
+  Double_t base[kNParams];
+  for (Int_t k = 0; k < kNParams; ++k) {
+    auto par = file->Get<TParameter<Double_t>>(kParamNames[k]);
+    if (!par) {
+      std::cerr << "Error: " << kParamNames[k] << " not in " << argv[1]
+                << " (not a photon_history output)" << std::endl;
+      return 1;
+    }
+    base[k] = par->GetVal();
+  }
+
+  std::vector<std::string> keys;
+  std::vector<std::vector<std::string>> points;
+  if (!LoadPoints(argv[2], keys, points)) {
+    std::cerr << "Error: no points in " << argv[2] << std::endl;
+    return 1;
+  }
+  std::vector<Int_t> key_param(keys.size(), -1);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    for (Int_t k = 0; k < kNParams; ++k)
+      if (keys[i] == kParamNames[k]) key_param[i] = k;
+    if (key_param[i] < 0) {
+      std::cerr << "Error: '" << keys[i] << "' cannot be reweighted (only teflon_reflectivity_scale, "
+                << "quartz_boundary_reflectivity, quartz_abs_scale and qe_scale)" << std::endl;
+      return 1;
+    }
+  }
+
+  Arrivals a;
+  if (!LoadArrivals(tree, a)) return 1;
+  const Long64_t n_events = (Long64_t)a.offset.size() - 1;
+  if (n_events <= 0) {
+    std::cerr << "Error: no events in " << argv[1] << std::endl;
+    return 1;
+  }
+  std::cout << "KVCReweight: " << n_events << " events, " << a.weight.size()
+            << " photons at the MPPCs; simulated npe_weighted mean " << a.npe_weighted << std::endl;
+  for (Int_t k = 0; k < kNParams; ++k)
+    std::cout << "  " << kParamNames[k] << " = " << base[k] << std::endl;
+  if (a.pde_unknown)
+    std::cout << "Warning: photons without PDE (Method A): qe_scale cannot be reweighted" << std::endl;
+
+  TFile* out = nullptr;
+  Int_t npe_max = 200;
+  if (argc > 3) {
+    out = TFile::Open(argv[3], "RECREATE");
+    if (!out || out->IsZombie()) {
+      std::cerr << "Error: cannot create " << argv[3] << std::endl;
+      return 1;
+    }
+    if (argc > 4) npe_max = std::max(1, std::atoi(argv[4]));
+    if (a.weighted)
+      std::cout << "Warning: weighted photons (thinning/roulette): h_npe counts unweighted "
+                << "photons and is biased" << std::endl;
+  }
+
+  std::printf("%-6s", "point");
+  for (const auto& key : keys) std::printf(" %14s", key.c_str());
+  std::printf(" %12s %12s %12s %8s\n", "npe_mean", "npe_mean_err", "npe_rms", "biased");
+
+  std::vector<Double_t> dist;   // P(npe = k) of one event, k >= npe_max in the last cell
+  for (std::size_t ip = 0; ip < points.size(); ++ip) {
+    Double_t value[kNParams];
+    std::copy(base, base + kNParams, value);
+    for (std::size_t i = 0; i < keys.size(); ++i) value[key_param[i]] = std::atof(points[ip][i].c_str());
+
+    const Bool_t biased = value[kTeflon] > base[kTeflon] || value[kQuartz] > base[kQuartz] ||
+                          value[kAbs] > base[kAbs];
+    const std::vector<Double_t> p_wrapper = Powers(base[kTeflon] > 0. ? value[kTeflon] / base[kTeflon] : 1.,
+                                                   a.max_wrapper);
+    const std::vector<Double_t> p_quartz = Powers(base[kQuartz] > 0. ? value[kQuartz] / base[kQuartz] : 1.,
+                                                  a.max_quartz);
+    const Double_t abs_factor = value[kAbs] > 0. ? base[kAbs] / value[kAbs] - 1. : 0.;
+    const Double_t qe = value[kQE];
+
+    TH1D* h_npe = nullptr;
+    if (out) {
+      char name[32];
+      std::snprintf(name, sizeof(name), "h_npe_p%03zu", ip);
+      h_npe = new TH1D(name, "reweighted npe;npe;events", npe_max, 0, npe_max);
+    }
+
+    Double_t sum_mean = 0., sum_mean2 = 0., sum_second = 0.;
+    for (Long64_t e = 0; e < n_events; ++e) {
+      Double_t mean = 0., var = 0.;
+      if (h_npe) {
+        dist.assign(npe_max + 1, 0.);
+        dist[0] = 1.;
+      }
+      Long64_t n = 0;
+      for (Long64_t i = a.offset[e]; i < a.offset[e + 1]; ++i, ++n) {
+        Double_t p = p_wrapper[a.n_wrapper[i]] * p_quartz[a.n_quartz[i]];
+        if (abs_factor != 0.) p *= std::exp(-a.abs_depth[i] * abs_factor);
+        p *= a.pde[i] >= 0.f ? std::min(a.pde[i] * qe, 1.) : (a.detected[i] ? 1. : 0.);
+        p = std::min(p, 1.);
+        const Double_t w = a.weight[i];
+        mean += w * p;
+        var += w * w * p * (1. - p);
+        if (h_npe && p > 0.) {
+          // Poisson binomial: add one trial, the last cell collects npe >= npe_max
+          const Long64_t top = std::min<Long64_t>(n + 1, npe_max);
+          if (top == npe_max) dist[npe_max] += dist[npe_max - 1] * p;
+          for (Long64_t k = std::min<Long64_t>(top, npe_max - 1); k > 0; --k)
+            dist[k] = dist[k] * (1. - p) + dist[k - 1] * p;
+          dist[0] *= 1. - p;
+        }
+      }
+      sum_mean += mean;
+      sum_mean2 += mean * mean;
+      sum_second += var + mean * mean;
+      if (h_npe)
+        for (Int_t k = 0; k <= npe_max; ++k) h_npe->AddBinContent(k + 1, dist[k]);
+    }
+
+    const Double_t npe_mean = sum_mean / n_events;
+    const Double_t spread = std::max(0., sum_mean2 / n_events - npe_mean * npe_mean);
+    const Double_t npe_mean_err = std::sqrt(spread / n_events);
+    const Double_t npe_rms = std::sqrt(std::max(0., sum_second / n_events - npe_mean * npe_mean));
+    std::printf("%-6zu", ip);
+    for (const auto& v : points[ip]) std::printf(" %14s", v.c_str());
+    std::printf(" %12.5g %12.5g %12.5g %8s\n", npe_mean, npe_mean_err, npe_rms, biased ? "yes" : "no");
+
+    if (h_npe) {
+      h_npe->SetEntries(n_events);
+      out->cd();
+      h_npe->Write();
+      delete h_npe;
+    }
+  }
+
+  if (out) {
+    out->Close();
+    delete out;
+  }
+  delete file;
+  return 0;
+}